@@ -20,10 +20,10 @@ void onWiFiConnected() {
   // getMQTTEnabled()返回布尔值，表示是否启用了MQTT功能
   if (wifiManager.getMQTTEnabled()) {
     Serial.println("MQTT Configuration:");
-    Serial.println("- Server: " + wifiManager.getMQTTServer());
-    Serial.println("- Port: " + wifiManager.getMQTTPort());
-    Serial.println("- Username: " + wifiManager.getMQTTUsername());
-    Serial.println("- Client ID: " + wifiManager.getMQTTClientID());
+    Serial.printf("- Server: %s\n", wifiManager.getMQTTServer());
+    Serial.printf("- Port: %u\n", wifiManager.getMQTTPort());
+    Serial.printf("- Username: %s\n", wifiManager.getMQTTUsername());
+    Serial.printf("- Client ID: %s\n", wifiManager.getMQTTClientID());
   } else {
     Serial.println("MQTT Function Disabled");
   }
@@ -32,8 +32,8 @@ void onWiFiConnected() {
   // getUDPEnabled()返回布尔值，表示是否启用了UDP广播功能
   if (wifiManager.getUDPEnabled()) {
     Serial.println("UDP Broadcast Configuration:");
-    Serial.println("- Device Name: " + wifiManager.getDeviceName());
-    Serial.println("- UDP Port: " + wifiManager.getUDPPort());
+    Serial.printf("- Device Name: %s\n", wifiManager.getDeviceName());
+    Serial.printf("- UDP Port: %u\n", wifiManager.getUDPPort());
   } else {
     Serial.println("UDP Broadcast Function Disabled");
   }
@@ -0,0 +1,81 @@
+#include "WiFiConfigAnnouncer.h"
+
+WiFiConfigAnnouncer::WiFiConfigAnnouncer()
+  : _port(0),
+    _interval(0),
+    _lastSent(0),
+    _nextAt(0),
+    _hasSent(false),
+    _sent(0) {
+  memset(&_packet, 0, sizeof(_packet));
+}
+
+void WiFiConfigAnnouncer::begin(uint16_t port, const char* name, unsigned long intervalMs) {
+  _port = port;
+  _interval = intervalMs < MIN_INTERVAL ? MIN_INTERVAL : intervalMs;
+
+  // 不变的字段只填写一次；序号在重新连接后继续递增
+  uint16_t sequence = _packet.sequence;
+  memset(&_packet, 0, sizeof(_packet));
+  _packet.sequence = sequence;
+  _packet.magic = WIFI_CONFIG_ANNOUNCE_MAGIC;
+  _packet.version = WIFI_CONFIG_ANNOUNCE_VERSION;
+  WiFi.macAddress(_packet.mac);
+  memcpy(_packet.name, name, strnlen(name, sizeof(_packet.name)));  // 包已清零，不足时以0填充
+
+  // 第一次广播尽快发送（频繁重连时仍受MIN_INTERVAL限制）
+  announceNow();
+}
+
+void WiFiConfigAnnouncer::stop() {
+  _port = 0;
+}
+
+void WiFiConfigAnnouncer::announceNow() {
+  unsigned long now = millis();
+  if (_hasSent && now - _lastSent < MIN_INTERVAL) {
+    _nextAt = _lastSent + MIN_INTERVAL;
+  } else {
+    _nextAt = now;
+  }
+}
+
+bool WiFiConfigAnnouncer::loop() {
+  if (!_port || (long)(millis() - _nextAt) < 0) {
+    return false;
+  }
+  bool ok = send();
+  scheduleNext();
+  return ok;
+}
+
+// 下一次发送时间：间隔的90%到110%之间随机
+void WiFiConfigAnnouncer::scheduleNext() {
+  unsigned long spread = _interval / 5;
+  _nextAt = _lastSent + _interval - spread / 2 + random(spread + 1);
+}
+
+bool WiFiConfigAnnouncer::send() {
+  IPAddress ip = WiFi.localIP();
+  IPAddress mask = WiFi.subnetMask();
+
+  _packet.rssi = (int8_t)WiFi.RSSI();
+  _packet.sequence++;
+  _packet.ip = (uint32_t)ip;
+  _packet.uptime = millis() / 1000;
+
+  _lastSent = millis();
+  _hasSent = true;
+
+  // 发送到子网广播地址
+  IPAddress broadcast((uint32_t)ip | ~(uint32_t)mask);
+  if (!_udp.beginPacket(broadcast, _port)) {
+    return false;
+  }
+  _udp.write((const uint8_t*)&_packet, sizeof(_packet));
+  if (!_udp.endPacket()) {
+    return false;
+  }
+  _sent++;
+  return true;
+}
@@ -0,0 +1,72 @@
+#ifndef WIFI_CONFIG_ANNOUNCER_H
+#define WIFI_CONFIG_ANNOUNCER_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiUdp.h>
+
+#define WIFI_CONFIG_ANNOUNCE_MAGIC 0x4e414357UL  // "WCAN"
+#define WIFI_CONFIG_ANNOUNCE_VERSION 1
+
+// 局域网发现广播的报文，固定56字节，多字节整数为小端序
+// 接收方按版本号判断布局，新字段只追加在末尾
+struct WiFiConfigAnnounce {
+  uint32_t magic;     // WIFI_CONFIG_ANNOUNCE_MAGIC
+  uint8_t version;    // WIFI_CONFIG_ANNOUNCE_VERSION
+  int8_t rssi;        // 当前信号强度（dBm）
+  uint16_t sequence;  // 每次发送加1，接收方可据此发现丢包或设备重启
+  uint8_t mac[6];     // STA的MAC地址
+  uint16_t reserved;
+  uint32_t ip;        // IPv4地址，与lwIP一致为网络字节序
+  uint32_t uptime;    // 开机以来的秒数
+  char name[32];      // 设备名称，不足32字节时以'\0'结尾
+} __attribute__((packed));
+
+static_assert(sizeof(WiFiConfigAnnounce) == 56, "announce layout changed, bump WIFI_CONFIG_ANNOUNCE_VERSION");
+
+// 周期性的UDP发现广播
+/*
+  报文在begin()时填好名称和MAC，之后每次发送只更新IP、信号强度、运行时间和序号，
+  直接从预先分配的报文结构发送，不拼接字符串，也不分配内存。
+  发送间隔在设定值的±10%之间随机选取，避免多台设备同时广播；
+  立即广播的请求（例如刚连接上时）与上次发送的间隔不少于MIN_INTERVAL。
+*/
+class WiFiConfigAnnouncer {
+public:
+  WiFiConfigAnnouncer();
+
+  // 开始广播到指定端口，name超过32字节时截断
+  void begin(uint16_t port, const char* name, unsigned long intervalMs);
+  void stop();
+
+  bool isRunning() const {
+    return _port != 0;
+  }
+
+  // 到达发送时间时发送一次，返回是否发送
+  bool loop();
+
+  // 请求尽快发送一次，受MIN_INTERVAL限制
+  void announceNow();
+
+  uint32_t sent() const {
+    return _sent;
+  }
+
+  static const unsigned long MIN_INTERVAL = 1000;
+
+private:
+  void scheduleNext();
+  bool send();
+
+  WiFiUDP _udp;
+  WiFiConfigAnnounce _packet;
+  uint16_t _port;
+  unsigned long _interval;
+  unsigned long _lastSent;
+  unsigned long _nextAt;
+  bool _hasSent;
+  uint32_t _sent;
+};
+
+#endif  // WIFI_CONFIG_ANNOUNCER_H
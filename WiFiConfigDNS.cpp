@@ -0,0 +1,169 @@
+#include "WiFiConfigDNS.h"
+
+// 各系统用于判断是否需要登录网页的联网检测域名
+static const char* const PROBE_HOSTS[] = {
+  "connectivitycheck.gstatic.com",    // Android
+  "connectivitycheck.android.com",
+  "clients3.google.com",
+  "www.google.com",
+  "captive.apple.com",                // iOS、macOS
+  "www.apple.com",
+  "www.msftconnecttest.com",          // Windows
+  "www.msftncsi.com",
+  "detectportal.firefox.com",         // Firefox
+};
+
+static const uint16_t DNS_TYPE_A = 1;
+static const uint16_t DNS_TYPE_ANY = 255;
+static const uint16_t DNS_CLASS_IN = 1;
+
+static uint16_t readU16(const uint8_t* p) {
+  return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static void writeU16(uint8_t* p, uint16_t value) {
+  p[0] = (uint8_t)(value >> 8);
+  p[1] = (uint8_t)value;
+}
+
+WiFiConfigDNS::WiFiConfigDNS()
+  : _running(false) {
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+bool WiFiConfigDNS::start(uint16_t port, const IPAddress& resolvedIP) {
+  _resolvedIP = resolvedIP;
+  _running = _udp.begin(port) == 1;
+  return _running;
+}
+
+void WiFiConfigDNS::stop() {
+  if (_running) {
+    _udp.stop();
+    _running = false;
+  }
+}
+
+bool WiFiConfigDNS::isProbeHost(const char* name) {
+  for (size_t i = 0; i < sizeof(PROBE_HOSTS) / sizeof(PROBE_HOSTS[0]); i++) {
+    if (strcmp(name, PROBE_HOSTS[i]) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+size_t WiFiConfigDNS::process(size_t budget) {
+  if (!_running) {
+    return 0;
+  }
+
+  uint32_t start = micros();
+  size_t count = 0;
+  while (count < budget) {
+    int size = _udp.parsePacket();
+    if (size <= 0) {
+      break;
+    }
+    count++;
+    _stats.queries++;
+
+    // 超过512字节的报文不是普通查询，读出前面部分后丢弃
+    int length = _udp.read(_packet, sizeof(_packet));
+    if (size > (int)sizeof(_packet) || length <= 0 || !answer(length)) {
+      _stats.dropped++;
+      continue;
+    }
+
+    uint32_t latency = micros() - start;
+    _stats.answered++;
+    _stats.lastLatencyUs = latency;
+    _stats.totalLatencyUs += latency;
+    if (latency > _stats.maxLatencyUs) {
+      _stats.maxLatencyUs = latency;
+    }
+  }
+
+  if (count > _stats.maxBatch) {
+    _stats.maxBatch = count;
+  }
+  return count;
+}
+
+// 把_packet中的查询改写为回复并发送，报文无效时返回false
+bool WiFiConfigDNS::answer(size_t length) {
+  if (length < HEADER_SIZE) {
+    return false;
+  }
+
+  // 只回复只有一个问题的标准查询
+  uint8_t opcode = (_packet[2] >> 3) & 0x0f;
+  if ((_packet[2] & 0x80) != 0 || opcode != 0 || readU16(_packet + 4) != 1) {
+    return false;
+  }
+
+  // 读出问题中的域名（转为小写），不允许压缩指针
+  char name[256];
+  size_t nameLength = 0;
+  size_t pos = HEADER_SIZE;
+  while (pos < length && _packet[pos] != 0) {
+    uint8_t label = _packet[pos++];
+    if (label > 63 || pos + label > length || nameLength + label + 1 >= sizeof(name)) {
+      return false;
+    }
+    if (nameLength > 0) {
+      name[nameLength++] = '.';
+    }
+    for (uint8_t i = 0; i < label; i++) {
+      char c = (char)_packet[pos++];
+      name[nameLength++] = (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+  }
+  name[nameLength] = '\0';
+  pos++;  // 结尾的0
+  if (pos + 4 > length) {
+    return false;
+  }
+  uint16_t qtype = readU16(_packet + pos);
+  uint16_t qclass = readU16(_packet + pos + 2);
+  pos += 4;
+
+  // 回复放在问题之后，需要16字节
+  bool hasAnswer = (qtype == DNS_TYPE_A || qtype == DNS_TYPE_ANY) && qclass == DNS_CLASS_IN;
+  if (hasAnswer && pos + 16 > sizeof(_packet)) {
+    return false;
+  }
+
+  bool probe = isProbeHost(name);
+  if (probe) {
+    _stats.probes++;
+  }
+
+  // 头部：应答、权威回答，保留查询的RD位；去掉问题之后的附加部分
+  _packet[2] = (uint8_t)(0x84 | (_packet[2] & 0x01));
+  _packet[3] = 0;
+  writeU16(_packet + 6, hasAnswer ? 1 : 0);
+  writeU16(_packet + 8, 0);
+  writeU16(_packet + 10, 0);
+
+  // 其他类型（例如AAAA）回复没有记录，客户端会立即改用A记录
+  if (hasAnswer) {
+    uint32_t ttl = probe ? 0 : DEFAULT_TTL;
+    uint8_t* rr = _packet + pos;
+    writeU16(rr, 0xc000 | HEADER_SIZE);  // 指向问题中的域名
+    writeU16(rr + 2, DNS_TYPE_A);
+    writeU16(rr + 4, DNS_CLASS_IN);
+    writeU16(rr + 6, (uint16_t)(ttl >> 16));
+    writeU16(rr + 8, (uint16_t)ttl);
+    writeU16(rr + 10, 4);
+    for (int i = 0; i < 4; i++) {
+      rr[12 + i] = _resolvedIP[i];
+    }
+    pos += 16;
+  }
+
+  _udp.beginPacket(_udp.remoteIP(), _udp.remotePort());
+  _udp.write(_packet, pos);
+  _udp.endPacket();
+  return true;
+}
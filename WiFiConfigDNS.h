@@ -0,0 +1,63 @@
+#ifndef WIFI_CONFIG_DNS_H
+#define WIFI_CONFIG_DNS_H
+
+#include <Arduino.h>
+#include <WiFiUdp.h>
+
+// 配置门户的DNS应答统计
+struct WiFiConfigDNSStats {
+  uint32_t queries;         // 收到的查询数
+  uint32_t answered;        // 已回复的查询数
+  uint32_t dropped;         // 格式错误或不是标准查询而丢弃的数据包
+  uint32_t probes;          // 其中各系统联网检测域名的查询数
+  uint32_t maxBatch;        // 一次process()中处理的最多查询数
+  uint32_t lastLatencyUs;   // 最近一次查询从本轮处理开始到发出回复的时间
+  uint32_t maxLatencyUs;
+  uint64_t totalLatencyUs;  // 除以answered得到平均值
+};
+
+// 强制门户DNS：所有A记录查询都解析到AP的地址
+/*
+  每次process()处理所有已到达的查询（最多budget个），不再每次loop()只处理一个，
+  手机连上AP时的一批联网检测查询在同一轮内全部得到回复。
+  回复直接在接收缓冲区中修改查询报文得到：设置应答标志，去掉问题之后的附加部分，
+  再追加一条指向问题名称的A记录，整个过程不分配内存。
+  Android、iOS和Windows的联网检测域名以TTL 0回复，配置完成后系统会立即重新解析。
+*/
+class WiFiConfigDNS {
+public:
+  WiFiConfigDNS();
+
+  bool start(uint16_t port, const IPAddress& resolvedIP);
+  void stop();
+
+  bool isRunning() const {
+    return _running;
+  }
+
+  // 处理所有已到达的查询，最多budget个，返回处理的数量
+  size_t process(size_t budget = 16);
+
+  const WiFiConfigDNSStats& stats() const {
+    return _stats;
+  }
+
+  // 域名是否为已知的联网检测域名
+  static bool isProbeHost(const char* name);
+
+private:
+  // DNS报文最大512字节（不使用EDNS）
+  static const size_t PACKET_SIZE = 512;
+  static const size_t HEADER_SIZE = 12;
+  static const uint32_t DEFAULT_TTL = 60;
+
+  bool answer(size_t length);
+
+  WiFiUDP _udp;
+  IPAddress _resolvedIP;
+  bool _running;
+  uint8_t _packet[PACKET_SIZE];
+  WiFiConfigDNSStats _stats;
+};
+
+#endif  // WIFI_CONFIG_DNS_H
@@ -0,0 +1,158 @@
+#include "WiFiConfigJournal.h"
+#include "WiFiConfigRecord.h"
+
+WiFiConfigJournal::WiFiConfigJournal()
+  : _partition(nullptr),
+    _sectorCount(0),
+    _activeSector(0),
+    _writeOffset(0),
+    _latestOffset(0),
+    _latestLength(0),
+    _sequence(0),
+    _bytesWritten(0),
+    _sectorErases(0) {}
+
+bool WiFiConfigJournal::begin(const char* partitionLabel) {
+  _partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partitionLabel);
+  if (!_partition) {
+    return false;
+  }
+
+  // 至少需要两个扇区，保证轮转擦除时最新记录仍然存在
+  _sectorCount = _partition->size / SECTOR_SIZE;
+  if (_sectorCount < 2) {
+    _partition = nullptr;
+    return false;
+  }
+
+  scan();
+  return true;
+}
+
+// 扫描所有扇区，找到序号最大的有效记录和下一条记录的写入位置
+void WiFiConfigJournal::scan() {
+  _latestLength = 0;
+  _sequence = 0;
+
+  // 没有任何记录时，第一次写入会轮转到扇区0
+  _activeSector = _sectorCount - 1;
+  _writeOffset = _sectorCount * SECTOR_SIZE;
+
+  for (uint32_t sector = 0; sector < _sectorCount; sector++) {
+    uint32_t base = sector * SECTOR_SIZE;
+    uint32_t offset = base;
+    bool latestHere = false;
+
+    while (offset + sizeof(EntryHeader) <= base + SECTOR_SIZE) {
+      EntryHeader header;
+      if (esp_partition_read(_partition, offset, &header, sizeof(header)) != ESP_OK) {
+        offset = base + SECTOR_SIZE;
+        break;
+      }
+
+      // 扇区剩余部分尚未使用
+      if (header.magic == ERASED_WORD) {
+        break;
+      }
+
+      // 未写完或损坏的记录：放弃该扇区剩余空间，下次写入时轮转
+      if (!entryValid(offset, header)) {
+        offset = base + SECTOR_SIZE;
+        break;
+      }
+
+      if (_latestLength == 0 || header.sequence > _sequence) {
+        _sequence = header.sequence;
+        _latestOffset = offset;
+        _latestLength = header.length;
+        _activeSector = sector;
+        latestHere = true;
+      } else {
+        latestHere = false;
+      }
+
+      offset += entrySize(header.length);
+    }
+
+    if (latestHere) {
+      _writeOffset = offset;
+    }
+  }
+}
+
+// 检查日志头的一致性，并校验数据的CRC
+bool WiFiConfigJournal::entryValid(uint32_t offset, const EntryHeader& header) {
+  if (header.magic != ENTRY_MAGIC || header.lengthCheck != (uint16_t)~header.length || header.length == 0) {
+    return false;
+  }
+
+  uint32_t sectorEnd = (offset / SECTOR_SIZE + 1) * SECTOR_SIZE;
+  if (offset + entrySize(header.length) > sectorEnd) {
+    return false;
+  }
+
+  // 分块计算CRC，不需要整条记录大小的缓冲区
+  uint32_t crc = wifiConfigCrc32(&header.sequence, 8);
+  uint8_t chunk[64];
+  uint32_t pos = offset + sizeof(EntryHeader);
+  uint32_t remaining = header.length;
+  while (remaining > 0) {
+    uint32_t n = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+    if (esp_partition_read(_partition, pos, chunk, n) != ESP_OK) {
+      return false;
+    }
+    crc = wifiConfigCrc32(chunk, n, crc);
+    pos += n;
+    remaining -= n;
+  }
+  return crc == header.crc;
+}
+
+bool WiFiConfigJournal::read(void* data, size_t length) {
+  if (!_partition || _latestLength == 0 || length != _latestLength) {
+    return false;
+  }
+  return esp_partition_read(_partition, _latestOffset + sizeof(EntryHeader), data, length) == ESP_OK;
+}
+
+bool WiFiConfigJournal::append(const void* data, size_t length) {
+  if (!_partition || length == 0 || length > 0xFFFF || entrySize(length) > SECTOR_SIZE) {
+    return false;
+  }
+
+  uint32_t size = entrySize(length);
+  uint32_t sectorEnd = (_activeSector + 1) * SECTOR_SIZE;
+
+  // 当前扇区放不下，轮转到下一个扇区并擦除其中的旧记录
+  if (_writeOffset + size > sectorEnd) {
+    uint32_t next = (_activeSector + 1) % _sectorCount;
+    if (esp_partition_erase_range(_partition, next * SECTOR_SIZE, SECTOR_SIZE) != ESP_OK) {
+      return false;
+    }
+    _sectorErases++;
+    _activeSector = next;
+    _writeOffset = next * SECTOR_SIZE;
+    sectorEnd = _writeOffset + SECTOR_SIZE;
+  }
+
+  EntryHeader header;
+  header.magic = ENTRY_MAGIC;
+  header.sequence = _sequence + 1;
+  header.length = (uint16_t)length;
+  header.lengthCheck = (uint16_t)~header.length;
+  header.crc = wifiConfigCrc32(data, length, wifiConfigCrc32(&header.sequence, 8));
+
+  // 先写日志头再写数据；中途掉电留下的记录会因CRC不符被忽略
+  if (esp_partition_write(_partition, _writeOffset, &header, sizeof(header)) != ESP_OK
+      || esp_partition_write(_partition, _writeOffset + sizeof(header), data, length) != ESP_OK) {
+    _writeOffset = sectorEnd;
+    return false;
+  }
+
+  _latestOffset = _writeOffset;
+  _latestLength = header.length;
+  _sequence = header.sequence;
+  _writeOffset += size;
+  _bytesWritten += sizeof(header) + length;
+  return true;
+}
@@ -0,0 +1,89 @@
+#ifndef WIFI_CONFIG_JOURNAL_H
+#define WIFI_CONFIG_JOURNAL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <esp_partition.h>
+
+// 只追加写入的配置日志，建立在一个独立的Flash数据分区上
+/*
+  分区按4KB扇区组成一个环，每条日志项为：
+    魔数(4) 序号(4) 长度(2) 长度取反(2) CRC32(4) 数据(长度，补齐到4字节)
+  新记录总是追加到当前扇区末尾，扇区写满后轮转到下一个扇区，
+  擦除它（回收其中的旧记录）后继续写入。启动时扫描全部扇区，
+  CRC有效且序号最大的记录即为当前配置。
+  每次保存只写入一条记录，擦除均匀分布在所有扇区上。
+*/
+class WiFiConfigJournal {
+public:
+  WiFiConfigJournal();
+
+  // 查找指定标签的数据分区并扫描日志，分区不存在时返回false
+  bool begin(const char* partitionLabel);
+
+  bool isReady() const {
+    return _partition != nullptr;
+  }
+
+  // 日志中是否有有效记录
+  bool hasRecord() const {
+    return _latestLength != 0;
+  }
+
+  // 最新记录的长度，记录结构升级后可能与当前结构的大小不同
+  size_t recordLength() const {
+    return _latestLength;
+  }
+
+  // 读取最新的有效记录，length必须与保存时一致
+  bool read(void* data, size_t length);
+
+  // 追加一条新记录
+  bool append(const void* data, size_t length);
+
+  // 最新记录的序号
+  uint32_t sequence() const {
+    return _sequence;
+  }
+
+  // 统计：本次启动以来写入的字节数（含日志头）和擦除的扇区数
+  uint32_t bytesWritten() const {
+    return _bytesWritten;
+  }
+  uint32_t sectorErases() const {
+    return _sectorErases;
+  }
+
+  static const uint32_t SECTOR_SIZE = 4096;
+
+private:
+  struct EntryHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint16_t length;
+    uint16_t lengthCheck;  // ~length，用于识别未写完的日志头
+    uint32_t crc;          // 覆盖sequence、length和数据
+  };
+
+  static const uint32_t ENTRY_MAGIC = 0x4A434357UL;  // "WCCJ"
+  static const uint32_t ERASED_WORD = 0xFFFFFFFFUL;
+
+  void scan();
+  bool entryValid(uint32_t offset, const EntryHeader& header);
+  uint32_t entrySize(uint16_t length) const {
+    return (sizeof(EntryHeader) + length + 3) & ~3UL;
+  }
+
+  const esp_partition_t* _partition;
+  uint32_t _sectorCount;
+  uint32_t _activeSector;   // 正在写入的扇区
+  uint32_t _writeOffset;    // 下一条记录的写入位置（分区内偏移）
+  uint32_t _latestOffset;   // 最新有效记录的位置
+  uint16_t _latestLength;   // 最新有效记录的数据长度，0表示没有记录
+  uint32_t _sequence;
+
+  uint32_t _bytesWritten;
+  uint32_t _sectorErases;
+};
+
+#endif  // WIFI_CONFIG_JOURNAL_H
@@ -0,0 +1,358 @@
+#include "WiFiConfigJson.h"
+
+static bool isWhitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\n' || c == '\r';
+}
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+// 数字、true、false、null中可能出现的字符；遇到其他字符时字面量结束
+static bool isLiteralChar(char c) {
+  return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '-' || c == '+' ||
+         c == '.';
+}
+
+// 按JSON语法检查数字：-?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+static bool isNumber(const char* text, size_t length) {
+  size_t i = 0;
+  if (i < length && text[i] == '-') i++;
+  if (i < length && text[i] == '0') {
+    i++;
+  } else if (i < length && text[i] >= '1' && text[i] <= '9') {
+    while (i < length && text[i] >= '0' && text[i] <= '9') i++;
+  } else {
+    return false;
+  }
+  if (i < length && text[i] == '.') {
+    size_t start = ++i;
+    while (i < length && text[i] >= '0' && text[i] <= '9') i++;
+    if (i == start) return false;
+  }
+  if (i < length && (text[i] == 'e' || text[i] == 'E')) {
+    i++;
+    if (i < length && (text[i] == '+' || text[i] == '-')) i++;
+    size_t start = i;
+    while (i < length && text[i] >= '0' && text[i] <= '9') i++;
+    if (i == start) return false;
+  }
+  return i == length;
+}
+
+WiFiConfigJsonReader::WiFiConfigJsonReader(WiFiConfigJsonHandler handler, void* context)
+  : _handler(handler),
+    _context(context) {
+  reset();
+}
+
+void WiFiConfigJsonReader::reset() {
+  _state = STATE_START;
+  _offset = 0;
+  _error = nullptr;
+  _errorOffset = 0;
+  _key[0] = '\0';
+  _value[0] = '\0';
+  _length = 0;
+  _escape = 0;
+  _unit = 0;
+  _highSurrogate = 0;
+  _nesting = 0;
+  _depth = 0;
+  _nestedString = false;
+  _nestedEscape = false;
+  _nestedArray = false;
+}
+
+bool WiFiConfigJsonReader::feed(const char* data, size_t length) {
+  if (_state == STATE_ERROR) {
+    return false;
+  }
+  for (size_t i = 0; i < length; i++, _offset++) {
+    if (!step(data[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool WiFiConfigJsonReader::finish() {
+  if (_state == STATE_ERROR) {
+    return false;
+  }
+  if (_state != STATE_DONE) {
+    return fail("unexpected end of input");
+  }
+  return true;
+}
+
+bool WiFiConfigJsonReader::fail(const char* reason) {
+  _state = STATE_ERROR;
+  _error = reason;
+  _errorOffset = _offset;
+  return false;
+}
+
+bool WiFiConfigJsonReader::step(char c) {
+  switch (_state) {
+    case STATE_START:
+      if (isWhitespace(c)) return true;
+      if (c != '{') return fail("expected object");
+      _state = STATE_FIRST_KEY;
+      return true;
+
+    case STATE_FIRST_KEY:
+      if (c == '}') {
+        _state = STATE_DONE;
+        return true;
+      }
+      _state = STATE_KEY;
+      return step(c);
+
+    case STATE_KEY:
+      if (isWhitespace(c)) return true;
+      if (c != '"') return fail("expected key");
+      _length = 0;
+      _escape = 0;
+      _highSurrogate = 0;
+      _state = STATE_KEY_STRING;
+      return true;
+
+    case STATE_KEY_STRING:
+      if (c == '"' && _escape == 0) {
+        if (_highSurrogate) return fail("invalid surrogate pair");
+        _key[_length] = '\0';
+        _state = STATE_COLON;
+        return true;
+      }
+      return stringChar(c, _key, WIFI_CONFIG_JSON_KEY_MAX);
+
+    case STATE_COLON:
+      if (isWhitespace(c)) return true;
+      if (c != ':') return fail("expected ':'");
+      _state = STATE_VALUE;
+      return true;
+
+    case STATE_VALUE:
+      if (isWhitespace(c)) return true;
+      _length = 0;
+      if (c == '"') {
+        _escape = 0;
+        _highSurrogate = 0;
+        _state = STATE_STRING;
+      } else if (c == '{' || c == '[') {
+        _nestedArray = c == '[';
+        _nesting = _nestedArray ? 1 : 0;
+        _depth = 1;
+        _nestedString = false;
+        _nestedEscape = false;
+        _state = STATE_NESTED;
+      } else if (isLiteralChar(c)) {
+        _value[_length++] = c;
+        _state = STATE_LITERAL;
+      } else {
+        return fail("expected value");
+      }
+      return true;
+
+    case STATE_STRING:
+      if (c == '"' && _escape == 0) {
+        if (_highSurrogate) return fail("invalid surrogate pair");
+        _value[_length] = '\0';
+        _state = STATE_NEXT;
+        return emit(JSON_STRING);
+      }
+      return stringChar(c, _value, WIFI_CONFIG_JSON_VALUE_MAX);
+
+    case STATE_LITERAL: {
+      if (isLiteralChar(c)) {
+        if (_length >= WIFI_CONFIG_JSON_VALUE_MAX) return fail("value too long");
+        _value[_length++] = c;
+        return true;
+      }
+      _value[_length] = '\0';
+      WiFiConfigJsonType type;
+      if (_length == 4 && memcmp(_value, "true", 4) == 0) {
+        type = JSON_TRUE;
+      } else if (_length == 5 && memcmp(_value, "false", 5) == 0) {
+        type = JSON_FALSE;
+      } else if (_length == 4 && memcmp(_value, "null", 4) == 0) {
+        type = JSON_NULL;
+      } else if (isNumber(_value, _length)) {
+        type = JSON_NUMBER;
+      } else {
+        return fail("invalid literal");
+      }
+      _state = STATE_NEXT;
+      // 结束字面量的字符属于后面的内容
+      return emit(type) && step(c);
+    }
+
+    case STATE_NESTED:
+      return skipNested(c);
+
+    case STATE_NEXT:
+      if (isWhitespace(c)) return true;
+      if (c == ',') {
+        _state = STATE_KEY;
+      } else if (c == '}') {
+        _state = STATE_DONE;
+      } else {
+        return fail("expected ',' or '}'");
+      }
+      return true;
+
+    case STATE_DONE:
+      if (isWhitespace(c)) return true;
+      return fail("unexpected data after object");
+
+    case STATE_ERROR:
+      break;
+  }
+  return false;
+}
+
+// 字符串中的一个字节：处理转义，结果追加到buffer
+bool WiFiConfigJsonReader::stringChar(char c, char* buffer, size_t capacity) {
+  if (_escape == 0) {
+    if (c == '\\') {
+      _escape = 1;
+      return true;
+    }
+    if ((uint8_t)c < 0x20) return fail("control character in string");
+    if (_highSurrogate) return fail("invalid surrogate pair");
+    if (_length >= capacity) return fail("string too long");
+    buffer[_length++] = c;
+    return true;
+  }
+
+  if (_escape == 1) {
+    char decoded;
+    switch (c) {
+      case '"': decoded = '"'; break;
+      case '\\': decoded = '\\'; break;
+      case '/': decoded = '/'; break;
+      case 'b': decoded = '\b'; break;
+      case 'f': decoded = '\f'; break;
+      case 'n': decoded = '\n'; break;
+      case 'r': decoded = '\r'; break;
+      case 't': decoded = '\t'; break;
+      case 'u':
+        _escape = 2;
+        _unit = 0;
+        return true;
+      default:
+        return fail("invalid escape");
+    }
+    _escape = 0;
+    if (_highSurrogate) return fail("invalid surrogate pair");
+    if (_length >= capacity) return fail("string too long");
+    buffer[_length++] = decoded;
+    return true;
+  }
+
+  // \u之后的四位十六进制数
+  int digit = hexValue(c);
+  if (digit < 0) return fail("invalid escape");
+  _unit = (_unit << 4) | digit;
+  if (++_escape < 6) {
+    return true;
+  }
+  _escape = 0;
+
+  // UTF-16代理对合并为一个码点
+  if (_unit >= 0xD800 && _unit <= 0xDBFF) {
+    if (_highSurrogate) return fail("invalid surrogate pair");
+    _highSurrogate = _unit;
+    return true;
+  }
+  if (_unit >= 0xDC00 && _unit <= 0xDFFF) {
+    if (!_highSurrogate) return fail("invalid surrogate pair");
+    uint32_t codePoint = 0x10000 + ((uint32_t)(_highSurrogate - 0xD800) << 10) + (_unit - 0xDC00);
+    _highSurrogate = 0;
+    return appendCodePoint(codePoint, buffer, capacity);
+  }
+  if (_highSurrogate) return fail("invalid surrogate pair");
+  // 值以C字符串交给处理函数，不能包含'\0'
+  if (_unit == 0) return fail("null character in string");
+  return appendCodePoint(_unit, buffer, capacity);
+}
+
+bool WiFiConfigJsonReader::appendCodePoint(uint32_t codePoint, char* buffer, size_t capacity) {
+  uint8_t bytes[4];
+  size_t count;
+  if (codePoint < 0x80) {
+    bytes[0] = codePoint;
+    count = 1;
+  } else if (codePoint < 0x800) {
+    bytes[0] = 0xC0 | (codePoint >> 6);
+    bytes[1] = 0x80 | (codePoint & 0x3F);
+    count = 2;
+  } else if (codePoint < 0x10000) {
+    bytes[0] = 0xE0 | (codePoint >> 12);
+    bytes[1] = 0x80 | ((codePoint >> 6) & 0x3F);
+    bytes[2] = 0x80 | (codePoint & 0x3F);
+    count = 3;
+  } else {
+    bytes[0] = 0xF0 | (codePoint >> 18);
+    bytes[1] = 0x80 | ((codePoint >> 12) & 0x3F);
+    bytes[2] = 0x80 | ((codePoint >> 6) & 0x3F);
+    bytes[3] = 0x80 | (codePoint & 0x3F);
+    count = 4;
+  }
+  if (_length + count > capacity) return fail("string too long");
+  memcpy(buffer + _length, bytes, count);
+  _length += count;
+  return true;
+}
+
+// 跳过嵌套的对象或数组：只跟踪字符串边界和括号层次
+bool WiFiConfigJsonReader::skipNested(char c) {
+  if (_nestedString) {
+    if (_nestedEscape) {
+      _nestedEscape = false;
+    } else if (c == '\\') {
+      _nestedEscape = true;
+    } else if (c == '"') {
+      _nestedString = false;
+    } else if ((uint8_t)c < 0x20) {
+      return fail("control character in string");
+    }
+    return true;
+  }
+
+  switch (c) {
+    case '"':
+      _nestedString = true;
+      break;
+    case '{':
+    case '[':
+      if (_depth >= WIFI_CONFIG_JSON_MAX_DEPTH) return fail("nesting too deep");
+      _nesting = (_nesting << 1) | (c == '[' ? 1 : 0);
+      _depth++;
+      break;
+    case '}':
+    case ']':
+      if ((_nesting & 1) != (c == ']' ? 1u : 0u)) return fail("mismatched bracket");
+      _nesting >>= 1;
+      if (--_depth == 0) {
+        _length = 0;
+        _value[0] = '\0';
+        _state = STATE_NEXT;
+        return emit(_nestedArray ? JSON_ARRAY : JSON_OBJECT);
+      }
+      break;
+  }
+  return true;
+}
+
+bool WiFiConfigJsonReader::emit(WiFiConfigJsonType type) {
+  const char* reason = _handler(_context, _key, type, _value, _length);
+  if (reason) {
+    return fail(reason);
+  }
+  return true;
+}
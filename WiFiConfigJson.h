@@ -0,0 +1,102 @@
+#ifndef WIFI_CONFIG_JSON_H
+#define WIFI_CONFIG_JSON_H
+
+#include <Arduino.h>
+
+// 键和字符串值的最大长度（不含'\0'），更长的内容视为错误而不是截断
+#define WIFI_CONFIG_JSON_KEY_MAX 32
+#define WIFI_CONFIG_JSON_VALUE_MAX 256
+
+// 嵌套值（对象、数组）的最大深度
+#define WIFI_CONFIG_JSON_MAX_DEPTH 32
+
+// 成员值的类型
+enum WiFiConfigJsonType {
+  JSON_STRING,   // value为解码后的内容（UTF-8）
+  JSON_NUMBER,   // value为原文，符合JSON数字语法
+  JSON_TRUE,
+  JSON_FALSE,
+  JSON_NULL,
+  JSON_OBJECT,   // 嵌套的值已被跳过，value为空
+  JSON_ARRAY
+};
+
+// 顶层对象的一个成员解析完成时调用；返回nullptr表示接受，否则返回错误原因并停止解析
+typedef const char* (*WiFiConfigJsonHandler)(void* context, const char* key, WiFiConfigJsonType type,
+                                             const char* value, size_t length);
+
+// 流式JSON读取器：文档必须是一个对象，顶层成员逐个交给handler
+/*
+  按字节推进的状态机，输入可以分多次feed()，不需要整个文档在内存中。
+  只有当前的键和值保存在固定大小的缓冲区里，不构建DOM，也不分配内存。
+  顶层成员的值如果是对象或数组，只检查括号匹配和字符串边界后跳过。
+*/
+class WiFiConfigJsonReader {
+public:
+  WiFiConfigJsonReader(WiFiConfigJsonHandler handler, void* context);
+
+  // 回到初始状态，开始读取新的文档
+  void reset();
+
+  // 处理一段输入，出错后返回false，之后的输入都被忽略
+  bool feed(const char* data, size_t length);
+  // 输入结束，检查文档是否完整
+  bool finish();
+
+  // 出错时的原因和位置（从0开始的字节偏移），没有错误时error()为nullptr
+  const char* error() const {
+    return _error;
+  }
+  size_t errorOffset() const {
+    return _errorOffset;
+  }
+
+private:
+  enum State {
+    STATE_START,        // 等待'{'
+    STATE_FIRST_KEY,    // '{'之后，等待键或'}'
+    STATE_KEY,          // 等待键（','之后）
+    STATE_KEY_STRING,   // 键的内容
+    STATE_COLON,
+    STATE_VALUE,
+    STATE_STRING,       // 字符串值的内容
+    STATE_LITERAL,      // 数字、true、false、null
+    STATE_NESTED,       // 跳过嵌套的值
+    STATE_NEXT,         // 值之后，等待','或'}'
+    STATE_DONE,         // 只允许空白
+    STATE_ERROR
+  };
+
+  bool step(char c);
+  bool stringChar(char c, char* buffer, size_t capacity);
+  bool appendCodePoint(uint32_t codePoint, char* buffer, size_t capacity);
+  bool skipNested(char c);
+  bool emit(WiFiConfigJsonType type);
+  bool fail(const char* reason);
+
+  WiFiConfigJsonHandler _handler;
+  void* _context;
+
+  State _state;
+  size_t _offset;
+  const char* _error;
+  size_t _errorOffset;
+
+  char _key[WIFI_CONFIG_JSON_KEY_MAX + 1];
+  char _value[WIFI_CONFIG_JSON_VALUE_MAX + 1];
+  size_t _length;             // 正在写入的键或值的长度
+
+  // 字符串转义：_escape为0表示普通字符，1表示'\'之后，2到5表示\u之后已读的十六进制位数加1
+  uint8_t _escape;
+  uint16_t _unit;             // 正在读取的\u码元
+  uint16_t _highSurrogate;    // 等待低位代理的高位代理，0表示没有
+
+  // 跳过嵌套值：每层一位，1表示数组
+  uint32_t _nesting;
+  uint8_t _depth;
+  bool _nestedString;
+  bool _nestedEscape;
+  bool _nestedArray;          // 被跳过的顶层值是否为数组
+};
+
+#endif  // WIFI_CONFIG_JSON_H
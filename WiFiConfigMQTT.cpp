@@ -0,0 +1,510 @@
+#include "WiFiConfigMQTT.h"
+#include <WiFi.h>
+#include <lwip/sockets.h>
+#include <errno.h>
+
+// MQTT 3.1.1报文类型
+static const uint8_t MQTT_CONNECT = 0x10;
+static const uint8_t MQTT_CONNACK = 0x20;
+static const uint8_t MQTT_PUBLISH = 0x30;
+static const uint8_t MQTT_PINGREQ = 0xc0;
+static const uint8_t MQTT_PINGRESP = 0xd0;
+
+// 剩余长度的变长编码，返回写入的字节数
+static size_t encodeLength(uint8_t* out, size_t length) {
+  size_t n = 0;
+  do {
+    uint8_t digit = length % 128;
+    length /= 128;
+    out[n++] = digit | (length > 0 ? 0x80 : 0);
+  } while (length > 0);
+  return n;
+}
+
+// 写入带两字节长度前缀的字符串，返回写入的字节数
+static size_t writeString(uint8_t* out, const char* value) {
+  size_t length = strlen(value);
+  out[0] = (uint8_t)(length >> 8);
+  out[1] = (uint8_t)length;
+  memcpy(out + 2, value, length);
+  return length + 2;
+}
+
+WiFiConfigMQTT::WiFiConfigMQTT()
+  : _server(nullptr),
+    _port(1883),
+    _clientID(nullptr),
+    _username(nullptr),
+    _password(nullptr),
+    _keepAlive(30),
+    _policy(MQTT_DROP_OLDEST),
+    _state(MQTT_IDLE),
+    _socket(-1),
+    _stateSince(0),
+    _retryAt(0),
+    _retryDelay(RETRY_MIN),
+    _lastSend(0),
+    _lastReceive(0),
+    _pingPending(false),
+    _resolveResult(RESOLVE_PENDING),
+    _resolvedAddress(0),
+    _address(0),
+    _lookupGeneration(0),
+    _lookupBusy(false),
+    _resolveGeneration(0),
+    _rxType(0),
+    _rxPhase(0),
+    _rxRemaining(0),
+    _rxMultiplier(1),
+    _rxBodyLength(0),
+    _head(0),
+    _used(0),
+    _headSent(0),
+    _first(0),
+    _count(0) {
+  _defaultClientID[0] = '\0';
+  _lookupName[0] = '\0';
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+WiFiConfigMQTT::~WiFiConfigMQTT() {
+  closeSocket();
+}
+
+void WiFiConfigMQTT::begin(const char* server, uint16_t port, const char* clientID, const char* username,
+                           const char* password) {
+  closeSocket();
+  _server = server;
+  _port = port ? port : 1883;
+  _username = username;
+  _password = password;
+
+  if (clientID && clientID[0]) {
+    _clientID = clientID;
+  } else {
+    uint8_t mac[6];
+    WiFi.macAddress(mac);
+    snprintf(_defaultClientID, sizeof(_defaultClientID), "esp32-%02x%02x%02x", mac[3], mac[4], mac[5]);
+    _clientID = _defaultClientID;
+  }
+
+  _state = MQTT_WAITING;
+  _retryDelay = RETRY_MIN;
+  _retryAt = millis();
+}
+
+void WiFiConfigMQTT::stop() {
+  closeSocket();
+  _state = MQTT_IDLE;
+}
+
+void WiFiConfigMQTT::closeSocket() {
+  if (_socket >= 0) {
+    close(_socket);
+    _socket = -1;
+  }
+  // 进行中的域名查询作废，之后到达的结果被忽略
+  _resolveGeneration++;
+  // 未发完的报文在下一次连接时从头重新发送
+  _headSent = 0;
+  _pingPending = false;
+  _rxPhase = 0;
+}
+
+// 连接失败或断开：关闭socket，等待一段时间后重连，等待时间每次加倍
+void WiFiConfigMQTT::fail(const char* reason) {
+  Serial.printf("MQTT: %s, retrying in %lu ms\n", reason, _retryDelay);
+  closeSocket();
+  _stats.failures++;
+  _state = MQTT_WAITING;
+  _retryAt = millis() + _retryDelay;
+  _retryDelay = _retryDelay * 2 > RETRY_MAX ? RETRY_MAX : _retryDelay * 2;
+}
+
+void WiFiConfigMQTT::loop(bool linkUp) {
+  if (_state == MQTT_IDLE) {
+    return;
+  }
+
+  if (!linkUp) {
+    // 链路断开：关闭连接，网络恢复后立即重连
+    if (_state != MQTT_WAITING) {
+      closeSocket();
+      _state = MQTT_WAITING;
+    }
+    _retryAt = millis();
+    _retryDelay = RETRY_MIN;
+    return;
+  }
+
+  switch (_state) {
+    case MQTT_WAITING:
+      if ((long)(millis() - _retryAt) >= 0 && !startResolve()) {
+        fail("connect failed");
+      }
+      break;
+
+    case MQTT_RESOLVING:
+      switch (_resolveResult.load()) {
+        case RESOLVE_FOUND:
+          _address = _resolvedAddress.load();
+          if (!startConnect()) {
+            fail("connect failed");
+          }
+          break;
+        case RESOLVE_FAILED:
+          fail("DNS lookup failed");
+          break;
+        default:
+          if (millis() - _stateSince >= RESOLVE_TIMEOUT) {
+            fail("DNS timeout");
+          }
+          break;
+      }
+      break;
+
+    case MQTT_CONNECTING: {
+      // 检查非阻塞connect()是否完成
+      fd_set writable;
+      FD_ZERO(&writable);
+      FD_SET(_socket, &writable);
+      struct timeval timeout = { 0, 0 };
+      if (select(_socket + 1, nullptr, &writable, nullptr, &timeout) > 0) {
+        int error = 0;
+        socklen_t length = sizeof(error);
+        getsockopt(_socket, SOL_SOCKET, SO_ERROR, &error, &length);
+        if (error != 0) {
+          fail("connection refused");
+        } else if (!sendConnect()) {
+          fail("send failed");
+        } else {
+          _state = MQTT_HANDSHAKE;
+          _stateSince = millis();
+        }
+      } else if (millis() - _stateSince >= CONNECT_TIMEOUT) {
+        fail("connect timeout");
+      }
+      break;
+    }
+
+    case MQTT_HANDSHAKE:
+      readIncoming();
+      if (_state == MQTT_HANDSHAKE && millis() - _stateSince >= CONNECT_TIMEOUT) {
+        fail("no CONNACK");
+      }
+      break;
+
+    case MQTT_CONNECTED:
+      readIncoming();
+      if (_state != MQTT_CONNECTED) {
+        break;
+      }
+      flushQueue();
+      if (_state != MQTT_CONNECTED) {
+        break;
+      }
+
+      // 心跳：空闲超过一半的心跳间隔时发送PINGREQ，超过1.5倍间隔没有回复视为连接失效
+      if (_keepAlive > 0) {
+        unsigned long interval = (unsigned long)_keepAlive * 1000UL;
+        if (_pingPending && millis() - _lastReceive >= interval * 3 / 2) {
+          fail("keepalive timeout");
+        } else if (!_pingPending && millis() - _lastSend >= interval / 2) {
+          const uint8_t ping[2] = { MQTT_PINGREQ, 0 };
+          if (sendAll(ping, sizeof(ping))) {
+            _pingPending = true;
+          }
+        }
+      }
+      break;
+
+    case MQTT_IDLE:
+      break;
+  }
+}
+
+// 确定服务器地址：IP地址直接连接，域名交给lwIP任务解析（已缓存时很快返回），结果在loop()中取走
+bool WiFiConfigMQTT::startResolve() {
+  if (!_server || !_server[0]) {
+    return false;
+  }
+
+  struct in_addr numeric;
+  if (inet_pton(AF_INET, _server, &numeric) == 1) {
+    _address = numeric.s_addr;
+    return startConnect();
+  }
+
+  // 上一次查询还没有从lwIP返回（例如本地超时后lwIP仍在重试），稍后再试
+  size_t length = strlen(_server);
+  if (_lookupBusy || length >= sizeof(_lookupName)) {
+    return false;
+  }
+  memcpy(_lookupName, _server, length + 1);
+  _lookupGeneration = ++_resolveGeneration;
+  _resolveResult = RESOLVE_PENDING;
+  _lookupBusy = true;
+  if (tcpip_callback(lookupInLwip, this) != ERR_OK) {
+    _lookupBusy = false;
+    return false;
+  }
+  _state = MQTT_RESOLVING;
+  _stateSince = millis();
+  return true;
+}
+
+// 在lwIP任务中发起查询；缓存命中或出错时立即得到结果，否则由lwIP稍后调用onResolved()
+void WiFiConfigMQTT::lookupInLwip(void* arg) {
+  WiFiConfigMQTT* self = static_cast<WiFiConfigMQTT*>(arg);
+  ip_addr_t result;
+  err_t err = dns_gethostbyname(self->_lookupName, &result, onResolved, self);
+  if (err != ERR_INPROGRESS) {
+    onResolved(self->_lookupName, err == ERR_OK ? &result : nullptr, self);
+  }
+}
+
+// 解析完成回调，在lwIP任务中执行；查询发起后连接已关闭（超时、停止或更换服务器）时忽略结果
+void WiFiConfigMQTT::onResolved(const char*, const ip_addr_t* ipaddr, void* arg) {
+  WiFiConfigMQTT* self = static_cast<WiFiConfigMQTT*>(arg);
+  if (self->_lookupGeneration == self->_resolveGeneration.load()) {
+    if (ipaddr && IP_IS_V4(ipaddr)) {
+      self->_resolvedAddress = ip_addr_get_ip4_u32(ipaddr);
+      self->_resolveResult = RESOLVE_FOUND;
+    } else {
+      self->_resolveResult = RESOLVE_FAILED;
+    }
+  }
+  self->_lookupBusy = false;
+}
+
+// 向_address发起非阻塞的TCP连接
+bool WiFiConfigMQTT::startConnect() {
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(_port);
+  addr.sin_addr.s_addr = _address;
+
+  _socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  if (_socket < 0) {
+    return false;
+  }
+  fcntl(_socket, F_SETFL, fcntl(_socket, F_GETFL, 0) | O_NONBLOCK);
+  int one = 1;
+  setsockopt(_socket, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  if (connect(_socket, (struct sockaddr*)&addr, sizeof(addr)) != 0 && errno != EINPROGRESS) {
+    return false;
+  }
+  _state = MQTT_CONNECTING;
+  _stateSince = millis();
+  return true;
+}
+
+// 发送CONNECT报文（清除会话）
+bool WiFiConfigMQTT::sendConnect() {
+  bool hasUser = _username && _username[0];
+  bool hasPassword = hasUser && _password && _password[0];
+
+  // 可变头10字节，加上各字符串的长度前缀
+  size_t remaining = 10 + 2 + strlen(_clientID);
+  if (hasUser) remaining += 2 + strlen(_username);
+  if (hasPassword) remaining += 2 + strlen(_password);
+
+  // 客户端ID、用户名和密码的长度受配置记录限制，报文不会超过500字节
+  uint8_t packet[512];
+  size_t n = 0;
+  packet[n++] = MQTT_CONNECT;
+  n += encodeLength(packet + n, remaining);
+  n += writeString(packet + n, "MQTT");
+  packet[n++] = 4;  // 协议级别3.1.1
+  packet[n++] = 0x02 | (hasUser ? 0x80 : 0) | (hasPassword ? 0x40 : 0);
+  packet[n++] = (uint8_t)(_keepAlive >> 8);
+  packet[n++] = (uint8_t)_keepAlive;
+  n += writeString(packet + n, _clientID);
+  if (hasUser) n += writeString(packet + n, _username);
+  if (hasPassword) n += writeString(packet + n, _password);
+
+  _rxPhase = 0;
+  return sendAll(packet, n);
+}
+
+// 发送一段很短的数据（CONNECT、PINGREQ），新连接的发送缓冲区足够容纳
+bool WiFiConfigMQTT::sendAll(const uint8_t* data, size_t length) {
+  ssize_t n = send(_socket, data, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+  if (n != (ssize_t)length) {
+    return false;
+  }
+  _lastSend = millis();
+  return true;
+}
+
+// 读取所有已到达的数据，逐字节解析报文
+void WiFiConfigMQTT::readIncoming() {
+  uint8_t buffer[64];
+  for (;;) {
+    ssize_t n = recv(_socket, buffer, sizeof(buffer), MSG_DONTWAIT);
+    if (n == 0) {
+      fail("connection closed by broker");
+      return;
+    }
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        fail("receive failed");
+      }
+      return;
+    }
+    _lastReceive = millis();
+
+    for (ssize_t i = 0; i < n; i++) {
+      uint8_t b = buffer[i];
+      switch (_rxPhase) {
+        case 0:
+          _rxType = b;
+          _rxRemaining = 0;
+          _rxMultiplier = 1;
+          _rxBodyLength = 0;
+          _rxPhase = 1;
+          break;
+        case 1:
+          _rxRemaining += (b & 0x7f) * _rxMultiplier;
+          _rxMultiplier *= 128;
+          if ((b & 0x80) == 0) {
+            _rxPhase = _rxRemaining > 0 ? 2 : 0;
+            if (_rxRemaining == 0) handlePacket();
+          }
+          break;
+        case 2:
+          if (_rxBodyLength < sizeof(_rxBody)) {
+            _rxBody[_rxBodyLength++] = b;
+          }
+          if (--_rxRemaining == 0) {
+            _rxPhase = 0;
+            handlePacket();
+          }
+          break;
+      }
+      if (_socket < 0) {
+        return;  // handlePacket()中连接已关闭
+      }
+    }
+  }
+}
+
+void WiFiConfigMQTT::handlePacket() {
+  switch (_rxType & 0xf0) {
+    case MQTT_CONNACK:
+      if (_state != MQTT_HANDSHAKE) {
+        break;
+      }
+      if (_rxBodyLength == 2 && _rxBody[1] == 0) {
+        Serial.println("MQTT: connected");
+        _state = MQTT_CONNECTED;
+        _retryDelay = RETRY_MIN;
+        _stats.connects++;
+      } else {
+        fail("connection rejected");
+      }
+      break;
+
+    case MQTT_PINGRESP:
+      _pingPending = false;
+      break;
+
+    default:
+      break;
+  }
+}
+
+// 把队列中连续存放的报文批量交给TCP，发送缓冲区满时留到下一次loop()
+void WiFiConfigMQTT::flushQueue() {
+  while (_count > 0) {
+    size_t offset = (_head + _headSent) % WIFI_CONFIG_MQTT_BUFFER;
+    size_t pending = _used - _headSent;
+    size_t contiguous = WIFI_CONFIG_MQTT_BUFFER - offset;
+    size_t length = pending < contiguous ? pending : contiguous;
+
+    ssize_t n = send(_socket, _ring + offset, length, MSG_DONTWAIT | MSG_NOSIGNAL);
+    if (n < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK) {
+        fail("send failed");
+      }
+      return;
+    }
+    _stats.batches++;
+    _lastSend = millis();
+    consume((size_t)n);
+    if ((size_t)n < length) {
+      return;
+    }
+  }
+}
+
+// 已发出bytes字节，移除完整发出的报文
+void WiFiConfigMQTT::consume(size_t bytes) {
+  _headSent += bytes;
+  while (_count > 0 && _headSent >= _lengths[_first]) {
+    size_t length = _lengths[_first];
+    _headSent -= length;
+    _head = (_head + length) % WIFI_CONFIG_MQTT_BUFFER;
+    _used -= length;
+    _first = (_first + 1) % WIFI_CONFIG_MQTT_MAX_MESSAGES;
+    _count--;
+    _stats.sent++;
+  }
+}
+
+void WiFiConfigMQTT::dropOldest() {
+  size_t length = _lengths[_first];
+  _head = (_head + length) % WIFI_CONFIG_MQTT_BUFFER;
+  _used -= length;
+  _first = (_first + 1) % WIFI_CONFIG_MQTT_MAX_MESSAGES;
+  _count--;
+  _stats.dropped++;
+}
+
+void WiFiConfigMQTT::ringWrite(const void* data, size_t length) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  size_t tail = (_head + _used) % WIFI_CONFIG_MQTT_BUFFER;
+  size_t first = WIFI_CONFIG_MQTT_BUFFER - tail;
+  if (first > length) {
+    first = length;
+  }
+  memcpy(_ring + tail, p, first);
+  memcpy(_ring, p + first, length - first);
+  _used += length;
+}
+
+bool WiFiConfigMQTT::publish(const char* topic, const void* payload, size_t length, bool retain) {
+  size_t topicLength = strlen(topic);
+  size_t remaining = 2 + topicLength + length;
+  uint8_t header[8];
+  size_t headerLength = 0;
+  header[headerLength++] = MQTT_PUBLISH | (retain ? 0x01 : 0);
+  headerLength += encodeLength(header + headerLength, remaining);
+  header[headerLength++] = (uint8_t)(topicLength >> 8);
+  header[headerLength++] = (uint8_t)topicLength;
+  size_t total = headerLength + topicLength + length;
+
+  if (total > WIFI_CONFIG_MQTT_BUFFER || total > 0xffff) {
+    _stats.dropped++;
+    return false;
+  }
+
+  // 队列已满：按策略丢弃最早的消息或拒绝新消息；正在发送的报文不能丢弃
+  while (WIFI_CONFIG_MQTT_BUFFER - _used < total || _count == WIFI_CONFIG_MQTT_MAX_MESSAGES) {
+    if (_policy == MQTT_REJECT_NEW || _count == 0 || _headSent > 0) {
+      _stats.dropped++;
+      return false;
+    }
+    dropOldest();
+  }
+
+  ringWrite(header, headerLength);
+  ringWrite(topic, topicLength);
+  ringWrite(payload, length);
+  _lengths[(_first + _count) % WIFI_CONFIG_MQTT_MAX_MESSAGES] = (uint16_t)total;
+  _count++;
+  _stats.queued++;
+  return true;
+}
@@ -0,0 +1,172 @@
+#ifndef WIFI_CONFIG_MQTT_H
+#define WIFI_CONFIG_MQTT_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <lwip/dns.h>
+#include <lwip/tcpip.h>
+
+// 发送队列的大小（字节）和最多排队的消息数，可以在包含本文件之前定义以修改
+#ifndef WIFI_CONFIG_MQTT_BUFFER
+#define WIFI_CONFIG_MQTT_BUFFER 4096
+#endif
+#ifndef WIFI_CONFIG_MQTT_MAX_MESSAGES
+#define WIFI_CONFIG_MQTT_MAX_MESSAGES 64
+#endif
+
+// 队列已满时的处理方式
+enum WiFiConfigMQTTQueuePolicy {
+  MQTT_DROP_OLDEST,  // 丢弃最早排队的消息，保留最新的读数
+  MQTT_REJECT_NEW    // publish()返回false，由调用者决定稍后重试或放弃
+};
+
+// 只发布（QoS 0）的MQTT 3.1.1客户端
+/*
+  所有操作都是非阻塞的：域名解析、TCP连接、握手、发送和心跳都在loop()中逐步推进，
+  每次调用只检查解析结果和socket状态，不会等待。
+  publish()把消息编码为完整的PUBLISH报文放入固定大小的环形队列，
+  链路断开时消息保留在队列中，恢复后连续的报文用一次send()批量发出。
+*/
+class WiFiConfigMQTT {
+public:
+  enum State {
+    MQTT_IDLE,        // 未配置或已停止
+    MQTT_WAITING,     // 等待网络或下一次重连
+    MQTT_RESOLVING,   // 等待服务器域名的解析结果
+    MQTT_CONNECTING,  // TCP连接进行中
+    MQTT_HANDSHAKE,   // 已发送CONNECT，等待CONNACK
+    MQTT_CONNECTED
+  };
+
+  struct Stats {
+    uint32_t queued;     // 进入队列的消息数
+    uint32_t sent;       // 完整发出的消息数
+    uint32_t dropped;    // 因队列已满被丢弃（或拒绝）的消息数
+    uint32_t batches;    // 发送消息时调用send()的次数
+    uint32_t connects;   // 成功建立的连接数
+    uint32_t failures;   // 连接失败或连接断开的次数
+  };
+
+  WiFiConfigMQTT();
+  ~WiFiConfigMQTT();
+
+  // 设置服务器和登录信息；字符串只保存指针，必须在客户端使用期间保持有效
+  // clientID为空时使用"esp32-"加MAC地址后三个字节
+  void begin(const char* server, uint16_t port, const char* clientID, const char* username,
+             const char* password);
+  // 断开连接并停止，队列中的消息保留
+  void stop();
+
+  // 推进连接状态并发送队列中的消息；linkUp为false时关闭连接，消息继续排队
+  void loop(bool linkUp);
+
+  // 把一条消息放入发送队列，返回是否成功入队
+  bool publish(const char* topic, const void* payload, size_t length, bool retain = false);
+  bool publish(const char* topic, const char* payload, bool retain = false) {
+    return publish(topic, payload, strlen(payload), retain);
+  }
+
+  void setQueuePolicy(WiFiConfigMQTTQueuePolicy policy) {
+    _policy = policy;
+  }
+  // 心跳间隔（秒），在下一次连接时生效
+  void setKeepAlive(uint16_t seconds) {
+    _keepAlive = seconds;
+  }
+
+  State state() const {
+    return _state;
+  }
+  bool connected() const {
+    return _state == MQTT_CONNECTED;
+  }
+  size_t queuedMessages() const {
+    return _count;
+  }
+  size_t queuedBytes() const {
+    return _used;
+  }
+  const Stats& stats() const {
+    return _stats;
+  }
+
+  static const unsigned long CONNECT_TIMEOUT = 5000;
+  static const unsigned long RESOLVE_TIMEOUT = 10000;
+  static const unsigned long RETRY_MIN = 1000;
+  static const unsigned long RETRY_MAX = 30000;
+
+private:
+  bool startResolve();
+  bool startConnect();
+  static void lookupInLwip(void* arg);
+  static void onResolved(const char* name, const ip_addr_t* ipaddr, void* arg);
+  bool sendConnect();
+  void readIncoming();
+  void handlePacket();
+  void flushQueue();
+  void fail(const char* reason);
+  void closeSocket();
+
+  // 环形队列操作
+  void ringWrite(const void* data, size_t length);
+  void dropOldest();
+  void consume(size_t bytes);
+  bool sendAll(const uint8_t* data, size_t length);
+
+  const char* _server;
+  uint16_t _port;
+  const char* _clientID;
+  const char* _username;
+  const char* _password;
+  char _defaultClientID[20];
+  uint16_t _keepAlive;
+  WiFiConfigMQTTQueuePolicy _policy;
+
+  State _state;
+  int _socket;
+  unsigned long _stateSince;     // 进入当前状态的时间
+  unsigned long _retryAt;
+  unsigned long _retryDelay;
+  unsigned long _lastSend;       // 最近一次发送，用于心跳
+  unsigned long _lastReceive;    // 最近一次收到数据，用于判断连接失效
+  bool _pingPending;
+
+  // 异步域名解析：dns_gethostbyname()通过tcpip_callback()在lwIP任务中调用，
+  // 回调同样在lwIP任务中执行，只写入下面的原子变量，由loop()取走
+  enum {
+    RESOLVE_PENDING,
+    RESOLVE_FOUND,
+    RESOLVE_FAILED
+  };
+  std::atomic<uint8_t> _resolveResult;
+  std::atomic<uint32_t> _resolvedAddress;  // 网络字节序
+  uint32_t _address;                      // 本次连接的服务器地址，网络字节序
+  // 交给lwIP任务的查询：名字和代数在发起时确定，_lookupBusy清除之前loop()不再修改
+  // _resolveGeneration在每次发起查询和关闭连接时增加，回调只接受与发起时代数相同的结果，
+  // 超时或更换服务器之后到达的旧结果被忽略，也不会读取可能正在被修改的_server
+  char _lookupName[DNS_MAX_NAME_LENGTH];
+  uint32_t _lookupGeneration;
+  std::atomic<bool> _lookupBusy;
+  std::atomic<uint32_t> _resolveGeneration;
+
+  // 接收解析：只需要CONNACK和PINGRESP，其他报文跳过
+  uint8_t _rxType;               // 固定头的第一个字节
+  uint8_t _rxPhase;              // 0：类型，1：剩余长度，2：内容
+  uint32_t _rxRemaining;         // 内容剩余字节数
+  uint32_t _rxMultiplier;        // 解析剩余长度的变长编码
+  uint8_t _rxBody[2];            // 内容的前两个字节
+  uint8_t _rxBodyLength;
+
+  // 发送队列：报文依次存放在_ring中，_lengths记录每条报文的长度
+  uint8_t _ring[WIFI_CONFIG_MQTT_BUFFER];
+  size_t _head;                  // 最早一条报文的起始位置
+  size_t _used;
+  size_t _headSent;              // 最早一条报文已发出的字节数
+  uint16_t _lengths[WIFI_CONFIG_MQTT_MAX_MESSAGES];
+  size_t _first;                 // _lengths中最早一条的位置
+  size_t _count;
+
+  Stats _stats;
+};
+
+#endif  // WIFI_CONFIG_MQTT_H
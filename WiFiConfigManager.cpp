@@ -1,323 +1,655 @@
 #include "WiFiConfigManager.h"
+#include "WiFiConfigPages.h"
 
 // 初始化静态成员变量
 WiFiConfigManager* WiFiConfigManager::_instance = nullptr;
 
+// 配置日志所在的Flash分区标签，见partitions.csv
+static const char* CONFIG_PARTITION = "wcfg";
+
+// 一次性的启动意图，保存在RTC慢速内存中：软件重启后保留，不需要写Flash
+static const uint32_t BOOT_INTENT_AP = 0x41504D44UL;  // "APMD"
+RTC_NOINIT_ATTR static uint32_t s_bootIntent;
+
+// 读取启动意图；上电或欠压复位后RTC内存内容不确定，视为没有意图
+static uint32_t bootIntent() {
+  esp_reset_reason_t reason = esp_reset_reason();
+  if (reason == ESP_RST_POWERON || reason == ESP_RST_BROWNOUT) {
+    s_bootIntent = 0;
+  }
+  return s_bootIntent;
+}
+
+// 深度睡眠前保存的配置副本，保存在RTC慢速内存中，唤醒后代替存储中的记录
+static const uint32_t SLEEP_STATE_MAGIC = 0x534C5053UL;  // "SLPS"
+struct WiFiConfigSleepState {
+  uint32_t magic;
+  uint32_t crc;             // reuseIP及之后所有字节的CRC32
+  uint8_t reuseIP;          // 唤醒后沿用上次的地址，跳过DHCP
+  uint8_t reserved[3];
+  WiFiConfigRecord config;  // 已封装（wifiConfigSeal）的完整配置，包括上次连接的接入点和地址
+};
+RTC_DATA_ATTR static WiFiConfigSleepState s_sleepState;
+
+static uint32_t sleepStateCrc() {
+  const size_t start = offsetof(WiFiConfigSleepState, reuseIP);
+  return wifiConfigCrc32((const uint8_t*)&s_sleepState + start, sizeof(s_sleepState) - start);
+}
+
+// 读取配置副本，只在深度睡眠唤醒后使用，并且只使用一次；
+// 上电后RTC内存内容不确定，其他复位原因下副本可能已经过时
+static bool restoreSleepState(WiFiConfigRecord& config, bool& reuseIP) {
+  bool valid = esp_reset_reason() == ESP_RST_DEEPSLEEP && s_sleepState.magic == SLEEP_STATE_MAGIC &&
+               s_sleepState.crc == sleepStateCrc() && wifiConfigValidate(s_sleepState.config) == nullptr;
+  s_sleepState.magic = 0;
+  if (!valid) {
+    return false;
+  }
+  config = s_sleepState.config;
+  reuseIP = s_sleepState.reuseIP != 0;
+  return true;
+}
+
+// 在作用域内持有管理器的递归锁；没有启用门户任务时锁为nullptr，不做任何操作
+class WiFiConfigLock {
+public:
+  explicit WiFiConfigLock(SemaphoreHandle_t lock) : _lock(lock) {
+    if (_lock) {
+      xSemaphoreTakeRecursive(_lock, portMAX_DELAY);
+    }
+  }
+  ~WiFiConfigLock() {
+    if (_lock) {
+      xSemaphoreGiveRecursive(_lock);
+    }
+  }
+
+private:
+  SemaphoreHandle_t _lock;
+};
+
 // 构造函数：初始化WiFiConfigManager对象，设置AP模式参数和Web服务器
 WiFiConfigManager::WiFiConfigManager(const char* apSSID,
                                      const char* apPassword,
                                      const char* apDomain,
                                      int eepromSize)
-  : _apSSID(apSSID),              // AP模式的SSID
-    _apPassword(apPassword),      // AP模式的密码
-    _apDomain(apDomain),          // AP模式的域名
-    _eepromSize(eepromSize),      // EEPROM分配大小
+  : _eepromSize(eepromSize),      // EEPROM分配大小
     _shouldConnect(false),        // 是否尝试连接WiFi的标志
     _connectionTimeout(20),       // WiFi连接超时时间（秒）
+    _connState(CONN_IDLE),        // 连接状态机初始为空闲
+    _connectStartTime(0),         // 本次连接开始的时间
+    _retryAt(0),                  // 下一次重试的时间
+    _retryCount(0),               // 已重试次数
+    _candidateCount(0),           // 本轮连接的候选网络数量
+    _candidateIndex(0),           // 正在尝试的候选网络
+    _scanStartTime(0),            // 本轮扫描开始的时间
+    _scanInProgress(false),       // 没有进行中的扫描
+    _scanCacheCount(0),           // 网络列表为空
+    _scanCacheValid(false),       // 尚未扫描过
+    _scanCachedAt(0),             // 网络列表的更新时间
+    _scanRequested(false),        // 没有待发起的扫描
+    _fastReconnect(true),         // 是否使用上次的接入点快速连接
+    _reuseLeaseIP(false),         // 快速连接时是否沿用上次的IP地址
+    _leaseUsable(true),           // 本次启动中缓存的接入点信息是否仍可用
+    _fastAttempt(false),          // 当前连接是否为快速连接
+    _unsavedSuccesses(0),         // 没有未保存的连接统计
+    _maxRetries(0),               // 失败后的最大重试次数
+    _apActive(false),             // AP模式是否已启动
+    _routesRegistered(false),     // 路由尚未注册
+    _serverWanted(false),         // 配置AP启动或连接成功后才需要Web服务器
+    _serverStarted(false),        // Web服务器尚未启动
+    _apTeardownPending(false),    // 没有等待关闭的AP
+    _apTeardownAt(0),             // 关闭AP的时间
+    _reconnecting(false),         // 是否处于断线重连过程中
+    _reconnectFailures(0),        // 连续重连失败的次数
+    _reconnectInitialDelay(1000), // 第一次重连前等待1秒
+    _reconnectMaxDelay(60000),    // 重连间隔最长1分钟
+    _failuresBeforePortal(0),     // 默认一直重连，不打开配置AP
+    _eventHandlerId(0),           // WiFi事件回调尚未注册
+    _pendingEvents(0),            // 没有待处理的WiFi事件
+    _disconnectReason(0),         // 最近一次断开的原因
+    _staConnected(false),         // 尚未获得IP地址
+    _apStations(0),               // 连接到AP的设备数量
+    _saveStage(SAVE_IDLE),        // 没有待处理的保存请求
+    _saveDirty(false),            // 没有待写入的配置
+    _saveReconnect(false),
+    _saveFailed(false),           // 尚未发生写入失败
+    _saveFailedAt(0),
+    _staged(false),               // 没有暂存的配置修改
+    _portalTaskEnabled(false),    // 默认在loop()中处理DNS和HTTP请求
+    _portalTaskCore(0),           // 门户任务运行的核心
+    _portalTaskPriority(1),       // 门户任务的优先级
+    _portalTaskStack(6144),       // 门户任务的栈大小
+    _portalTask(nullptr),         // 门户任务句柄
+    _portalTaskRun(false),        // 门户任务是否应继续运行
+    _portalTaskDone(true),        // 门户任务已经退出
+    _lock(nullptr),               // 共享状态的锁，启用门户任务时创建
+    _announceInterval(10000),     // UDP发现广播间隔10秒
+    _associatedAt(0),             // 尚未关联
+    _gotIPAt(0),                  // 尚未获得IP地址
+    _scanMs(0),                   // 尚未扫描
+    _metricsOnSTA(false),         // 只在配置门户中提供/metrics
+    _updateEnabled(false),        // 默认不提供/update
+    _restartPending(false),
+    _restartAt(0),
+    _storageReady(false),         // 存储在eepromBegin()或第一次保存时打开
+    _restoredFromSleep(false),    // 配置不是从RTC内存恢复的
+    _sleepReuseIP(false),         // 唤醒后是否沿用上次的地址
+    _commitNeeded(false),         // 是否需要提交EEPROM更改的标志
+    _lastCommitTime(0),           // 上次提交EEPROM的时间
     _connectedCallback(nullptr),  // WiFi连接成功的回调函数
     _apModeCallback(nullptr),     // 进入AP模式的回调函数
-    _commitNeeded(false),         // 是否需要提交EEPROM更改的标志
-    _lastCommitTime(0) {          // 上次提交EEPROM的时间
+    _disconnectedCallback(nullptr) {  // 连接断开的回调函数
   _server = new WebServer(80);    // 创建Web服务器实例
-  _dnsServer = new DNSServer();   // 创建DNS服务器实例
+  _dnsServer = new WiFiConfigDNS();  // 创建DNS服务器实例
   _instance = this;               // 设置静态实例指针
+  _apSSID.clear();                // AP模式的SSID
+  _apSSID.assign(apSSID);
+  _apPassword.clear();            // AP模式的密码
+  _apPassword.assign(apPassword);
+  _apDomain.clear();              // AP模式的域名
+  _apDomain.assign(apDomain);
+  wifiConfigReset(_config);       // 配置在eepromBegin()中加载
+}
 
-  // 配置页面的HTML模板，包含CSS和JavaScript
-  _htmlPage = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-    <title>ESP32 WiFi Configuration</title>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <style>
-        body {
-            font-family: Arial, sans-serif;
-            margin: 0;
-            padding: 20px;
-            background-color: #f2f2f2;
-        }
-        .container {
-            background-color: white;
-            border-radius: 8px;
-            padding: 20px;
-            box-shadow: 0 2px 10px rgba(0, 0, 0, 0.1);
-            max-width: 500px;
-            margin: 0 auto;
-        }
-        h1 {
-            color: #0066cc;
-            text-align: center;
-        }
-        h2 {
-            color: #333;
-            margin-top: 20px;
-        }
-        label {
-            display: block;
-            margin-top: 10px;
-            font-weight: bold;
-        }
-        input[type=text], input[type=password], input[type=number] {
-            width: 100%;
-            padding: 10px;
-            margin: 8px 0;
-            display: inline-block;
-            border: 1px solid #ccc;
-            border-radius: 4px;
-            box-sizing: border-box;
-        }
-        input[type=checkbox] {
-            margin-right: 10px;
-        }
-        input[type=submit] {
-            width: 100%;
-            background-color: #4CAF50;
-            color: white;
-            padding: 14px 20px;
-            margin: 8px 0;
-            border: none;
-            border-radius: 4px;
-            cursor: pointer;
-        }
-        input[type=submit]:hover {
-            background-color: #45a049;
-        }
-        .mqtt-config, .udp-config {
-            padding: 10px;
-            border: 1px solid #ddd;
-            border-radius: 5px;
-            margin-top: 10px;
-            background-color: #f9f9f9;
-        }
-        .hidden {
-            display: none;
-        }
-    </style>
-    <script>
-        function toggleMQTT() {
-            var checkbox = document.getElementById('enableMQTT');
-            var mqttConfig = document.getElementById('mqttConfig');
-            mqttConfig.className = checkbox.checked ? 'mqtt-config' : 'mqtt-config hidden';
-        }
+WiFiConfigManager::~WiFiConfigManager() {
+  stopPortalTask();
+  if (_lock) {
+    vSemaphoreDelete(_lock);
+  }
+  if (_eventHandlerId) {
+    WiFi.removeEvent(_eventHandlerId);
+  }
+  delete _server;
+  delete _dnsServer;
+  if (_instance == this) {
+    _instance = nullptr;
+  }
+}
 
-        function toggleUDP() {
-            var checkbox = document.getElementById('enableUDP');
-            var udpConfig = document.getElementById('udpConfig');
-            udpConfig.className = checkbox.checked ? 'udp-config' : 'udp-config hidden';
-        }
-        window.onload = function() {
-            toggleMQTT();
-            toggleUDP();
-        }
-    </script>
-</head>
-<body>
-    <div class="container">
-        <h1>ESP32 WiFi Configuration</h1>
-        <form action="/save" method="post">
-            <h2>WiFi Settings</h2>
-            <label for="ssid">WiFi SSID:</label>
-            <input type="text" id="ssid" name="ssid" placeholder="Enter WiFi name" required>
-
-            <label for="password">WiFi Password:</label>
-            <input type="password" id="password" name="password" placeholder="Enter WiFi password" required>
-
-            <h2>MQTT Configuration</h2>
-            <label>
-                <input type="checkbox" id="enableMQTT" name="enableMQTT" onchange="toggleMQTT()"> Enable MQTT Connection
-            </label>
-
-            <div id="mqttConfig" class="mqtt-config hidden">
-                <label for="mqttServer">MQTT Server Address:</label>
-                <input type="text" id="mqttServer" name="mqttServer" placeholder="e.g., mqtt.example.com">
-
-                <label for="mqttPort">MQTT Port:</label>
-                <input type="number" id="mqttPort" name="mqttPort" placeholder="e.g., 1883">
-
-                <label for="mqttUsername">MQTT Username:</label>
-                <input type="text" id="mqttUsername" name="mqttUsername" placeholder="Enter MQTT username">
-
-                <label for="mqttPassword">MQTT Password:</label>
-                <input type="password" id="mqttPassword" name="mqttPassword" placeholder="Enter MQTT password">
-
-                <label for="mqttClientID">MQTT Client ID:</label>
-                <input type="text" id="mqttClientID" name="mqttClientID" placeholder="Enter MQTT client ID">
-            </div>
-
-            <h2>UDP Broadcast</h2>
-            <label>
-                <input type="checkbox" id="enableUDP" name="enableUDP" onchange="toggleUDP()"> Enable Periodic UDP Broadcast
-            </label>
-
-            <div id="udpConfig" class="udp-config hidden">
-                <label for="udpPort">UDP Broadcast Port:</label>
-                <input type="number" id="udpPort" name="udpPort" placeholder="e.g., 4210">
-
-                <label for="deviceName">Device Name:</label>
-                <input type="text" id="deviceName" name="deviceName" placeholder="Enter device name">
-            </div>
-
-            <input type="submit" value="Save Configuration">
-        </form>
-        <p id="status"></p>
-    </div>
-</body>
-</html>
-)rawliteral";
-
-  // 成功页面的HTML模板
-  _successPage = R"rawliteral(
-<!DOCTYPE html>
-<html>
-<head>
-    <title>Configuration Successful</title>
-    <meta name="viewport" content="width=device-width, initial-scale=1">
-    <style>
-        body {
-            font-family: Arial, sans-serif;
-            margin: 0;
-            padding: 20px;
-            background-color: #f2f2f2;
-            text-align: center;
-        }
-        .container {
-            background-color: white;
-            border-radius: 8px;
-            padding: 20px;
-            box-shadow: 0 2px 10px rgba(0, 0, 0, 0.1);
-            max-width: 500px;
-            margin: 0 auto;
-        }
-        h1 {
-            color: #0066cc;
-        }
-        p {
-            font-size: 16px;
-            line-height: 1.5;
-        }
-    </style>
-</head>
-<body>
-    <div class="container">
-        <h1>WiFi Configuration Successful!</h1>
-        <p>ESP32 will try to connect to the WiFi network you specified.</p>
-        <p>If connection is successful, this AP will shut down.</p>
-        <p>If connection fails, the AP will restart and you can try to configure again.</p>
-    </div>
-</body>
-</html>
-)rawliteral";
-}
-
-// 初始化并启动EEPROM，然后加载配置数据
+// 打开配置存储并加载配置数据；深度睡眠唤醒时使用RTC内存中的副本，不访问存储
 void WiFiConfigManager::eepromBegin() {
+  bool reuseIP;
+  if (restoreSleepState(_config, reuseIP)) {
+    _restoredFromSleep = true;
+    _sleepReuseIP = reuseIP;
+    Serial.println("Configuration restored from RTC memory");
+    return;
+  }
+
+  openStorage();
+
+  // 加载配置数据
+  loadConfig();
+}
+
+// 初始化EEPROM和配置日志分区
+void WiFiConfigManager::openStorage() {
   // 初始化EEPROM，设置预定义大小
   EEPROM.begin(_eepromSize);
-  // 加载配置数据
-  loadConfigFromEEPROM();
+
+  // 优先使用配置日志分区
+  if (_journal.begin(CONFIG_PARTITION)) {
+    Serial.printf("Config journal ready on partition '%s'\n", CONFIG_PARTITION);
+  } else {
+    Serial.printf("Partition '%s' not found, storing configuration in EEPROM\n", CONFIG_PARTITION);
+  }
+  _storageReady = true;
+}
+
+// 加载最新的配置记录，校验失败时使用默认配置
+void WiFiConfigManager::loadConfig() {
+  const char* error;
+
+  // 分区中没有有效记录（全新的分区或残留其他数据）时，按首次启用日志处理
+  if (_journal.isReady() && _journal.hasRecord()) {
+    // 记录可能是旧版本的结构，先读出原始数据再转换
+    uint8_t raw[sizeof(WiFiConfigRecord)];
+    size_t length = _journal.recordLength();
+    error = "no valid journal record";
+    if (length > 0 && length <= sizeof(raw) && _journal.read(raw, length)) {
+      error = wifiConfigLoad(_config, raw, length);
+    }
+  } else {
+    error = loadConfigFromEEPROM();
+
+    // 第一次启用日志分区时，把EEPROM中已有的配置迁移过去
+    if (!error && _journal.isReady() && _journal.append(&_config, sizeof(_config))) {
+      Serial.println("Configuration migrated from EEPROM to journal");
+    }
+
+    // 没有有效记录时可能是旧固件按固定地址保存的配置，导入后立即保存为记录，只导入一次
+    if (error && importLegacyEEPROM()) {
+      error = nullptr;
+    }
+  }
+
+  if (error) {
+    Serial.printf("Stored configuration ignored (%s), using defaults\n", error);
+    wifiConfigReset(_config);
+    return;
+  }
+
+  Serial.println("Configuration data loaded");
+}
+
+// 从EEPROM一次性读取整条配置记录，返回校验失败的原因
+const char* WiFiConfigManager::loadConfigFromEEPROM() {
+  if (CONFIG_ADDR + (int)sizeof(_config) > _eepromSize) {
+    return "EEPROM size too small";
+  }
+
+  uint8_t raw[sizeof(WiFiConfigRecord)];
+  EEPROM.get(CONFIG_ADDR, raw);
+  return wifiConfigLoad(_config, raw, sizeof(raw));
+}
+
+// 从旧的固定地址布局导入配置；保存的记录会覆盖EEPROM中的旧布局（或使日志不再为空），下次启动不再导入
+bool WiFiConfigManager::importLegacyEEPROM() {
+  if (WIFI_CONFIG_LEGACY_SIZE > _eepromSize) {
+    return false;
+  }
+
+  uint8_t legacy[WIFI_CONFIG_LEGACY_SIZE];
+  EEPROM.get(0, legacy);
+  if (wifiConfigImportLegacy(_config, legacy)) {
+    return false;
+  }
+
+  Serial.println("Configuration imported from legacy EEPROM layout");
+  if (!saveConfig()) {
+    Serial.println("Error: failed to save imported configuration");
+  }
+  return true;
+}
+
+// 保存内存中的配置记录：追加到配置日志，或整体写入EEPROM并提交
+bool WiFiConfigManager::saveConfig() {
+  if (!_storageReady) {
+    openStorage();
+  }
+  wifiConfigSeal(_config);
+  _unsavedSuccesses = 0;  // 整条记录写入，内存中的连接统计随之保存
+
+  if (_journal.isReady()) {
+    if (!_journal.append(&_config, sizeof(_config))) {
+      Serial.println("Error: failed to append configuration to journal");
+      return false;
+    }
+    WiFiConfigCounters::add(_counters.flashCommits);
+    WiFiConfigCounters::add(_counters.flashBytes, sizeof(_config));
+    return true;
+  }
+
+  if (CONFIG_ADDR + (int)sizeof(_config) > _eepromSize) {
+    Serial.println("Error: EEPROM size too small for configuration record");
+    return false;
+  }
+
+  EEPROM.put(CONFIG_ADDR, _config);
+  _commitNeeded = true;
+  _lastCommitTime = millis();
+  commitEEPROM();
+  return true;
+}
+
+// 以下是字段表（WIFI_CONFIG_FIELD_TABLE）中各类字段的操作，按字段类型在编译时选择
+
+// 从表单参数更新一个字段，返回值表示内容是否发生变化
+template <size_t N>
+static bool readField(WiFiConfigString<N>& field, const String& value) {
+  if (value.length() > field.capacity()) {
+    Serial.println("Warning: Data length exceeds limit, will be truncated");
+  }
+  return field.assign(value.c_str(), value.length());
+}
+
+// 端口号无效时为0
+static bool readField(uint16_t& field, const String& value) {
+  long port = value.toInt();
+  uint16_t parsed = (port > 0 && port <= 65535) ? (uint16_t)port : 0;
+  if (parsed == field) {
+    return false;
+  }
+  field = parsed;
+  return true;
+}
+
+// 输出输入框中与字段类型相关的属性和当前值
+// 密码（secret）只输出长度限制，已保存的内容不发回浏览器，提交空值表示保持不变
+template <size_t N>
+static void writeField(WiFiConfigChunkWriter& out, const WiFiConfigString<N>& field, bool secret) {
+  out.print(" maxlength=\"");
+  out.print((unsigned long)field.capacity());
+  out.print("\" value=\"");
+  if (!secret) {
+    out.printEscaped(field.c_str());
+  }
+  out.print("\"");
+}
+
+// 端口为0表示未设置，输出空值让页面显示默认提示
+static void writeField(WiFiConfigChunkWriter& out, uint16_t field, bool) {
+  out.print(" min=\"1\" max=\"65535\" value=\"");
+  if (field) {
+    out.print((unsigned long)field);
+  }
+  out.print("\"");
+}
+
+template <size_t N>
+static void printField(const char* name, const WiFiConfigString<N>& field) {
+  Serial.printf("%s: %s\n", name, field.c_str());
+}
+
+static void printField(const char* name, uint16_t field) {
+  Serial.printf("%s: %u\n", name, field);
+}
+
+// 占位符名称比较，名称长度在编译时确定
+template <size_t N>
+static bool nameEquals(const char* name, size_t nameLength, const char (&expected)[N]) {
+  return nameLength == N - 1 && memcmp(name, expected, N - 1) == 0;
+}
+
+// 从JSON成员值更新一个字段；类型或长度不符时返回错误原因，不截断
+template <size_t N>
+static const char* readJsonField(WiFiConfigString<N>& field, WiFiConfigJsonType valueType, const char* value,
+                                 size_t length) {
+  if (valueType != JSON_STRING) {
+    return "expected string";
+  }
+  if (length > field.capacity()) {
+    return "string too long";
+  }
+  field.assign(value, length);
+  return nullptr;
+}
+
+// 端口号必须是0到65535的整数，0表示未设置
+static const char* readJsonField(uint16_t& field, WiFiConfigJsonType valueType, const char* value, size_t length) {
+  if (valueType != JSON_NUMBER) {
+    return "expected number";
+  }
+  unsigned long port = 0;
+  for (size_t i = 0; i < length; i++) {
+    if (value[i] < '0' || value[i] > '9') {
+      return "expected integer";
+    }
+    port = port * 10 + (value[i] - '0');
+    if (port > 65535) {
+      return "port out of range";
+    }
+  }
+  field = (uint16_t)port;
+  return nullptr;
+}
+
+template <size_t N>
+static void writeJsonField(WiFiConfigChunkWriter& out, const WiFiConfigString<N>& field) {
+  out.printJsonString(field.c_str());
 }
 
-// 从EEPROM读取并加载所有配置数据到内存中
-void WiFiConfigManager::loadConfigFromEEPROM() {
-  // 读取WiFi凭据
-  _targetSSID = readFromEEPROM(SSID, 32);
-  _targetPassword = readFromEEPROM(PASS, 32);
+static void writeJsonField(WiFiConfigChunkWriter& out, uint16_t field) {
+  out.print((unsigned long)field);
+}
+
+// PUT /api/config的一次更新：成员先应用到配置记录的副本上，整个文档解析成功后才替换
+struct WiFiConfigUpdate {
+  WiFiConfigRecord config;
+  decltype(WiFiConfigNetwork::ssid) ssid;
+  decltype(WiFiConfigNetwork::password) password;
+  bool hasSSID;
+  bool hasPassword;
+  char rejectedKey[WIFI_CONFIG_JSON_KEY_MAX + 1];  // 被拒绝的成员名，用于错误回复
+};
+
+// 应用JSON请求体的一个顶层成员，成员名与表单参数名相同
+static const char* applyConfigMember(WiFiConfigUpdate& update, const char* key, WiFiConfigJsonType valueType,
+                                     const char* value, size_t length) {
+  size_t keyLength = strlen(key);
+
+  // 网络在整个文档解析完成后加入列表，与成员的顺序无关
+  if (nameEquals(key, keyLength, "ssid")) {
+    if (valueType != JSON_STRING) return "expected string";
+    if (length == 0 || length > update.ssid.capacity()) return "invalid ssid length";
+    update.ssid.assign(value, length);
+    update.hasSSID = true;
+    return nullptr;
+  }
+  if (nameEquals(key, keyLength, "password")) {
+    const char* error = readJsonField(update.password, valueType, value, length);
+    update.hasPassword = error == nullptr;
+    return error;
+  }
+  // GET返回的只读成员，把读到的配置原样提交时忽略
+  if (nameEquals(key, keyLength, "networks")) {
+    return nullptr;
+  }
+
+  // 记录是紧凑排列的，字段先复制出来再更新，避免引用未对齐的成员
+#define WIFI_CONFIG_JSON_READ_FIELD(type, member, formName, placeholder, inputType, group) \
+  if (nameEquals(key, keyLength, formName)) { \
+    type field = update.config.member; \
+    const char* error = readJsonField(field, valueType, value, length); \
+    if (!error) { \
+      update.config.member = field; \
+    } \
+    return error; \
+  }
+#define WIFI_CONFIG_JSON_READ_FLAG(bit, formName, placeholder) \
+  if (nameEquals(key, keyLength, formName)) { \
+    if (valueType != JSON_TRUE && valueType != JSON_FALSE) return "expected boolean"; \
+    if (valueType == JSON_TRUE) { \
+      update.config.flags |= (bit); \
+    } else { \
+      update.config.flags &= ~(bit); \
+    } \
+    return nullptr; \
+  }
+#define WIFI_CONFIG_JSON_READ_FLAGS(member) WIFI_CONFIG_FLAG_TABLE(WIFI_CONFIG_JSON_READ_FLAG)
+  WIFI_CONFIG_FIELD_TABLE(WIFI_CONFIG_JSON_READ_FIELD, WIFI_CONFIG_JSON_READ_FLAGS)
+#undef WIFI_CONFIG_JSON_READ_FIELD
+#undef WIFI_CONFIG_JSON_READ_FLAG
+#undef WIFI_CONFIG_JSON_READ_FLAGS
 
-  // 读取MQTT配置
-  _mqttEnabled = readFromEEPROM(MQTT_ENABLE, 1);
-  _mqttClientID = readFromEEPROM(MQTT_DEVICE_ID, 100);
-  _mqttServer = readFromEEPROM(MQTT_SERVER, 31);
-  _mqttPort = readFromEEPROM(MQTT_PORT, 5);
-  _mqttUsername = readFromEEPROM(MQTT_USERNAME, 100);
-  _mqttPassword = readFromEEPROM(MQTT_PASSWD, 256);
+  return "unknown field";
+}
 
-  // 读取UDP配置
-  _udpEnabled = readFromEEPROM(UDP_ENABLE, 1);
-  _deviceName = readFromEEPROM(UDP_DEVICE_NAME, 31);
-  _udpPort = readFromEEPROM(UDP_PORT, 5);
+static const char* onConfigMember(void* context, const char* key, WiFiConfigJsonType valueType, const char* value,
+                                  size_t length) {
+  WiFiConfigUpdate& update = *static_cast<WiFiConfigUpdate*>(context);
+  const char* error = applyConfigMember(update, key, valueType, value, length);
+  if (error) {
+    strncpy(update.rejectedKey, key, sizeof(update.rejectedKey) - 1);
+    update.rejectedKey[sizeof(update.rejectedKey) - 1] = '\0';
+  }
+  return error;
+}
 
-  Serial.println("Configuration data loaded from EEPROM");
+// 正在接收的PUT /api/config请求：请求体每收到一段就交给读取器，不保存整个文档
+// WebServer一次只处理一个请求，只需要一份
+static WiFiConfigUpdate s_configUpdate;
+static WiFiConfigJsonReader s_configReader(onConfigMember, &s_configUpdate);
+static bool s_configUpdateActive = false;
+
+static void beginConfigUpdate(const WiFiConfigRecord& config) {
+  s_configUpdate.config = config;
+  s_configUpdate.ssid.clear();
+  s_configUpdate.password.clear();
+  s_configUpdate.hasSSID = false;
+  s_configUpdate.hasPassword = false;
+  memset(s_configUpdate.rejectedKey, 0, sizeof(s_configUpdate.rejectedKey));
+  s_configReader.reset();
+  s_configUpdateActive = true;
 }
 
 // 强制设备进入AP配置模式，通常用于重置设置或首次配置
 void WiFiConfigManager::forceEnterAPConfigMode() {
   // 检查当前模式，如果不是AP模式则切换
-  if (EEPROM.read(AP_MOD) != 1) {
+  if (bootIntent() != BOOT_INTENT_AP) {
     Serial.println("Resetting to AP Configuration mode");
-    EEPROM.write(AP_MOD, 1);  // 标记为AP模式
-    EEPROM.commit();          // 确保数据写入EEPROM
-    ESP.restart();            // 重启设备以应用更改
+    s_bootIntent = BOOT_INTENT_AP;  // 标记为AP模式，只写RTC内存
+    ESP.restart();                  // 重启设备以应用更改
   }
 }
 
 // 开始WiFiConfigManager的主要功能，尝试连接WiFi或启动AP模式
 void WiFiConfigManager::begin() {
+  // 订阅WiFi事件，连接状态由事件驱动
+  if (!_eventHandlerId) {
+    _eventHandlerId = WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t info) {
+      onWiFiEvent(event, info);
+    });
+  }
+
+  // 启用时启动门户任务，之后的初始化在锁内进行
+  startPortalTask();
+  WiFiConfigLock lock(_lock);
+
+  // 断线重连由loop()中的状态机按退避策略进行，关闭驱动的自动重连，避免两者同时发起连接
+  WiFi.setAutoReconnect(false);
+
   // 首先检查是否需要强制进入AP模式
-  uint8_t apMode = EEPROM.read(AP_MOD);
-  if (apMode == 1) {
+  if (bootIntent() == BOOT_INTENT_AP) {
     Serial.println("Forced into AP Configuration mode");
-    setupAPMode();
     // 重置AP模式标记，下次启动将尝试正常连接
-    EEPROM.write(AP_MOD, 0);
-    EEPROM.commit();
+    s_bootIntent = 0;
+    setupAPMode();
     return;  // 提前返回，不继续执行后续代码
   }
 
+  configureMQTT();
+
   // 检查是否有保存的WiFi凭据
-  if (_targetSSID.length() > 0) {
+  // 连接在后台进行，结果由loop()中的状态机处理，begin()不会阻塞
+  if (wifiConfigNetworkCount(_config) > 0) {
+    _retryCount = 0;
     connectToWiFi();
   } else {
     Serial.println("No saved WiFi credentials found");
     setupAPMode();
-    return;
-  }
-
-  // 如果连接失败，启动AP模式
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi connection failed, starting AP mode");
-    setupAPMode();
-  } else {
-    Serial.println("WiFi connection successful");
-    if (_connectedCallback) {
-      _connectedCallback();
-    }
   }
 }
 
 // 循环处理DNS请求、HTTP请求和WiFi连接状态
 void WiFiConfigManager::loop() {
-  // 处理DNS请求
-  if (WiFi.getMode() == WIFI_AP || WiFi.getMode() == WIFI_AP_STA) {
-    _dnsServer->processNextRequest();
-  }
+  WiFiConfigLock lock(_lock);
+  uint32_t loopStart = micros();
 
-  // 处理HTTP请求
-  _server->handleClient();
+  // 继续处理之前的保存请求，放在处理新请求之前，保证回复已经发送完毕
+  processSave();
+
+  // 处理DNS和HTTP请求；启用门户任务时由该任务处理
+  if (!_portalTask) {
+    servicePortal();
+  }
 
-  // 如果收到新的WiFi配置，尝试连接
+  // 如果收到新的WiFi配置，发起新的连接
   if (_shouldConnect) {
     _shouldConnect = false;
+    _retryCount = 0;
+    _reconnecting = false;
+    _leaseUsable = false;  // 新配置的网络排在最前面，不使用旧的接入点信息
     connectToWiFi();
+  }
 
-    // 如果连接成功，关闭AP模式
-    if (WiFi.status() == WL_CONNECTED) {
-      WiFi.softAPdisconnect(true);
-      Serial.println("AP mode disabled after successful connection");
+  // 推进连接状态机
+  updateConnection();
 
-      // 触发连接成功回调
-      if (_connectedCallback) {
-        _connectedCallback();
-      }
-    } else {
-      // 如果连接失败，重新启动AP模式
-      setupAPMode();
-    }
+  // 配置页面请求的扫描；正在连接时扫描会干扰连接，等连接结束后再发起
+  if (_scanRequested && _connState != CONN_CONNECTING) {
+    _scanRequested = false;
+    startScan();
+  }
+
+  // UDP发现广播
+  if (_connState == CONN_CONNECTED) {
+    _announcer.loop();
+  }
+
+  // MQTT连接和发送队列，链路断开时消息继续排队
+  _mqtt.loop(_connState == CONN_CONNECTED);
+
+  // 连接成功且宽限期已过，关闭配置AP
+  if (_apTeardownPending && _connState == CONN_CONNECTED && (long)(millis() - _apTeardownAt) >= 0) {
+    stopAPMode();
   }
 
   // 检查是否需要提交EEPROM更改
   if (_commitNeeded && (millis() - _lastCommitTime > COMMIT_INTERVAL)) {
     commitEEPROM();
   }
+
+  // 新固件已激活，回复发出后重启；重启前写入未提交的EEPROM更改
+  if (_restartPending && (long)(millis() - _restartAt) >= 0) {
+    if (_commitNeeded) {
+      commitEEPROM();
+    }
+    Serial.println("Restarting into new firmware");
+    ESP.restart();
+  }
+
+  _counters.loop.record(micros() - loopStart);
+}
+
+// 处理所有已到达的DNS查询（最多DNS_BUDGET个）和一个HTTP请求
+// handleClient()读取请求时可能要等待客户端，期间不持有锁，处理函数在runHandler()中加锁
+void WiFiConfigManager::servicePortal() {
+  {
+    WiFiConfigLock lock(_lock);
+    if (_apActive) {
+      uint32_t start = micros();
+      if (_dnsServer->process(DNS_BUDGET) > 0) {
+        _counters.dns.record(micros() - start);
+      }
+    }
+    updateWebServer();
+  }
+  _server->handleClient();
+}
+
+// 启动门户任务，处理函数在任务中持有锁执行
+void WiFiConfigManager::startPortalTask() {
+  if (!_portalTaskEnabled || _portalTask) {
+    return;
+  }
+  if (!_lock) {
+    _lock = xSemaphoreCreateRecursiveMutex();
+  }
+
+  _portalTaskRun = true;
+  _portalTaskDone = false;
+  if (xTaskCreatePinnedToCore(portalTaskMain, "wcfg_portal", _portalTaskStack, this, _portalTaskPriority,
+                              &_portalTask, _portalTaskCore) != pdPASS) {
+    Serial.println("Error: failed to create portal task, serving portal from loop()");
+    _portalTask = nullptr;
+    _portalTaskRun = false;
+    _portalTaskDone = true;
+  }
+}
+
+// 通知门户任务退出并等待其结束
+void WiFiConfigManager::stopPortalTask() {
+  if (!_portalTask) {
+    return;
+  }
+  _portalTaskRun = false;
+  while (!_portalTaskDone) {
+    vTaskDelay(PORTAL_TASK_INTERVAL);
+  }
+  _portalTask = nullptr;
+}
+
+// 门户任务：每隔PORTAL_TASK_INTERVAL处理一次DNS和HTTP请求
+void WiFiConfigManager::portalTaskMain(void* arg) {
+  WiFiConfigManager* self = static_cast<WiFiConfigManager*>(arg);
+  while (self->_portalTaskRun) {
+    self->servicePortal();
+    vTaskDelay(PORTAL_TASK_INTERVAL);
+  }
+  self->_portalTaskDone = true;
+  vTaskDelete(nullptr);
 }
 
 // 提交EEPROM更改，减少频繁写入对EEPROM的损耗
@@ -326,18 +658,21 @@ void WiFiConfigManager::commitEEPROM() {
     Serial.println("Committing EEPROM changes");
     EEPROM.commit();
     _commitNeeded = false;
+    // EEPROM模拟区每次提交整体重写
+    WiFiConfigCounters::add(_counters.flashCommits);
+    WiFiConfigCounters::add(_counters.flashBytes, _eepromSize);
     _lastCommitTime = millis();
   }
 }
 
 // 检查WiFi连接状态
 bool WiFiConfigManager::isConnected() {
-  return WiFi.status() == WL_CONNECTED;
+  return _staConnected.load();
 }
 
 // 获取设备当前IP地址，根据工作模式返回不同的IP
 IPAddress WiFiConfigManager::getIP() {
-  if (WiFi.getMode() == WIFI_STA) {
+  if (_staConnected.load()) {
     return WiFi.localIP();
   } else {
     return WiFi.softAPIP();
@@ -349,29 +684,26 @@ bool WiFiConfigManager::setWiFiCredentials(const String& ssid, const String& pas
   if (ssid.length() == 0) {
     return false;
   }
-
-  _targetSSID = ssid;
-  _targetPassword = password;
+  WiFiConfigLock lock(_lock);
 
   // 将WiFi凭据保存到EEPROM
   bool success = true;
-  success &= writeToEEPROM(SSID, _targetSSID, 32);
-  success &= writeToEEPROM(PASS, _targetPassword, 32);
-
-  commitEEPROM();
+  bool changed = wifiConfigAddNetwork(_config, ssid.c_str(), ssid.length(), password.c_str(), password.length());
+  if (changed) {
+    success = saveConfig();
+  }
 
   _shouldConnect = true;
   return success;
 }
 
-// 清除保存的WiFi凭据
+// 清除保存的所有WiFi网络
 void WiFiConfigManager::clearWiFiCredentials() {
-  writeToEEPROM(SSID, "", 32);
-  writeToEEPROM(PASS, "", 32);
-  commitEEPROM();
-
-  _targetSSID = "";
-  _targetPassword = "";
+  WiFiConfigLock lock(_lock);
+  if (wifiConfigNetworkCount(_config) > 0) {
+    memset(_config.networks, 0, sizeof(_config.networks));
+    saveConfig();
+  }
 }
 
 // 设置WiFi连接超时时间
@@ -379,6 +711,80 @@ void WiFiConfigManager::setConnectionTimeout(int seconds) {
   _connectionTimeout = seconds;
 }
 
+// 设置门户任务的参数，在begin()中启动
+void WiFiConfigManager::setPortalTask(bool enable, BaseType_t core, UBaseType_t priority, uint32_t stackSize) {
+  _portalTaskEnabled = enable;
+  _portalTaskCore = core;
+  _portalTaskPriority = priority;
+  _portalTaskStack = stackSize;
+}
+
+// 设置UDP发现广播的间隔
+void WiFiConfigManager::setAnnounceInterval(unsigned long intervalMs) {
+  _announceInterval = intervalMs;
+}
+
+// 设置是否使用上次连接的接入点和地址快速连接
+void WiFiConfigManager::setFastReconnect(bool enable, bool reuseIP) {
+  _fastReconnect = enable;
+  _reuseLeaseIP = reuseIP;
+}
+
+// 把消息放入MQTT发送队列，由loop()发出
+bool WiFiConfigManager::publish(const char* topic, const char* payload, bool retain) {
+  return publish(topic, payload, strlen(payload), retain);
+}
+
+bool WiFiConfigManager::publish(const char* topic, const void* payload, size_t length, bool retain) {
+  WiFiConfigLock lock(_lock);
+  return _mqtt.publish(topic, payload, length, retain);
+}
+
+// 设置MQTT发送队列已满时的处理方式
+void WiFiConfigManager::setMQTTQueuePolicy(WiFiConfigMQTTQueuePolicy policy) {
+  _mqtt.setQueuePolicy(policy);
+}
+
+// 保存配置副本后进入深度睡眠；持有锁直到睡眠，门户任务不会再修改配置
+void WiFiConfigManager::deepSleep(uint32_t durationMs, bool reuseIP) {
+  WiFiConfigLock lock(_lock);
+
+  // 等待写入的配置先保存，RTC内存中的副本在断电后丢失
+  if (_saveDirty) {
+    _saveDirty = !saveConfig();
+  }
+  if (_commitNeeded) {
+    commitEEPROM();
+  }
+  _mqtt.stop();
+
+  s_sleepState.config = _config;
+  wifiConfigSeal(s_sleepState.config);
+  s_sleepState.reuseIP = reuseIP ? 1 : 0;
+  memset(s_sleepState.reserved, 0, sizeof(s_sleepState.reserved));
+  s_sleepState.crc = sleepStateCrc();
+  s_sleepState.magic = SLEEP_STATE_MAGIC;
+
+  if (durationMs > 0) {
+    esp_sleep_enable_timer_wakeup((uint64_t)durationMs * 1000);
+  }
+  Serial.printf("Entering deep sleep for %lu ms\n", (unsigned long)durationMs);
+  Serial.flush();
+  esp_deep_sleep_start();
+}
+
+// 设置连接失败后的重试次数
+void WiFiConfigManager::setConnectionRetries(int retries) {
+  _maxRetries = retries < 0 ? 0 : retries;
+}
+
+// 设置断线重连的退避策略
+void WiFiConfigManager::setReconnectPolicy(unsigned long initialDelayMs, unsigned long maxDelayMs, int failuresBeforePortal) {
+  _reconnectInitialDelay = initialDelayMs > 0 ? initialDelayMs : 1;
+  _reconnectMaxDelay = maxDelayMs > _reconnectInitialDelay ? maxDelayMs : _reconnectInitialDelay;
+  _failuresBeforePortal = failuresBeforePortal < 0 ? 0 : failuresBeforePortal;
+}
+
 // 设置WiFi连接成功后的回调函数
 void WiFiConfigManager::setConnectedCallback(void (*callback)()) {
   _connectedCallback = callback;
@@ -389,8 +795,21 @@ void WiFiConfigManager::setAPModeCallback(void (*callback)()) {
   _apModeCallback = callback;
 }
 
+// 设置连接断开后的回调函数
+void WiFiConfigManager::setDisconnectedCallback(void (*callback)(uint8_t reason)) {
+  _disconnectedCallback = callback;
+}
+
 // 设置AP模式的配置，启动DNS和HTTP服务器
+// AP已经在运行时（AP+STA模式下连接失败）保持现有的AP、DNS和路由，手机不需要重新连接
 void WiFiConfigManager::setupAPMode() {
+  _apTeardownPending = false;
+  if (_apActive) {
+    Serial.println("Configuration portal still active");
+    WiFi.mode(WIFI_AP);  // 停止STA，AP继续工作
+    return;
+  }
+
   Serial.println("Setting up AP mode");
   WiFi.mode(WIFI_AP);
   WiFi.softAP(_apSSID.c_str(), _apPassword.c_str());
@@ -400,17 +819,12 @@ void WiFiConfigManager::setupAPMode() {
   Serial.println(IP);
 
   // 设置DNS服务器，将所有域名请求重定向到AP的IP
-  _dnsServer->start(DNS_PORT, "*", IP);
+  _dnsServer->start(DNS_PORT, IP);
   Serial.println("DNS server started");
-  Serial.println("Domain: " + _apDomain);
-
-  // 配置Web服务器路由
-  _server->on("/", HTTP_GET, handleRootWrapper);
-  _server->on("/save", HTTP_POST, handleSaveWrapper);
-  _server->onNotFound(handleNotFoundWrapper);
+  Serial.printf("Domain: %s\n", _apDomain.c_str());
 
-  _server->begin();
-  Serial.println("HTTP server started");
+  startWebServer();
+  _apActive = true;
 
   // 触发AP模式回调
   if (_apModeCallback) {
@@ -418,276 +832,1187 @@ void WiFiConfigManager::setupAPMode() {
   }
 }
 
-// 尝试连接到配置的WiFi网络
-void WiFiConfigManager::connectToWiFi() {
-  Serial.println("Connecting to WiFi...");
-  Serial.println("SSID: " + _targetSSID);
-  Serial.println("Password: " + _targetPassword);
-
-  WiFi.mode(WIFI_STA);
-  WiFi.begin(_targetSSID.c_str(), _targetPassword.c_str());
+// 关闭配置AP和DNS服务，保留STA连接
+// Web服务器同时停止；启用了局域网/metrics时服务器继续运行，但配置页面、/save、/api/config和/scan回复403
+void WiFiConfigManager::stopAPMode() {
+  _apTeardownPending = false;
+  if (!_apActive) {
+    return;
+  }
+  Serial.println("Stopping configuration portal");
+  _dnsServer->stop();
+  WiFi.softAPdisconnect(true);
+  _apActive = false;
 
-  // 尝试连接，根据设置的超时时间
-  int timeout = _connectionTimeout;
-  while (WiFi.status() != WL_CONNECTED && timeout > 0) {
-    delay(1000);
-    Serial.print(".");
-    timeout--;
+  if (!_metricsOnSTA) {
+    stopWebServer();
   }
+}
 
-  if (WiFi.status() == WL_CONNECTED) {
-    Serial.println("\nWiFi connection successful!");
-    Serial.print("IP address: ");
-    Serial.println(WiFi.localIP());
+// 请求启动或停止Web服务器；启用门户任务时由该任务在下一轮执行，不与handleClient()同时操作服务器
+void WiFiConfigManager::startWebServer() {
+  _serverWanted = true;
+  if (!_portalTask) {
+    updateWebServer();
+  }
+}
 
-    // 触发连接成功回调
-    if (_connectedCallback) {
-      _connectedCallback();
-    }
-  } else {
-    Serial.println("\nWiFi connection failed!");
+void WiFiConfigManager::stopWebServer() {
+  _serverWanted = false;
+  if (!_portalTask) {
+    updateWebServer();
   }
 }
 
-// 处理配置Web界面的根路径请求，显示配置页面
-void WiFiConfigManager::handleRoot() {
-  // 准备HTML模板
-  String html = _htmlPage;
-
-  // 替换模板中的占位符，填充当前配置值
-  // html.replace("%SSID%", _targetSSID);
-  // html.replace("%PASSWORD%", _targetPassword);
-  // html.replace("%MQTT_CHECKED%", _mqttEnabled == "1" ? "checked" : "");
-  // html.replace("%MQTT_SERVER%", _mqttServer);
-  // html.replace("%MQTT_PORT%", _mqttPort);
-  // html.replace("%MQTT_USERNAME%", _mqttUsername);
-  // html.replace("%MQTT_PASSWORD%", _mqttPassword);
-  // html.replace("%MQTT_CLIENT_ID%", _mqttClientID);
-  // html.replace("%UDP_CHECKED%", _udpEnabled == "1" ? "checked" : "");
-  // html.replace("%UDP_PORT%", _udpPort);
-  // html.replace("%DEVICE_NAME%", _deviceName);
-
-  _server->send(200, "text/html", html);
-}
-
-// 处理保存配置的请求，将配置写入EEPROM并尝试连接WiFi
-void WiFiConfigManager::handleSave() {
-  bool configChanged = false;
+// 按_serverWanted启动或停止Web服务器，路由在第一次启动时注册，之后停止再启动时沿用
+void WiFiConfigManager::updateWebServer() {
+  if (_serverWanted == _serverStarted) {
+    return;
+  }
+  if (!_serverWanted) {
+    _server->stop();
+    _serverStarted = false;
+    Serial.println("HTTP server stopped");
+    return;
+  }
+  if (_routesRegistered) {
+    _server->begin();
+    _serverStarted = true;
+    Serial.println("HTTP server started");
+    return;
+  }
 
-  if (_server->hasArg("ssid") && _server->hasArg("password")) {
-    // 获取WiFi配置
-    String newSSID = _server->arg("ssid");
-    String newPassword = _server->arg("password");
-
-    // 检查是否有变化
-    if (newSSID != _targetSSID || newPassword != _targetPassword) {
-      _targetSSID = newSSID;
-      _targetPassword = newPassword;
-
-      // 保存到EEPROM
-      writeToEEPROM(SSID, _targetSSID, 32);
-      writeToEEPROM(PASS, _targetPassword, 32);
-      configChanged = true;
-    }
-
-    // 获取并保存MQTT配置
-    bool enableMQTT = _server->hasArg("enableMQTT");
-    String mqttEnabled = enableMQTT ? "1" : "0";
-
-    if (mqttEnabled != _mqttEnabled) {
-      _mqttEnabled = mqttEnabled;
-      writeToEEPROM(MQTT_ENABLE, _mqttEnabled, 1);
-      configChanged = true;
-    }
-
-    // 如果启用了MQTT，获取相关参数
-    if (enableMQTT) {
-      String mqttServer = _server->arg("mqttServer");
-      String mqttPort = _server->arg("mqttPort");
-      String mqttUsername = _server->arg("mqttUsername");
-      String mqttPassword = _server->arg("mqttPassword");
-      String mqttClientID = _server->arg("mqttClientID");
-
-      // 检查是否有变化并保存
-      if (mqttServer != _mqttServer) {
-        _mqttServer = mqttServer;
-        writeToEEPROM(MQTT_SERVER, _mqttServer, 31);
-        configChanged = true;
-      }
+  // 记录缓存校验需要的请求头
+  static const char* headerKeys[] = { "If-None-Match" };
+  _server->collectHeaders(headerKeys, 1);
+  _server->on("/", HTTP_GET, handleRootWrapper);
+  _server->on("/style.css", HTTP_GET, handleStyleWrapper);
+  _server->on("/save", HTTP_POST, handleSaveWrapper);
+  _server->on("/status", HTTP_GET, handleStatusWrapper);
+  _server->on("/metrics", HTTP_GET, handleMetricsWrapper);
+  _server->on("/scan", HTTP_GET, handleScanWrapper);
+  _server->on("/api/config", HTTP_GET, handleGetConfigWrapper);
+  _server->on("/api/config", HTTP_PUT, handlePutConfigWrapper, handlePutConfigBodyWrapper);
+  if (_updateEnabled) {
+    _server->on("/update", HTTP_POST, handleUpdateWrapper, handleUpdateUploadWrapper);
+    _server->on("/update", HTTP_GET, handleUpdateStatusWrapper);
+  }
+  _server->onNotFound(handleNotFoundWrapper);
 
-      if (mqttPort != _mqttPort) {
-        _mqttPort = mqttPort;
-        writeToEEPROM(MQTT_PORT, _mqttPort, 5);
-        configChanged = true;
-      }
+  _server->begin();
+  _routesRegistered = true;
+  _serverStarted = true;
+  Serial.println("HTTP server started");
+}
+
+// 发起到已保存WiFi网络的连接，只启动连接过程，不等待结果
+// 保存了多个网络时先异步扫描一次，按扫描结果决定尝试顺序
+void WiFiConfigManager::connectToWiFi() {
+  Serial.println("Connecting to WiFi...");
+
+  // 配置AP正在运行时使用AP+STA模式连接，手机保持连接并可以通过/status查看进度
+  WiFi.mode(_apActive ? WIFI_AP_STA : WIFI_STA);
+  _scanMs = 0;
+
+  if (!beginFastAttempt()) {
+    beginFullConnect();
+  }
+}
+
+// 使用上次成功连接的接入点（信道和BSSID）直接连接，跳过扫描；
+// 允许时同时沿用上次的IP地址，跳过DHCP。返回是否发起了连接
+bool WiFiConfigManager::beginFastAttempt() {
+  const WiFiConfigLease& lease = _config.lease;
+  if (!_fastReconnect || !_leaseUsable || lease.ssidCrc == 0 || lease.channel == 0) {
+    return false;
+  }
+
+  // 租约所属的网络可能已被删除
+  uint8_t count = wifiConfigNetworkCount(_config);
+  uint8_t network = 0;
+  while (network < count) {
+    const WiFiConfigString<33>& ssid = _config.networks[network].ssid;
+    if (wifiConfigCrc32(ssid.c_str(), ssid.length()) == lease.ssidCrc) {
+      break;
+    }
+    network++;
+  }
+  if (network == count) {
+    return false;
+  }
+
+  if ((_reuseLeaseIP || _sleepReuseIP) && lease.ip) {
+    WiFi.config(IPAddress(lease.ip), IPAddress(lease.gateway), IPAddress(lease.subnet), IPAddress(lease.dns));
+  }
+
+  Serial.println("Fast reconnect to last access point");
+  _candidates[0].network = network;
+  _candidates[0].channel = lease.channel;
+  memcpy(_candidates[0].bssid, lease.bssid, sizeof(lease.bssid));
+  _candidateCount = 1;
+  _candidateIndex = 0;
+  _fastAttempt = true;
+  beginAttempt();
+  return true;
+}
+
+// 不使用缓存的接入点信息：保存了多个网络时先扫描排序，否则直接连接
+void WiFiConfigManager::beginFullConnect() {
+  if (wifiConfigNetworkCount(_config) > 1) {
+    startScan();
+    _connState = CONN_SCANNING;
+    return;
+  }
+
+  // 只有一个网络时不需要排序，直接连接
+  _candidates[0].network = 0;
+  _candidates[0].channel = 0;
+  _candidateCount = 1;
+  _candidateIndex = 0;
+  beginAttempt();
+}
+
+// 根据扫描结果排列候选网络：只尝试扫描到的已知网络，信号强且以往连接成功多的优先
+// 一个已知网络都没有扫描到时（例如隐藏SSID），按保存顺序逐个尝试
+void WiFiConfigManager::rankNetworks(int found) {
+  int rssi[WIFI_CONFIG_MAX_NETWORKS];
+  _candidateCount = 0;
+  _candidateIndex = 0;
+
+  uint8_t known = wifiConfigNetworkCount(_config);
+  for (int i = 0; i < found; i++) {
+    String ssid = WiFi.SSID(i);
+    uint8_t network = 0;
+    while (network < known && !_config.networks[network].ssid.equals(ssid.c_str(), ssid.length())) {
+      network++;
+    }
+    if (network == known) {
+      continue;
+    }
+
+    // 同一网络有多个接入点时只保留信号最强的一个
+    uint8_t c = 0;
+    while (c < _candidateCount && _candidates[c].network != network) {
+      c++;
+    }
+    if (c < _candidateCount && rssi[c] >= WiFi.RSSI(i)) {
+      continue;
+    }
+    if (c == _candidateCount) {
+      _candidateCount++;
+    }
+    rssi[c] = WiFi.RSSI(i);
+    _candidates[c].network = network;
+    _candidates[c].channel = WiFi.channel(i);
+    memcpy(_candidates[c].bssid, WiFi.BSSID(i), sizeof(_candidates[c].bssid));
+  }
+
+  // 以往连接成功的网络最多加20dB
+  int score[WIFI_CONFIG_MAX_NETWORKS];
+  for (uint8_t c = 0; c < _candidateCount; c++) {
+    uint8_t successes = _config.networks[_candidates[c].network].successes;
+    score[c] = rssi[c] + 2 * (successes < 10 ? successes : 10);
+  }
+
+  // 候选数量很少，插入排序即可
+  for (uint8_t i = 1; i < _candidateCount; i++) {
+    for (uint8_t j = i; j > 0 && score[j] > score[j - 1]; j--) {
+      Candidate tmp = _candidates[j];
+      _candidates[j] = _candidates[j - 1];
+      _candidates[j - 1] = tmp;
+      int t = score[j];
+      score[j] = score[j - 1];
+      score[j - 1] = t;
+    }
+  }
+
+  if (_candidateCount == 0) {
+    Serial.println("No saved network found in scan, trying all");
+    for (uint8_t network = 0; network < known; network++) {
+      _candidates[network].network = network;
+      _candidates[network].channel = 0;
+    }
+    _candidateCount = known;
+  }
+}
+
+// 连接当前候选网络；扫描到的网络带上信道和BSSID，驱动不需要再扫描一次
+void WiFiConfigManager::beginAttempt() {
+  const Candidate& candidate = _candidates[_candidateIndex];
+  const WiFiConfigNetwork& network = _config.networks[candidate.network];
+  Serial.print("SSID: ");
+  Serial.println(network.ssid.c_str());
+
+  if (candidate.channel) {
+    WiFi.begin(network.ssid.c_str(), network.password.c_str(), candidate.channel, candidate.bssid);
+  } else {
+    WiFi.begin(network.ssid.c_str(), network.password.c_str());
+  }
+
+  _connState = CONN_CONNECTING;
+  _connectStartTime = millis();
+}
+
+// 更新连接成功的网络的统计和租约
+// 只有接入点或地址变化时才立即保存；成功次数和信号强度只影响排序，先留在内存中，
+// 累计SUCCESS_SAVE_INTERVAL次后或随下一次保存写入，链路频繁断开时不会每次重连都写Flash
+void WiFiConfigManager::recordSuccess() {
+  WiFiConfigNetwork& network = _config.networks[_candidates[_candidateIndex].network];
+
+  if (network.successes < 255) {
+    network.successes++;
+    _unsavedSuccesses++;
+  }
+
+  int rssi = WiFi.RSSI();
+  if (network.lastRssi == 0 || abs(rssi - network.lastRssi) >= 6) {
+    network.lastRssi = (int8_t)rssi;
+  }
+
+  // 记录本次连接的接入点和地址，供下次启动快速连接
+  WiFiConfigLease lease;
+  memset(&lease, 0, sizeof(lease));
+  lease.ssidCrc = wifiConfigCrc32(network.ssid.c_str(), network.ssid.length());
+  const uint8_t* bssid = WiFi.BSSID();
+  if (bssid) {
+    memcpy(lease.bssid, bssid, sizeof(lease.bssid));
+  }
+  lease.channel = (uint8_t)WiFi.channel();
+  lease.ip = WiFi.localIP();
+  lease.gateway = WiFi.gatewayIP();
+  lease.subnet = WiFi.subnetMask();
+  lease.dns = WiFi.dnsIP();
+  bool leaseChanged = memcmp(&lease, &_config.lease, sizeof(lease)) != 0;
+  if (leaseChanged) {
+    _config.lease = lease;
+  }
+
+  // 从RTC内存恢复时不写存储：变化保留在内存中，下次进入深度睡眠时随副本保存，
+  // 否则每次唤醒都会因为成功次数增加而写一次Flash
+  if ((leaseChanged || _unsavedSuccesses >= SUCCESS_SAVE_INTERVAL) && !_restoredFromSleep) {
+    saveConfig();
+  }
+}
 
-      if (mqttUsername != _mqttUsername) {
-        _mqttUsername = mqttUsername;
-        writeToEEPROM(MQTT_USERNAME, _mqttUsername, 100);
-        configChanged = true;
+// WiFi事件回调，在WiFi事件任务中执行：只更新原子状态，其余处理留给loop()
+void WiFiConfigManager::onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info) {
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+      _associatedAt = millis();
+      break;
+
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      _gotIPAt = millis();
+      _staConnected = true;
+      _disconnectReason = 0;
+      _pendingEvents |= EVENT_GOT_IP;
+      break;
+
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+      _staConnected = false;
+      _disconnectReason = info.wifi_sta_disconnected.reason;
+      _pendingEvents |= EVENT_DISCONNECTED;
+      break;
+
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      _staConnected = false;
+      _disconnectReason = 0;
+      _pendingEvents |= EVENT_DISCONNECTED;
+      break;
+
+    case ARDUINO_EVENT_WIFI_SCAN_DONE:
+      _pendingEvents |= EVENT_SCAN_DONE;
+      break;
+
+    case ARDUINO_EVENT_WIFI_AP_STACONNECTED:
+      _apStations++;
+      break;
+
+    case ARDUINO_EVENT_WIFI_AP_STADISCONNECTED:
+      if (_apStations > 0) {
+        _apStations--;
       }
+      break;
 
-      if (mqttPassword != _mqttPassword) {
-        _mqttPassword = mqttPassword;
-        writeToEEPROM(MQTT_PASSWD, _mqttPassword, 256);
-        configChanged = true;
+    case ARDUINO_EVENT_WIFI_AP_STOP:
+      _apStations = 0;
+      break;
+
+    default:
+      break;
+  }
+}
+
+// 安排下一次断线重连：等待时间按连续失败次数指数增长，不超过上限，
+// 并在其一半到全部之间随机选取，避免大量设备在路由器恢复后同时重连
+void WiFiConfigManager::scheduleReconnect() {
+  unsigned long delayMs = _reconnectInitialDelay;
+  for (unsigned int i = 0; i < _reconnectFailures && delayMs < _reconnectMaxDelay; i++) {
+    delayMs *= 2;
+  }
+  // 配置AP已打开时按最大间隔重连，尽量少地打扰连在AP上的手机
+  if (delayMs > _reconnectMaxDelay || reconnectPortalDue()) {
+    delayMs = _reconnectMaxDelay;
+  }
+  delayMs = delayMs / 2 + random(delayMs / 2 + 1);
+
+  Serial.printf("Reconnecting in %lu ms (attempt %u)\n", delayMs, _reconnectFailures + 1);
+  _retryAt = millis() + delayMs;
+  _connState = CONN_RETRY;
+}
+
+// 断线重连是否已连续失败到需要打开配置AP
+bool WiFiConfigManager::reconnectPortalDue() const {
+  return _reconnecting && _failuresBeforePortal > 0 && _reconnectFailures >= (unsigned int)_failuresBeforePortal;
+}
+
+// 发起异步扫描，结果由loop()在扫描完成事件中取走；已有扫描在进行时共用其结果
+void WiFiConfigManager::startScan() {
+  if (_scanInProgress) {
+    return;
+  }
+  WiFi.scanNetworks(true);
+  _scanInProgress = true;
+  _scanStartTime = millis();
+}
+
+// 用扫描结果更新网络列表：隐藏网络不列出，同名网络只保留信号最强的接入点，
+// 超过缓存容量时保留信号最强的SCAN_CACHE_SIZE个；扫描失败时保留原有列表
+void WiFiConfigManager::cacheScanResults(int found) {
+  _scanInProgress = false;
+  if (found < 0) {
+    return;
+  }
+
+  _scanCacheCount = 0;
+  for (int i = 0; i < found; i++) {
+    String ssid = WiFi.SSID(i);
+    if (ssid.length() == 0) {
+      continue;
+    }
+    int8_t rssi = (int8_t)WiFi.RSSI(i);
+
+    uint8_t e = 0;
+    while (e < _scanCacheCount && !_scanCache[e].ssid.equals(ssid.c_str(), ssid.length())) {
+      e++;
+    }
+    if (e < _scanCacheCount) {
+      if (_scanCache[e].rssi >= rssi) {
+        continue;
       }
+    } else if (_scanCacheCount < SCAN_CACHE_SIZE) {
+      e = _scanCacheCount++;
+    } else if (_scanCache[SCAN_CACHE_SIZE - 1].rssi < rssi) {
+      e = SCAN_CACHE_SIZE - 1;  // 替换最弱的一个
+    } else {
+      continue;
+    }
+
+    ScanEntry entry;
+    entry.ssid.clear();
+    entry.ssid.assign(ssid.c_str(), ssid.length());
+    entry.rssi = rssi;
+    entry.channel = (uint8_t)WiFi.channel(i);
+    entry.secure = WiFi.encryptionType(i) != WIFI_AUTH_OPEN;
+
+    // 信号变强后向前移动，保持从强到弱的顺序
+    while (e > 0 && _scanCache[e - 1].rssi < rssi) {
+      _scanCache[e] = _scanCache[e - 1];
+      e--;
+    }
+    _scanCache[e] = entry;
+  }
+
+  _scanCacheValid = true;
+  _scanCachedAt = millis();
+}
+
+// 进入已连接状态，回调在每次连接建立时只触发一次
+void WiFiConfigManager::onConnected() {
+  _connState = CONN_CONNECTED;
+  Serial.println("WiFi connection successful!");
+  Serial.print("IP address: ");
+  Serial.println(WiFi.localIP());
+  _fastAttempt = false;
+  _leaseUsable = true;
+  _reconnecting = false;
+  _reconnectFailures = 0;
+  recordSuccess();
+
+  // 各阶段耗时：从WiFi.begin()到关联完成，再到获得地址；没有收到关联事件时全部计入DHCP之前
+  uint32_t associatedAt = _associatedAt;
+  uint32_t gotIPAt = _gotIPAt;
+  if ((int32_t)(associatedAt - (uint32_t)_connectStartTime) < 0 || (int32_t)(gotIPAt - associatedAt) < 0) {
+    associatedAt = gotIPAt;
+  }
+  _counters.lastScanMs.store(_scanMs, std::memory_order_relaxed);
+  _counters.lastAuthMs.store(associatedAt - _connectStartTime, std::memory_order_relaxed);
+  _counters.lastDhcpMs.store(gotIPAt - associatedAt, std::memory_order_relaxed);
+  WiFiConfigCounters::add(_counters.connects);
+
+  // 按设置在局域网上提供/metrics
+  if (_metricsOnSTA) {
+    startWebServer();
+  }
+
+  configureAnnouncer();
+
+  // 配置AP在宽限期后关闭，让配置页面有时间显示连接结果
+  if (_apActive) {
+    _apTeardownPending = true;
+    _apTeardownAt = millis() + AP_GRACE_PERIOD;
+  }
 
-      if (mqttClientID != _mqttClientID) {
-        _mqttClientID = mqttClientID;
-        writeToEEPROM(MQTT_DEVICE_ID, _mqttClientID, 100);
-        configChanged = true;
+  // 触发连接成功回调
+  if (_connectedCallback) {
+    _connectedCallback();
+  }
+}
+
+// 按当前配置启动或停止MQTT客户端，队列中的消息保留
+void WiFiConfigManager::configureMQTT() {
+  if ((_config.flags & WIFI_CONFIG_FLAG_MQTT) && _config.mqttServer.length() > 0) {
+    _mqtt.begin(_config.mqttServer.c_str(), _config.mqttPort, _config.mqttClientID.c_str(),
+                _config.mqttUsername.c_str(), _config.mqttPassword.c_str());
+  } else {
+    _mqtt.stop();
+  }
+}
+
+// 启用了UDP广播时开始广播，第一次立即发送
+void WiFiConfigManager::configureAnnouncer() {
+  if ((_config.flags & WIFI_CONFIG_FLAG_UDP) && _config.udpPort != 0) {
+    _announcer.begin(_config.udpPort, _config.deviceName.c_str(), _announceInterval);
+  } else {
+    _announcer.stop();
+  }
+}
+
+// 当前候选网络连接失败：快速连接失败时改用完整流程，否则尝试下一个候选网络
+void WiFiConfigManager::onAttemptFailed() {
+  WiFiConfigCounters::add(_counters.connectFailures);
+  if (_fastAttempt) {
+    // 接入点可能换了信道，或者地址已不可用：恢复DHCP，改用完整的扫描流程
+    Serial.println("Fast reconnect failed, falling back to full scan");
+    _fastAttempt = false;
+    _leaseUsable = false;
+    if (_reuseLeaseIP || _sleepReuseIP) {
+      WiFi.config(IPAddress(), IPAddress(), IPAddress());
+    }
+    beginFullConnect();
+  } else if (_candidateIndex + 1 < _candidateCount) {
+    _candidateIndex++;
+    Serial.println("Trying next saved network");
+    beginAttempt();
+  } else {
+    Serial.println("WiFi connection failed!");
+    _connState = CONN_FAILED;
+  }
+}
+
+// 连接状态机：IDLE -> [SCANNING ->] CONNECTING -> CONNECTED/FAILED -> RETRY
+// 每次loop()调用一次，只处理WiFi事件带来的变化和超时，不做任何等待
+void WiFiConfigManager::updateConnection() {
+  uint32_t events = _pendingEvents.exchange(0);
+  if (events & EVENT_DISCONNECTED) {
+    uint8_t reason = _disconnectReason;
+
+    if (_connState == CONN_CONNECTED) {
+      // 链路断开：按退避策略在后台重连，优先使用刚才的接入点
+      Serial.printf("WiFi connection lost (reason %u)\n", reason);
+      _reconnecting = true;
+      _reconnectFailures = 0;
+      WiFiConfigCounters::add(_counters.linkLosses);
+      _announcer.stop();
+      scheduleReconnect();
+      if (_disconnectedCallback) {
+        _disconnectedCallback(reason);
       }
+    } else if (_connState == CONN_CONNECTING && reason != WIFI_REASON_ASSOC_LEAVE && !_staConnected) {
+      // 密码错误或网络不存在时不必等到超时，直接尝试下一个候选网络
+      // ASSOC_LEAVE是发起新连接时断开旧连接产生的，不代表本次连接失败
+      Serial.printf("WiFi connection attempt failed (reason %u)\n", reason);
+      onAttemptFailed();
     }
+  }
 
-    // 获取UDP广播配置
-    bool enableUDP = _server->hasArg("enableUDP");
-    String udpEnabled = enableUDP ? "1" : "0";
+  if ((events & EVENT_GOT_IP) && _staConnected
+      && (_connState == CONN_CONNECTING || _connState == CONN_IDLE)) {
+    onConnected();
+  }
 
-    if (udpEnabled != _udpEnabled) {
-      _udpEnabled = udpEnabled;
-      writeToEEPROM(UDP_ENABLE, _udpEnabled, 1);
-      configChanged = true;
+  // 配置页面发起的扫描完成，或者扫描没有按时完成（例如切换模式时被中止）
+  // 连接过程中的扫描在下面的CONN_SCANNING中处理
+  if (_scanInProgress && _connState != CONN_SCANNING) {
+    if (events & EVENT_SCAN_DONE) {
+      cacheScanResults(WiFi.scanComplete());
+      WiFi.scanDelete();
+    } else if (millis() - _scanStartTime >= SCAN_TIMEOUT) {
+      _scanInProgress = false;
+      WiFi.scanDelete();
     }
+  }
 
-    if (enableUDP) {
-      String udpPort = _server->arg("udpPort");
-      String deviceName = _server->arg("deviceName");
+  switch (_connState) {
+    case CONN_SCANNING:
+      if (events & EVENT_SCAN_DONE) {
+        _scanMs = millis() - _scanStartTime;
+        int found = WiFi.scanComplete();
+        rankNetworks(found > 0 ? found : 0);
+        cacheScanResults(found);
+        WiFi.scanDelete();
+        beginAttempt();
+      } else if (millis() - _scanStartTime >= SCAN_TIMEOUT) {
+        // 扫描没有完成时仍按保存顺序尝试
+        _scanMs = millis() - _scanStartTime;
+        rankNetworks(0);
+        _scanInProgress = false;
+        WiFi.scanDelete();
+        beginAttempt();
+      }
+      break;
 
-      // 检查是否有变化并保存
-      if (udpPort != _udpPort) {
-        _udpPort = udpPort;
-        writeToEEPROM(UDP_PORT, _udpPort, 5);
-        configChanged = true;
+    case CONN_CONNECTING:
+      if (millis() - _connectStartTime >= (_fastAttempt ? FAST_CONNECT_TIMEOUT : (unsigned long)_connectionTimeout * 1000UL)) {
+        onAttemptFailed();
+      }
+      break;
+
+    case CONN_FAILED:
+      if (_reconnecting) {
+        _reconnectFailures++;
+        // 失败次数达到设定值后打开配置AP，同时继续重连；成功后配置AP在宽限期后关闭
+        if (reconnectPortalDue()) {
+          if (!_apActive) {
+            Serial.printf("WiFi reconnect failed %u times, starting AP mode\n", _reconnectFailures);
+          }
+          setupAPMode();
+        }
+        scheduleReconnect();
+      } else if (_retryCount < _maxRetries) {
+        _retryCount++;
+        _retryAt = millis() + RETRY_DELAY;
+        _connState = CONN_RETRY;
+        Serial.printf("Retrying WiFi connection (%d/%d)\n", _retryCount, _maxRetries);
+      } else {
+        // 重试次数用尽，启动AP模式
+        Serial.println("WiFi connection failed, starting AP mode");
+        _connState = CONN_IDLE;
+        setupAPMode();
       }
+      break;
 
-      if (deviceName != _deviceName) {
-        _deviceName = deviceName;
-        writeToEEPROM(UDP_DEVICE_NAME, _deviceName, 31);
-        configChanged = true;
+    case CONN_RETRY:
+      if ((long)(millis() - _retryAt) >= 0) {
+        connectToWiFi();
       }
-    }
+      break;
 
-    // 如果配置有变化，确保提交EEPROM
-    if (configChanged) {
-      commitEEPROM();
+    case CONN_IDLE:
+    case CONN_CONNECTED:
+      break;
+  }
+}
+
+// 处理配置Web界面的根路径请求，显示配置页面
+// 页面模板边扫描边发送，已保存的配置直接从配置记录填入表单，不拼接整页字符串
+void WiFiConfigManager::handleRoot() {
+  WiFiConfigChunkWriter out(_server);
+  out.begin(200, "text/html");
+  wifiConfigRenderTemplate(out, PAGE_INDEX_TEMPLATE, sizeof(PAGE_INDEX_TEMPLATE) - 1, resolvePlaceholder, this);
+  out.end();
+}
+
+// 填充配置页面中的占位符：每个字段的占位符展开为输入框的类型、名称、长度限制和当前值
+bool WiFiConfigManager::resolvePlaceholder(void* context, const char* name, size_t nameLength, WiFiConfigChunkWriter& out) {
+  const WiFiConfigRecord& config = static_cast<WiFiConfigManager*>(context)->portalConfig();
+
+  // WiFi网络填入最近配置的一个
+  if (nameEquals(name, nameLength, "SSID")) {
+    out.print("type=\"text\" id=\"ssid\" name=\"ssid\"");
+    writeField(out, config.networks[0].ssid, false);
+    return true;
+  }
+  if (nameEquals(name, nameLength, "PASSWORD")) {
+    out.print("type=\"password\" id=\"password\" name=\"password\"");
+    writeField(out, config.networks[0].password, true);
+    return true;
+  }
+
+#define WIFI_CONFIG_WRITE_FIELD(type, member, formName, placeholder, inputType, group) \
+  if (nameEquals(name, nameLength, placeholder)) { \
+    out.print("type=\"" inputType "\" id=\"" formName "\" name=\"" formName "\""); \
+    writeField(out, config.member, strcmp(inputType, "password") == 0); \
+    return true; \
+  }
+#define WIFI_CONFIG_WRITE_FLAG(bit, formName, placeholder) \
+  if (nameEquals(name, nameLength, placeholder)) { \
+    out.print("type=\"checkbox\" id=\"" formName "\" name=\"" formName "\""); \
+    if (config.flags & (bit)) { \
+      out.print(" checked"); \
+    } \
+    return true; \
+  }
+#define WIFI_CONFIG_WRITE_FLAGS(member) WIFI_CONFIG_FLAG_TABLE(WIFI_CONFIG_WRITE_FLAG)
+  WIFI_CONFIG_FIELD_TABLE(WIFI_CONFIG_WRITE_FIELD, WIFI_CONFIG_WRITE_FLAGS)
+#undef WIFI_CONFIG_WRITE_FIELD
+#undef WIFI_CONFIG_WRITE_FLAG
+#undef WIFI_CONFIG_WRITE_FLAGS
+
+  return false;
+}
+
+// 页面样式表，与模板分开发送，浏览器可以缓存
+void WiFiConfigManager::handleStyle() {
+  sendGzipPage(PAGE_STYLE_GZ, sizeof(PAGE_STYLE_GZ), "text/css", PAGE_STYLE_ETAG);
+}
+
+// 直接从Flash发送预压缩的页面，不复制到堆上
+// 带ETag时浏览器每次都会重新验证，已缓存同一版本时只回复304
+void WiFiConfigManager::sendGzipPage(const uint8_t* data, size_t length, const char* contentType, const char* etag) {
+  if (etag) {
+    _server->sendHeader("ETag", etag);
+    _server->sendHeader("Cache-Control", "no-cache");
+    if (_server->header("If-None-Match") == etag) {
+      _server->send(304);
+      return;
     }
+  }
 
-    Serial.println("Configuration saved:");
-    Serial.println("SSID: " + _targetSSID);
-    Serial.println("Password: " + _targetPassword);
-    Serial.println("MQTT Enabled: " + _mqttEnabled);
-    Serial.println("MQTT Server: " + _mqttServer);
-    Serial.println("MQTT Port: " + _mqttPort);
-    Serial.println("MQTT Username: " + _mqttUsername);
-    Serial.println("MQTT Client ID: " + _mqttClientID);
-    Serial.println("UDP Broadcast Enabled: " + _udpEnabled);
-    Serial.println("UDP Port: " + _udpPort);
-    Serial.println("Device Name: " + _deviceName);
+  _server->sendHeader("Content-Encoding", "gzip");
+  _server->send_P(200, contentType, (PGM_P)data, length);
+}
 
-    // 先发送响应
-    _server->send(200, "text/html", _successPage);
+// 处理保存配置的请求：更新内存中的配置后立即回复，写入存储和连接WiFi由之后的loop()完成
+void WiFiConfigManager::handleSave() {
+  bool configChanged = false;
 
-    // 添加短暂延迟确保响应被发送
-    delay(1000);
+  if (_server->hasArg("ssid") && _server->hasArg("password")) {
+    WiFiConfigRecord& config = stageConfig();
+
+    // 提交的网络加入已保存网络列表的最前面
+    String ssid = _server->arg("ssid");
+    String password = _server->arg("password");
+    if (ssid.length() > 0) {
+      // 页面不回显已保存的密码，已保存的网络提交空密码时沿用原来的密码
+      if (password.length() == 0) {
+        uint8_t count = wifiConfigNetworkCount(config);
+        for (uint8_t i = 0; i < count; i++) {
+          if (config.networks[i].ssid.equals(ssid.c_str(), ssid.length())) {
+            password = config.networks[i].password.c_str();
+            break;
+          }
+        }
+      }
+      configChanged |= wifiConfigAddNetwork(config, ssid.c_str(), ssid.length(), password.c_str(), password.length());
+    }
 
-    // 设置连接标志
-    _shouldConnect = true;
+    // 按字段表逐个读取表单参数，有变化的字段更新到暂存的配置记录
+    // 功能开关排在所属字段之前，未启用的功能保留原有参数；密码字段为空时保持不变
+    // 记录是紧凑排列的，字段先复制出来再更新，避免引用未对齐的成员
+#define WIFI_CONFIG_READ_FIELD(type, member, formName, placeholder, inputType, group) \
+    if (((group) == 0 || (config.flags & (group))) \
+        && (strcmp(inputType, "password") != 0 || _server->arg(formName).length() > 0)) { \
+      type value = config.member; \
+      if (readField(value, _server->arg(formName))) { \
+        config.member = value; \
+        configChanged = true; \
+      } \
+    }
+#define WIFI_CONFIG_READ_FLAG(bit, formName, placeholder) \
+    if (_server->hasArg(formName) != ((config.flags & (bit)) != 0)) { \
+      config.flags ^= (bit); \
+      configChanged = true; \
+    }
+#define WIFI_CONFIG_READ_FLAGS(member) WIFI_CONFIG_FLAG_TABLE(WIFI_CONFIG_READ_FLAG)
+    WIFI_CONFIG_FIELD_TABLE(WIFI_CONFIG_READ_FIELD, WIFI_CONFIG_READ_FLAGS)
+#undef WIFI_CONFIG_READ_FIELD
+#undef WIFI_CONFIG_READ_FLAG
+#undef WIFI_CONFIG_READ_FLAGS
+
+    // 立即回复，不在处理函数中写Flash或等待
+    _saveDirty |= configChanged;
+    _saveReconnect = true;
+    _saveStage = SAVE_COMMIT;
+    sendGzipPage(PAGE_SUCCESS_GZ, sizeof(PAGE_SUCCESS_GZ), "text/html", nullptr);
   } else {
     _server->send(400, "text/plain", "Missing required parameters");
   }
 }
 
-// 处理未找到的页面请求，将所有未找到的请求重定向到配置页面
-void WiFiConfigManager::handleNotFound() {
-  _server->sendHeader("Location", "/", true);
-  _server->send(302, "text/plain", "");
+// 以JSON返回当前配置，由字段表生成，成员名与表单参数名相同
+// 密码（包括各网络的密码）不返回；提交时省略的成员保持不变
+void WiFiConfigManager::handleGetConfig() {
+  const WiFiConfigRecord& config = portalConfig();
+  _server->sendHeader("Cache-Control", "no-store");
+  WiFiConfigChunkWriter out(_server);
+  out.begin(200, "application/json");
+  out.print("{\"networks\":[");
+  uint8_t count = wifiConfigNetworkCount(config);
+  for (uint8_t i = 0; i < count; i++) {
+    out.print(i ? ",{\"ssid\":" : "{\"ssid\":");
+    out.printJsonString(config.networks[i].ssid.c_str());
+    out.print("}");
+  }
+  out.print("]");
+
+#define WIFI_CONFIG_JSON_WRITE_FIELD(type, member, formName, placeholder, inputType, group) \
+  if (strcmp(inputType, "password") != 0) { \
+    out.print(",\"" formName "\":"); \
+    writeJsonField(out, config.member); \
+  }
+#define WIFI_CONFIG_JSON_WRITE_FLAG(bit, formName, placeholder) \
+  out.print(",\"" formName "\":"); \
+  out.print((config.flags & (bit)) ? "true" : "false");
+#define WIFI_CONFIG_JSON_WRITE_FLAGS(member) WIFI_CONFIG_FLAG_TABLE(WIFI_CONFIG_JSON_WRITE_FLAG)
+  WIFI_CONFIG_FIELD_TABLE(WIFI_CONFIG_JSON_WRITE_FIELD, WIFI_CONFIG_JSON_WRITE_FLAGS)
+#undef WIFI_CONFIG_JSON_WRITE_FIELD
+#undef WIFI_CONFIG_JSON_WRITE_FLAG
+#undef WIFI_CONFIG_JSON_WRITE_FLAGS
+
+  out.print("}");
+  out.end();
 }
 
-// 从EEPROM读取字符串，指定起始地址和最大长度
-String WiFiConfigManager::readFromEEPROM(int startAddr, int maxLength) {
-  char data[maxLength + 1];  // +1 用于字符串结束符
+// 请求体处理函数：WebServer每收到一段请求体就调用一次，直接交给JSON读取器，
+// 成员应用到配置记录的副本上，整个请求体不在内存中保存
+void WiFiConfigManager::handlePutConfigBody() {
+  // 配置AP关闭后请求体直接丢弃，由handlePutConfig()回复403
+  if (!_apActive) {
+    return;
+  }
+  HTTPRaw& raw = _server->raw();
+  switch (raw.status) {
+    case RAW_START:
+      beginConfigUpdate(portalConfig());
+      break;
+    case RAW_WRITE:
+      s_configReader.feed((const char*)raw.buf, raw.currentSize);
+      break;
+    case RAW_END:
+      break;
+    case RAW_ABORTED:
+      s_configUpdateActive = false;
+      break;
+  }
+}
 
-  // 读取数据直到结束符或达到最大长度
-  int i;
-  for (i = 0; i < maxLength; i++) {
-    char c = char(EEPROM.read(startAddr + i));
-    if (c == '\0') {
-      break;  // 找到字符串结束符
+// 请求体接收完毕后检查文档并更新配置，只修改出现的成员；之后与表单保存走同样的写入流程
+// 任何成员无效时整个请求被拒绝，配置不变
+void WiFiConfigManager::handlePutConfig() {
+  // 请求体没有分段交给处理函数时（例如以表单格式提交）视为空文档
+  if (!s_configUpdateActive) {
+    beginConfigUpdate(portalConfig());
+  }
+  s_configUpdateActive = false;
+  WiFiConfigUpdate& update = s_configUpdate;
+  WiFiConfigJsonReader& reader = s_configReader;
+
+  const char* error = nullptr;
+  if (!reader.finish()) {
+    error = reader.error();
+  } else if (update.hasPassword && !update.hasSSID) {
+    error = "password requires ssid";
+    strcpy(update.rejectedKey, "password");
+  }
+  if (error) {
+    Serial.printf("Rejected configuration update: %s\n", error);
+    WiFiConfigChunkWriter out(_server);
+    out.begin(400, "application/json");
+    out.print("{\"error\":");
+    out.printJsonString(error);
+    if (update.rejectedKey[0]) {
+      out.print(",\"field\":");
+      out.printJsonString(update.rejectedKey);
     }
-    data[i] = c;
+    out.print(",\"offset\":");
+    out.print((unsigned long)reader.errorOffset());
+    out.print("}");
+    out.end();
+    return;
   }
 
-  // 确保字符串以结束符结束
-  data[i] = '\0';
+  // 接收请求体期间可能有其他保存请求修改了网络列表，请求不能修改网络列表和租约，以当前配置为准
+  const WiFiConfigRecord& current = portalConfig();
+  memcpy(update.config.networks, current.networks, sizeof(current.networks));
+  update.config.lease = current.lease;
+
+  if (update.hasSSID) {
+    // 省略密码时沿用该网络已保存的密码，新网络视为开放网络
+    if (!update.hasPassword) {
+      uint8_t count = wifiConfigNetworkCount(update.config);
+      for (uint8_t i = 0; i < count; i++) {
+        if (update.config.networks[i].ssid.equals(update.ssid.c_str(), update.ssid.length())) {
+          update.password = update.config.networks[i].password;
+          break;
+        }
+      }
+    }
+    wifiConfigAddNetwork(update.config, update.ssid.c_str(), update.ssid.length(), update.password.c_str(),
+                         update.password.length());
+  }
 
-  // 特殊处理：如果是空字符或只有结束符，返回空字符串
-  if (i == 0 || (i == 1 && data[0] == '\0')) {
-    return String("");
+  // 只有网络列表变化时才需要重新连接，其他参数在写入后直接生效
+  bool reconnect = memcmp(update.config.networks, current.networks, sizeof(current.networks)) != 0;
+  bool changed = memcmp(&update.config, &current, sizeof(current)) != 0;
+  if (changed) {
+    stageConfig() = update.config;
+    _saveDirty = true;
+    // 已经写入、等待连接的表单保存不能因此丢失连接步骤
+    _saveReconnect |= reconnect || _saveStage == SAVE_CONNECT;
+    _saveStage = SAVE_COMMIT;
   }
 
-  return String(data);
+  char json[48];
+  snprintf(json, sizeof(json), "{\"changed\":%s,\"reconnect\":%s}", changed ? "true" : "false",
+           reconnect ? "true" : "false");
+  _server->sendHeader("Cache-Control", "no-store");
+  _server->send(200, "application/json", json);
 }
 
-// 将字符串写入EEPROM，指定起始地址和最大长度，减少不必要的写入操作
-bool WiFiConfigManager::writeToEEPROM(int startAddr, const String& data, int maxLength) {
-  // 检查起始地址是否有效
-  if (startAddr < 0 || startAddr + maxLength >= _eepromSize) {
-    return false;
-  }
+// 处理函数看到的当前配置：有尚未应用的暂存配置时以暂存配置为准
+const WiFiConfigRecord& WiFiConfigManager::portalConfig() const {
+  return _staged ? _stagedConfig : _config;
+}
 
-  // 检查数据是否超出限制
-  if (data.length() > maxLength) {
-    Serial.println("Warning: Data length exceeds limit, will be truncated");
-    // 数据将被截断不报错，但会警告
+// 返回暂存的配置供处理函数修改，第一次修改时从_config复制
+WiFiConfigRecord& WiFiConfigManager::stageConfig() {
+  if (!_staged) {
+    _staged = true;
+    _stagedConfig = _config;
   }
+  return _stagedConfig;
+}
 
-  // 写入数据
-  int dataLength = min((int)data.length(), maxLength);
-  for (int i = 0; i < dataLength; i++) {
-    // 只有当数据不同时才写入，减少写入次数
-    if (EEPROM.read(startAddr + i) != (uint8_t)data.charAt(i)) {
-      EEPROM.write(startAddr + i, data.charAt(i));
-      _commitNeeded = true;
+// 把暂存的配置应用到_config；网络的连接统计和租约只由loop()维护，暂存期间可能已经变化，以_config为准
+void WiFiConfigManager::applyStagedConfig() {
+  uint8_t count = wifiConfigNetworkCount(_stagedConfig);
+  for (uint8_t i = 0; i < count; i++) {
+    WiFiConfigNetwork& network = _stagedConfig.networks[i];
+    for (const WiFiConfigNetwork& known : _config.networks) {
+      if (known.ssid.equals(network.ssid.c_str(), network.ssid.length())) {
+        network.successes = known.successes;
+        network.lastRssi = known.lastRssi;
+        break;
+      }
     }
   }
+  _stagedConfig.lease = _config.lease;
+  _config = _stagedConfig;
+  _staged = false;
+}
 
-  // 写入字符串结束符
-  if (EEPROM.read(startAddr + dataLength) != '\0') {
-    EEPROM.write(startAddr + dataLength, '\0');
-    _commitNeeded = true;
+// 保存请求的后续步骤，每次调用只执行一步，不会在一次loop()中同时写Flash和切换WiFi模式
+void WiFiConfigManager::processSave() {
+  switch (_saveStage) {
+    case SAVE_COMMIT:
+      // 请求修改的是暂存副本，在这里应用到_config，_config只在调用loop()的任务中修改
+      if (_staged) {
+        applyStagedConfig();
+      }
+      // 如果配置有变化，保存整条记录
+      if (_saveDirty) {
+        storeDirtyConfig();
+      }
+      printConfig();
+      configureMQTT();
+      if (_saveReconnect) {
+        _saveReconnect = false;
+        _saveStage = SAVE_CONNECT;
+      } else {
+        // 不重新连接时，已建立的连接直接使用新的广播参数
+        if (_staConnected) {
+          configureAnnouncer();
+        }
+        _saveStage = SAVE_IDLE;
+      }
+      break;
+
+    case SAVE_CONNECT:
+      _saveStage = SAVE_IDLE;
+      _shouldConnect = true;
+      break;
+
+    case SAVE_IDLE:
+      // 上次写入失败时按间隔重试，直到配置写入存储
+      if (_saveDirty && _saveFailed && millis() - _saveFailedAt >= SAVE_RETRY_INTERVAL) {
+        storeDirtyConfig();
+      }
+      break;
   }
+}
 
-  // 清除剩余字节
-  for (int i = dataLength + 1; i < maxLength; i++) {
-    // 只有当数据不是0时才清除，减少写入次数
-    if (EEPROM.read(startAddr + i) != 0) {
-      EEPROM.write(startAddr + i, 0);
-      _commitNeeded = true;
-    }
+// 写入有变化的配置；失败时保留_saveDirty，由processSave()稍后重试
+void WiFiConfigManager::storeDirtyConfig() {
+  if (saveConfig()) {
+    _saveDirty = false;
+    _saveFailed = false;
+    return;
   }
+  Serial.printf("Configuration not saved, retrying in %lu ms\n", SAVE_RETRY_INTERVAL);
+  _saveFailed = true;
+  _saveFailedAt = millis();
+}
 
-  // 延迟提交，但确保在需要时进行提交
-  _lastCommitTime = millis();
+// 打印保存的配置，密码类字段不输出
+void WiFiConfigManager::printConfig() {
+  Serial.println("Configuration saved:");
+  printField("ssid", _config.networks[0].ssid);
+#define WIFI_CONFIG_PRINT_FIELD(type, member, formName, placeholder, inputType, group) \
+  if (strcmp(inputType, "password") != 0) { \
+    printField(formName, _config.member); \
+  }
+#define WIFI_CONFIG_PRINT_FLAG(bit, formName, placeholder) \
+  Serial.printf("%s: %d\n", formName, (_config.flags & (bit)) != 0);
+#define WIFI_CONFIG_PRINT_FLAGS(member) WIFI_CONFIG_FLAG_TABLE(WIFI_CONFIG_PRINT_FLAG)
+  WIFI_CONFIG_FIELD_TABLE(WIFI_CONFIG_PRINT_FIELD, WIFI_CONFIG_PRINT_FLAGS)
+#undef WIFI_CONFIG_PRINT_FIELD
+#undef WIFI_CONFIG_PRINT_FLAG
+#undef WIFI_CONFIG_PRINT_FLAGS
+}
 
-  return true;
+// 处理未找到的页面请求，将所有未找到的请求重定向到配置页面
+void WiFiConfigManager::handleNotFound() {
+  if (!_apActive) {
+    _server->send(404, "text/plain", "Not found");
+    return;
+  }
+  _server->sendHeader("Location", "/", true);
+  _server->send(302, "text/plain", "");
+}
+
+// 返回连接进度，供保存成功页面轮询
+void WiFiConfigManager::handleStatus() {
+  static const char* const stateNames[] = { "idle", "scanning", "connecting", "connected", "failed", "retry" };
+  IPAddress ip = _staConnected ? WiFi.localIP() : IPAddress();
+  char json[160];
+  snprintf(json, sizeof(json),
+           "{\"state\":\"%s\",\"ip\":\"%u.%u.%u.%u\",\"reason\":%u,\"attempt\":%u,\"attempts\":%u,\"ap\":%s,"
+           "\"saveError\":%s}",
+           stateNames[_connState], ip[0], ip[1], ip[2], ip[3], (unsigned)_disconnectReason.load(),
+           (unsigned)(_candidateCount ? _candidateIndex + 1 : 0), (unsigned)_candidateCount,
+           _apActive ? "true" : "false", _saveFailed ? "true" : "false");
+  _server->sendHeader("Cache-Control", "no-store");
+  _server->send(200, "application/json", json);
+}
+
+// 返回缓存的网络列表，不等待扫描；缓存过期时请求loop()重新扫描，
+// 客户端看到"scanning":true时稍后再次请求即可得到新结果
+void WiFiConfigManager::handleScan() {
+  bool fresh = _scanCacheValid && millis() - _scanCachedAt < SCAN_CACHE_TTL;
+  if (!fresh && !_scanInProgress) {
+    _scanRequested = true;
+  }
+
+  char value[64];
+  _server->sendHeader("Cache-Control", "no-store");
+  WiFiConfigChunkWriter out(_server);
+  out.begin(200, "application/json");
+  snprintf(value, sizeof(value), "{\"scanning\":%s,\"age\":%ld,\"networks\":[",
+           (_scanInProgress || _scanRequested) ? "true" : "false",
+           _scanCacheValid ? (long)(millis() - _scanCachedAt) : -1L);
+  out.print(value);
+  for (uint8_t i = 0; i < _scanCacheCount; i++) {
+    const ScanEntry& entry = _scanCache[i];
+    out.print(i ? ",{\"ssid\":" : "{\"ssid\":");
+    out.printJsonString(entry.ssid.c_str());
+    snprintf(value, sizeof(value), ",\"rssi\":%d,\"channel\":%u,\"secure\":%s}", entry.rssi,
+             (unsigned)entry.channel, entry.secure ? "true" : "false");
+    out.print(value);
+  }
+  out.print("]}");
+  out.end();
+}
+
+// 上传处理函数：每收到一段固件就写入OTA分区，不缓存整个镜像
+// 预期的SHA-256和大小（可选）通过URL参数sha256和size给出，在上传开始前就已解析
+// 配置AP关闭后（局域网上的/metrics）不接受上传，数据直接丢弃
+void WiFiConfigManager::handleUpdateUpload() {
+  if (!_apActive) {
+    return;
+  }
+  HTTPUpload& upload = _server->upload();
+  switch (upload.status) {
+    case UPLOAD_FILE_START:
+      Serial.printf("Firmware update started: %s\n", upload.filename.c_str());
+      _ota.begin(_server->arg("sha256").c_str(), (size_t)_server->arg("size").toInt());
+      break;
+    case UPLOAD_FILE_WRITE:
+      _ota.write(upload.buf, upload.currentSize);
+      break;
+    case UPLOAD_FILE_END:
+      _ota.end();
+      break;
+    case UPLOAD_FILE_ABORTED:
+      _ota.abort("upload aborted");
+      break;
+  }
+}
+
+// 上传结束后回复结果；成功时在回复发出后重启
+void WiFiConfigManager::handleUpdate() {
+  if (!_apActive) {
+    _server->send(403, "text/plain", "Firmware update is only available in the configuration portal");
+    return;
+  }
+  if (_ota.state() == WiFiConfigOTA::OTA_RECEIVING) {
+    _ota.abort("upload incomplete");
+  }
+  if (_ota.state() == WiFiConfigOTA::OTA_DONE) {
+    Serial.printf("Firmware update verified, %u bytes\n", (unsigned)_ota.written());
+    _restartPending = true;
+    _restartAt = millis() + RESTART_DELAY;
+  } else {
+    Serial.printf("Firmware update failed: %s\n", _ota.error() ? _ota.error() : "no firmware uploaded");
+  }
+  handleUpdateStatus();
+}
+
+// 以JSON返回最近一次固件更新的状态
+void WiFiConfigManager::handleUpdateStatus() {
+  static const char* const stateNames[] = { "idle", "receiving", "done", "failed" };
+  WiFiConfigOTA::State state = _ota.state();
+  int code = 200;
+  if (_server->method() == HTTP_POST && state != WiFiConfigOTA::OTA_DONE) {
+    code = 400;
+  }
+
+  char value[96];
+  _server->sendHeader("Cache-Control", "no-store");
+  WiFiConfigChunkWriter out(_server);
+  out.begin(code, "application/json");
+  snprintf(value, sizeof(value), "{\"state\":\"%s\",\"written\":%lu,\"size\":%lu,\"restart\":%s,\"error\":",
+           stateNames[state], (unsigned long)_ota.written(), (unsigned long)_ota.size(),
+           _restartPending ? "true" : "false");
+  out.print(value);
+  if (_ota.error()) {
+    out.printJsonString(_ota.error());
+  } else if (code != 200) {
+    out.print("\"no firmware uploaded\"");
+  } else {
+    out.print("null");
+  }
+  out.print("}");
+  out.end();
+}
+
+// 以Prometheus文本格式返回运行时指标
+void WiFiConfigManager::handleMetrics() {
+  WiFiConfigMetrics metrics = getMetrics();
+  _server->sendHeader("Cache-Control", "no-store");
+  WiFiConfigChunkWriter out(_server);
+  out.begin(200, "text/plain; version=0.0.4");
+  wifiConfigWriteMetrics(out, metrics);
+  out.end();
+}
+
+WiFiConfigMetrics WiFiConfigManager::getMetrics() const {
+  WiFiConfigMetrics metrics;
+  _counters.loop.snapshot(metrics.loop);
+  _counters.dns.snapshot(metrics.dns);
+  _counters.http.snapshot(metrics.http);
+  metrics.lastScanMs = _counters.lastScanMs.load(std::memory_order_relaxed);
+  metrics.lastAuthMs = _counters.lastAuthMs.load(std::memory_order_relaxed);
+  metrics.lastDhcpMs = _counters.lastDhcpMs.load(std::memory_order_relaxed);
+  metrics.connects = _counters.connects.load(std::memory_order_relaxed);
+  metrics.connectFailures = _counters.connectFailures.load(std::memory_order_relaxed);
+  metrics.linkLosses = _counters.linkLosses.load(std::memory_order_relaxed);
+  metrics.flashCommits = _counters.flashCommits.load(std::memory_order_relaxed);
+  metrics.flashBytes = _counters.flashBytes.load(std::memory_order_relaxed);
+  metrics.freeHeap = ESP.getFreeHeap();
+  metrics.largestFreeBlock = ESP.getMaxAllocHeap();
+  metrics.rssi = _staConnected ? (int8_t)WiFi.RSSI() : 0;
+  metrics.uptimeS = millis() / 1000;
+  return metrics;
+}
+
+// 执行一个HTTP处理函数并记录耗时；处理函数访问共享状态，在锁内执行
+void WiFiConfigManager::runHandler(void (WiFiConfigManager::*handler)(), bool portalOnly) {
+  WiFiConfigLock lock(_lock);
+  uint32_t start = micros();
+  if (portalOnly && !_apActive) {
+    _server->send(403, "text/plain", "Only available in the configuration portal");
+  } else {
+    (this->*handler)();
+  }
+  _counters.http.record(micros() - start);
 }
 
 // 静态回调函数包装器，将Web服务器请求转发给单例实例处理
 void WiFiConfigManager::handleRootWrapper() {
   if (_instance) {
-    _instance->handleRoot();
+    _instance->runHandler(&WiFiConfigManager::handleRoot, true);
+  }
+}
+
+void WiFiConfigManager::handleStyleWrapper() {
+  if (_instance) {
+    _instance->runHandler(&WiFiConfigManager::handleStyle);
   }
 }
 
 void WiFiConfigManager::handleSaveWrapper() {
   if (_instance) {
-    _instance->handleSave();
+    _instance->runHandler(&WiFiConfigManager::handleSave, true);
+  }
+}
+
+void WiFiConfigManager::handleUpdateWrapper() {
+  if (_instance) {
+    _instance->runHandler(&WiFiConfigManager::handleUpdate);
+  }
+}
+
+void WiFiConfigManager::handleUpdateUploadWrapper() {
+  if (_instance) {
+    _instance->runHandler(&WiFiConfigManager::handleUpdateUpload);
+  }
+}
+
+void WiFiConfigManager::handleUpdateStatusWrapper() {
+  if (_instance) {
+    _instance->runHandler(&WiFiConfigManager::handleUpdateStatus);
+  }
+}
+
+void WiFiConfigManager::handleGetConfigWrapper() {
+  if (_instance) {
+    _instance->runHandler(&WiFiConfigManager::handleGetConfig, true);
+  }
+}
+
+void WiFiConfigManager::handlePutConfigWrapper() {
+  if (_instance) {
+    _instance->runHandler(&WiFiConfigManager::handlePutConfig, true);
+  }
+}
+
+void WiFiConfigManager::handlePutConfigBodyWrapper() {
+  if (_instance) {
+    _instance->runHandler(&WiFiConfigManager::handlePutConfigBody);
+  }
+}
+
+void WiFiConfigManager::handleStatusWrapper() {
+  if (_instance) {
+    _instance->runHandler(&WiFiConfigManager::handleStatus);
+  }
+}
+
+void WiFiConfigManager::handleMetricsWrapper() {
+  if (_instance) {
+    _instance->runHandler(&WiFiConfigManager::handleMetrics);
+  }
+}
+
+void WiFiConfigManager::handleScanWrapper() {
+  if (_instance) {
+    _instance->runHandler(&WiFiConfigManager::handleScan, true);
   }
 }
 
 void WiFiConfigManager::handleNotFoundWrapper() {
   if (_instance) {
-    _instance->handleNotFound();
+    _instance->runHandler(&WiFiConfigManager::handleNotFound);
   }
 }
\ No newline at end of file
@@ -5,7 +5,21 @@
 #include <WiFi.h>
 #include <WebServer.h>
 #include <EEPROM.h>
-#include <DNSServer.h>
+#include <esp_system.h>
+#include <esp_sleep.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <freertos/semphr.h>
+#include <atomic>
+#include "WiFiConfigRecord.h"
+#include "WiFiConfigJournal.h"
+#include "WiFiConfigTemplate.h"
+#include "WiFiConfigDNS.h"
+#include "WiFiConfigAnnouncer.h"
+#include "WiFiConfigMQTT.h"
+#include "WiFiConfigMetrics.h"
+#include "WiFiConfigJson.h"
+#include "WiFiConfigOTA.h"
 
 class WiFiConfigManager {
 public:
@@ -14,6 +28,7 @@ public:
                     const char* apPassword = "12345678",
                     const char* apDomain = "wificonfig.com",
                     int eepromSize = 1024);
+  ~WiFiConfigManager();
 
   // 初始化函数
   void begin();
@@ -39,103 +54,171 @@ public:
   // 设置连接尝试超时时间（秒）
   void setConnectionTimeout(int seconds);
 
+  // 使用独立的FreeRTOS任务处理DNS和HTTP请求，必须在begin()之前调用
+  // 启用后配置页面的响应不再取决于主循环调用loop()的频率；连接状态机和回调函数仍在loop()中执行
+  void setPortalTask(bool enable, BaseType_t core = 0, UBaseType_t priority = 1, uint32_t stackSize = 6144);
+
+  // 设置UDP发现广播的间隔（毫秒，默认10秒，最少1秒），实际间隔在设定值的±10%之间随机
+  // 配置中启用了UDP广播且设置了端口时，连接成功后在loop()中自动广播
+  void setAnnounceInterval(unsigned long intervalMs);
+
+  // 发布一条MQTT消息（QoS 0），返回是否进入发送队列
+  // 配置中启用了MQTT且设置了服务器时，连接WiFi后在loop()中自动连接服务器并发送队列中的消息；
+  // 链路断开期间消息在固定大小的队列中等待，恢复后批量发出
+  bool publish(const char* topic, const char* payload, bool retain = false);
+  bool publish(const char* topic, const void* payload, size_t length, bool retain = false);
+
+  // 设置MQTT发送队列已满时的处理方式，默认丢弃最早的消息
+  void setMQTTQueuePolicy(WiFiConfigMQTTQueuePolicy policy);
+
+  // 设置连接失败后进入AP模式前的重试次数（默认0，失败即进入AP模式）
+  void setConnectionRetries(int retries);
+
+  // 设置是否使用上次成功连接的接入点（信道和BSSID）跳过扫描，默认启用
+  // reuseIP为true时同时沿用上次DHCP分配的地址，跳过DHCP（需要路由器为设备保留该地址）
+  void setFastReconnect(bool enable, bool reuseIP = false);
+
+  // 进入深度睡眠，durationMs毫秒后由定时器唤醒（0表示不设置定时器），不会返回
+  // 配置和上次连接的接入点、地址保存在RTC内存中，唤醒后eepromBegin()直接使用，不读取Flash；
+  // begin()跳过扫描直接连接上次的接入点，reuseIP为true时同时沿用上次的地址，跳过DHCP
+  // 队列中尚未发出的MQTT消息会丢失，需要时先等待getMQTT().queuedMessages()为0
+  void deepSleep(uint32_t durationMs, bool reuseIP = true);
+
+  // 本次启动的配置是否来自深度睡眠前保存在RTC内存中的副本
+  bool restoredFromSleep() const {
+    return _restoredFromSleep;
+  }
+
+  // 设置连接成功后链路断开时的自动重连策略
+  // 第n次重连失败后等待min(initialDelayMs * 2^n, maxDelayMs)，实际等待时间在其一半到全部之间随机选取
+  // failuresBeforePortal为连续失败多少次后打开配置AP，0表示不打开；打开AP后仍按最大间隔重连
+  void setReconnectPolicy(unsigned long initialDelayMs, unsigned long maxDelayMs, int failuresBeforePortal = 0);
+
+  // 连接状态机的状态，由loop()推进
+  enum ConnectionState {
+    CONN_IDLE,        // 空闲，没有进行中的连接
+    CONN_SCANNING,    // 正在扫描，确定已知网络的尝试顺序
+    CONN_CONNECTING,  // 已调用WiFi.begin()，等待连接结果
+    CONN_CONNECTED,   // 已连接到目标WiFi
+    CONN_FAILED,      // 所有候选网络都连接失败
+    CONN_RETRY        // 等待下一次重试（或断线后的下一次重连）
+  };
+
+  // 获取当前连接状态
+  ConnectionState getConnectionState() const {
+    return _connState;
+  }
+
+  // 配置门户DNS的查询数和回复延迟统计
+  const WiFiConfigDNSStats& getDNSStats() const {
+    return _dnsServer->stats();
+  }
+
+  // MQTT客户端的连接状态和队列统计
+  const WiFiConfigMQTT& getMQTT() const {
+    return _mqtt;
+  }
+
+  // 运行时指标：loop()、DNS和HTTP处理的耗时分布，连接各阶段耗时，重连和Flash写入统计，
+  // 以及读取时采样的剩余内存和信号强度；同样的内容可通过/metrics以Prometheus文本格式获取
+  WiFiConfigMetrics getMetrics() const;
+
+  // 连接成功后也启动Web服务器，使/metrics可以从局域网访问，默认关闭
+  // 配置AP关闭后只提供/metrics、/status和样式表，配置页面和修改配置的接口回复403
+  void setMetricsEndpoint(bool enable) {
+    _metricsOnSTA = enable;
+  }
+
+  // 在配置门户中提供/update固件更新，默认关闭，在begin()之前调用
+  // 只在配置AP运行时接受上传；配置AP没有密码时，任何连接到AP的设备都可以上传固件
+  void setFirmwareUpdate(bool enable) {
+    _updateEnabled = enable;
+  }
+
+  // 最近一次固件更新的状态和进度
+  const WiFiConfigOTA& getOTA() const {
+    return _ota;
+  }
+
+  // 当前连接到配置AP的设备数量
+  int getPortalClientCount() const {
+    return _apStations.load();
+  }
+
   // 设置回调函数
   void setConnectedCallback(void (*callback)());
   void setAPModeCallback(void (*callback)());
+  // 已建立的连接断开时调用，参数为驱动给出的断开原因（wifi_err_reason_t）
+  void setDisconnectedCallback(void (*callback)(uint8_t reason));
 
-  // EEPROM初始化
+  // 配置存储初始化：打开配置日志分区（不存在时使用EEPROM）并加载配置
+  // 从深度睡眠定时唤醒且RTC内存中的副本有效时，直接使用该副本，存储在第一次保存时才打开
   void eepromBegin();
 
-  // 获取配置参数
-  String getMQTTServer() const {
-    return _mqttServer;
+  // 已保存的WiFi网络，按最近配置的顺序排列
+  uint8_t getNetworkCount() const {
+    return wifiConfigNetworkCount(_config);
+  }
+  const char* getNetworkSSID(uint8_t index) const {
+    return index < WIFI_CONFIG_MAX_NETWORKS ? _config.networks[index].ssid.c_str() : "";
+  }
+
+  // 获取配置参数，字符串直接指向内部的配置记录
+  // 配置只在调用loop()的任务中修改（配置页面的保存请求由下一次loop()应用），应在该任务中调用，
+  // 返回的字符串在下一次loop()或修改配置的调用之前有效
+  const char* getMQTTServer() const {
+    return _config.mqttServer.c_str();
   }
-  String getMQTTPort() const {
-    return _mqttPort;
+  uint16_t getMQTTPort() const {
+    return _config.mqttPort;  // 0表示未设置
   }
-  String getMQTTUsername() const {
-    return _mqttUsername;
+  const char* getMQTTUsername() const {
+    return _config.mqttUsername.c_str();
   }
-  String getMQTTPassword() const {
-    return _mqttPassword;
+  const char* getMQTTPassword() const {
+    return _config.mqttPassword.c_str();
   }
-  String getMQTTClientID() const {
-    return _mqttClientID;
+  const char* getMQTTClientID() const {
+    return _config.mqttClientID.c_str();
   }
-  String getUDPPort() const {
-    return _udpPort;
+  uint16_t getUDPPort() const {
+    return _config.udpPort;  // 0表示未设置
   }
-  String getDeviceName() const {
-    return _deviceName;
+  const char* getDeviceName() const {
+    return _config.deviceName.c_str();
   }
   bool getMQTTEnabled() const {
-    return _mqttEnabled == "1";
+    return (_config.flags & WIFI_CONFIG_FLAG_MQTT) != 0;
   }
   bool getUDPEnabled() const {
-    return _udpEnabled == "1";
+    return (_config.flags & WIFI_CONFIG_FLAG_UDP) != 0;
   }
 
 private:
   // AP模式参数
-  String _apSSID;
-  String _apPassword;
+  WiFiConfigString<33> _apSSID;
+  WiFiConfigString<65> _apPassword;
 
-  // 目标WiFi参数
-  String _targetSSID;
-  String _targetPassword;
-
-  // EEPROM地址
+  // 配置存储
   /*
-  AP_MOD: 地址从0开始，长度为1字节
-  SSID: 地址从1开始，长度为32字节(从1到32)
-  PASS: 地址从33开始，长度为32字节(从33到64)
-  MQTT_ENABLE: 地址从65开始，长度为1字节
-  MQTT_DEVICE_ID: 地址从66开始，长度为101字节(从66到166)
-  MQTT_SERVER: 地址从167开始，长度为32字节(从167到198)
-  MQTT_PORT: 地址从199开始，长度为6字节(从199到204)
-  MQTT_USERNAME: 地址从205开始，长度为101字节(从205到305)
-  MQTT_PASSWD: 地址从306开始，长度为257字节(从306到562)
-  UDP_ENABLE: 地址从563开始，长度为1字节
-  UDP_DEVICE_NAME: 地址从564开始，长度为32字节(从564到595)
-  UDP_PORT: 地址从596开始，长度为6字节(从596到601)
-  总共需要602字节的EEPROM空间(从地址0到601)。
+  优先使用名为"wcfg"的Flash数据分区上的配置日志（见WiFiConfigJournal.h和partitions.csv），
+  每次保存追加一条记录，不会反复擦写同一个扇区。
+  分区不存在时回退到EEPROM：
+  地址0到3保留
+  CONFIG: 地址从4开始，为一条完整的WiFiConfigRecord（见WiFiConfigRecord.h）
   */
   int _eepromSize;
-  // 基础设置
-  static const int AP_MOD = 0;  // 1字节
-  static const int SSID = 1;    // 32字节
-  static const int PASS = 33;   // 32字节
-
-  // MQTT配置
-  static const int MQTT_ENABLE = 65;     // 1字节
-  static const int MQTT_DEVICE_ID = 66;  // 101字节
-  static const int MQTT_SERVER = 167;    // 32字节
-  static const int MQTT_PORT = 199;      // 6字节
-  static const int MQTT_USERNAME = 205;  // 101字节
-  static const int MQTT_PASSWD = 306;    // 257字节
-
-  // UDP配置
-  static const int UDP_ENABLE = 563;       // 1字节
-  static const int UDP_DEVICE_NAME = 564;  // 32字节
-  static const int UDP_PORT = 596;         // 6字节
-
-  // 总长度: 602字节
-
-  // MQTT和UDP广播的字段
-  String _mqttServer;
-  String _mqttPort;
-  String _mqttUsername;
-  String _mqttPassword;
-  String _mqttClientID;
-  String _udpPort;
-  String _udpEnabled;
-  String _mqttEnabled;
-  String _deviceName;
+  static const int CONFIG_ADDR = 4;  // sizeof(WiFiConfigRecord)字节
+  WiFiConfigJournal _journal;
+
+  // 当前配置，与存储中的记录结构相同，整体加载和保存
+  WiFiConfigRecord _config;
 
   // DNS服务器相关
-  DNSServer* _dnsServer;
-  String _apDomain;
+  WiFiConfigDNS* _dnsServer;
+  WiFiConfigString<64> _apDomain;
   static const byte DNS_PORT = 53;
+  static const size_t DNS_BUDGET = 16;  // 每次最多处理的DNS查询数
 
   // Web服务器
   WebServer* _server;
@@ -144,6 +227,136 @@ private:
   bool _shouldConnect;
   int _connectionTimeout;
 
+  // 连接状态机
+  ConnectionState _connState;
+  unsigned long _connectStartTime;  // 本次连接开始的时间
+  unsigned long _retryAt;           // 下一次重试的时间
+  int _retryCount;
+
+  // 本轮连接的候选网络，按扫描结果排序
+  struct Candidate {
+    uint8_t network;   // _config.networks中的下标
+    int32_t channel;   // 扫描到的信道，0表示未扫描到
+    uint8_t bssid[6];  // 扫描到的接入点
+  };
+  Candidate _candidates[WIFI_CONFIG_MAX_NETWORKS];
+  uint8_t _candidateCount;
+  uint8_t _candidateIndex;
+  unsigned long _scanStartTime;
+  static const unsigned long SCAN_TIMEOUT = 10000;
+  bool _scanInProgress;             // 驱动中有进行中的异步扫描（连接过程或配置页面发起）
+
+  // 配置页面的网络列表：扫描结果按SSID去重（保留信号最强的接入点）后缓存，供/scan返回
+  // 连接过程中的扫描结果同样会更新缓存
+  struct ScanEntry {
+    WiFiConfigString<33> ssid;
+    int8_t rssi;
+    uint8_t channel;
+    bool secure;
+  };
+  static const uint8_t SCAN_CACHE_SIZE = 16;
+  ScanEntry _scanCache[SCAN_CACHE_SIZE];  // 按信号强度从强到弱排列
+  uint8_t _scanCacheCount;
+  bool _scanCacheValid;
+  unsigned long _scanCachedAt;
+  bool _scanRequested;              // /scan请求了新的扫描，由loop()发起
+  static const unsigned long SCAN_CACHE_TTL = 30000;  // 缓存30秒内的请求不重新扫描
+
+  // 快速连接
+  bool _fastReconnect;
+  bool _reuseLeaseIP;
+  bool _leaseUsable;
+  bool _fastAttempt;
+  static const unsigned long FAST_CONNECT_TIMEOUT = 3000;  // 快速连接失败后改用完整流程
+  uint8_t _unsavedSuccesses;        // 尚未写入存储的连接成功次数
+  static const uint8_t SUCCESS_SAVE_INTERVAL = 8;  // 接入点和地址不变时，每8次连接成功才保存一次统计
+  int _maxRetries;
+  bool _apActive;
+  bool _routesRegistered;           // Web服务器路由只注册一次
+  bool _serverWanted;               // Web服务器应当监听（配置AP运行中，或启用了局域网/metrics）
+  bool _serverStarted;              // Web服务器正在监听，只在处理HTTP请求的任务中修改
+  bool _apTeardownPending;          // 连接成功后等待关闭AP
+  unsigned long _apTeardownAt;
+  static const unsigned long AP_GRACE_PERIOD = 10000;  // 连接成功后AP继续保留10秒，让手机看到结果
+  static const unsigned long RETRY_DELAY = 2000;  // 重试间隔2秒
+
+  // 断线重连：连接成功过一次后由管理器自己负责重连，不使用驱动的自动重连
+  bool _reconnecting;                   // 当前的连接过程是断线后的重连
+  unsigned int _reconnectFailures;      // 连续重连失败的次数
+  unsigned long _reconnectInitialDelay;
+  unsigned long _reconnectMaxDelay;
+  int _failuresBeforePortal;
+
+  // WiFi事件：在WiFi事件任务中更新，由loop()取走处理
+  // 连接状态直接由事件维护，loop()中不需要轮询WiFi.status()
+  enum {
+    EVENT_GOT_IP = 0x01,
+    EVENT_DISCONNECTED = 0x02,
+    EVENT_SCAN_DONE = 0x04
+  };
+  wifi_event_id_t _eventHandlerId;        // 0表示尚未注册
+  std::atomic<uint32_t> _pendingEvents;   // 尚未处理的事件位
+  std::atomic<uint8_t> _disconnectReason;  // 最近一次断开的原因
+  std::atomic<bool> _staConnected;        // 已获得IP地址
+  std::atomic<int> _apStations;           // 连接到AP的设备数量
+
+  // 保存请求分步处理：处理函数只更新内存中的配置并立即回复，
+  // 之后的loop()中依次写入Flash、发起连接，每次只执行一步
+  enum SaveStage {
+    SAVE_IDLE,     // 没有待处理的保存请求
+    SAVE_COMMIT,   // 等待写入存储
+    SAVE_CONNECT   // 等待发起连接
+  };
+  SaveStage _saveStage;
+  bool _saveDirty;      // 待写入的配置与存储中的不同
+  bool _saveReconnect;  // 写入后重新连接；只修改了MQTT、UDP参数时不需要
+  bool _saveFailed;     // 上次写入存储失败，_saveDirty保持设置，通过/status报告
+  unsigned long _saveFailedAt;
+  static const unsigned long SAVE_RETRY_INTERVAL = 5000;  // 写入失败后的重试间隔，避免反复擦写Flash
+  // 处理函数（可能在门户任务中执行）不直接修改_config，而是修改暂存副本，由loop()中的processSave()应用，
+  // 这样_config只在调用loop()的任务中变化，该任务中读取配置的接口不会看到写了一半的字段
+  bool _staged;         // _stagedConfig中有尚未应用的修改
+  WiFiConfigRecord _stagedConfig;
+
+  // 门户任务：启用时DNS和HTTP请求在该任务中处理
+  // _lock保护门户任务和调用loop()的任务共享的状态（配置记录、连接状态、保存流程），未启用时为nullptr；
+  // 门户任务只在DNS处理和HTTP处理函数执行期间持有锁，读取请求时不持有
+  bool _portalTaskEnabled;
+  BaseType_t _portalTaskCore;
+  UBaseType_t _portalTaskPriority;
+  uint32_t _portalTaskStack;
+  TaskHandle_t _portalTask;
+  std::atomic<bool> _portalTaskRun;   // 清除后任务在下一轮退出
+  std::atomic<bool> _portalTaskDone;  // 任务已经退出
+  SemaphoreHandle_t _lock;
+  static const TickType_t PORTAL_TASK_INTERVAL = pdMS_TO_TICKS(2);
+
+  // UDP发现广播
+  WiFiConfigAnnouncer _announcer;
+  unsigned long _announceInterval;
+
+  // MQTT客户端，服务器和登录信息直接引用_config中的字段
+  WiFiConfigMQTT _mqtt;
+
+  // 运行时指标，更新只做relaxed原子操作
+  WiFiConfigCounters _counters;
+  std::atomic<uint32_t> _associatedAt;  // 关联完成的时间（WiFi事件任务中记录）
+  std::atomic<uint32_t> _gotIPAt;       // 获得IP地址的时间（WiFi事件任务中记录）
+  uint32_t _scanMs;                     // 本次连接的扫描耗时
+  bool _metricsOnSTA;
+
+  // 固件更新：激活新固件并回复之后，等待RESTART_DELAY再重启
+  WiFiConfigOTA _ota;
+  bool _updateEnabled;
+  bool _restartPending;
+  unsigned long _restartAt;
+  static const unsigned long RESTART_DELAY = 1000;
+
+  // 从RTC内存恢复配置时不打开存储，第一次保存时才打开
+  bool _storageReady;
+  bool _restoredFromSleep;
+  bool _sleepReuseIP;   // 进入睡眠时要求唤醒后沿用上次的地址
+
   // 防止过多的EEPROM写入
   bool _commitNeeded;
   unsigned long _lastCommitTime;
@@ -152,29 +365,81 @@ private:
   // 回调函数指针
   void (*_connectedCallback)();
   void (*_apModeCallback)();
+  void (*_disconnectedCallback)(uint8_t reason);
 
   // 内部函数
   void setupAPMode();
+  void servicePortal();
+  void startPortalTask();
+  void stopPortalTask();
+  static void portalTaskMain(void* arg);
+  void stopAPMode();
+  void startWebServer();
+  void stopWebServer();
+  void updateWebServer();
   void connectToWiFi();
+  void onWiFiEvent(WiFiEvent_t event, WiFiEventInfo_t info);
+  void onConnected();
+  void startScan();
+  void cacheScanResults(int found);
+  void configureMQTT();
+  void configureAnnouncer();
+  void onAttemptFailed();
+  void scheduleReconnect();
+  bool reconnectPortalDue() const;
+  bool beginFastAttempt();
+  void beginFullConnect();
+  void rankNetworks(int found);
+  void beginAttempt();
+  void recordSuccess();
+  void updateConnection();
   void handleRoot();
+  void handleStyle();
   void handleSave();
+  void handleGetConfig();
+  void handlePutConfig();
+  void handlePutConfigBody();
+  void processSave();
+  void storeDirtyConfig();
+  const WiFiConfigRecord& portalConfig() const;
+  WiFiConfigRecord& stageConfig();
+  void applyStagedConfig();
+  void printConfig();
+  void handleStatus();
+  void handleMetrics();
+  void handleScan();
+  void handleUpdate();
+  void handleUpdateUpload();
+  void handleUpdateStatus();
   void handleNotFound();
+  // portalOnly的处理函数只在配置AP运行时执行，否则回复403
+  void runHandler(void (WiFiConfigManager::*handler)(), bool portalOnly = false);
+  void sendGzipPage(const uint8_t* data, size_t length, const char* contentType, const char* etag);
+  static bool resolvePlaceholder(void* context, const char* name, size_t nameLength, WiFiConfigChunkWriter& out);
 
-  // EEPROM操作函数
-  String readFromEEPROM(int startAddr, int maxLength);
-  bool writeToEEPROM(int startAddr, const String& data, int maxLength);
+  // 配置存储操作函数
   void commitEEPROM();
-  void loadConfigFromEEPROM();
+  void openStorage();
+  void loadConfig();
+  const char* loadConfigFromEEPROM();
+  bool importLegacyEEPROM();
+  bool saveConfig();
 
   // 静态回调处理器
   static WiFiConfigManager* _instance;
   static void handleRootWrapper();
+  static void handleStyleWrapper();
   static void handleSaveWrapper();
+  static void handleGetConfigWrapper();
+  static void handlePutConfigWrapper();
+  static void handlePutConfigBodyWrapper();
+  static void handleStatusWrapper();
+  static void handleMetricsWrapper();
+  static void handleScanWrapper();
+  static void handleUpdateWrapper();
+  static void handleUpdateUploadWrapper();
+  static void handleUpdateStatusWrapper();
   static void handleNotFoundWrapper();
-
-  // HTML页面
-  const char* _htmlPage;
-  const char* _successPage;
 };
 
 #endif  // WIFI_CONFIG_MANAGER_H
@@ -0,0 +1,80 @@
+#include "WiFiConfigMetrics.h"
+
+const uint32_t WiFiConfigLatencyHistogram::BOUNDS[WIFI_CONFIG_LATENCY_BUCKETS - 1] = {
+  50, 100, 250, 500, 1000, 5000, 25000
+};
+
+WiFiConfigLatencyHistogram::WiFiConfigLatencyHistogram()
+  : _count(0),
+    _sumUs(0),
+    _maxUs(0) {
+  for (size_t i = 0; i < WIFI_CONFIG_LATENCY_BUCKETS; i++) {
+    _buckets[i] = 0;
+  }
+}
+
+// 各字段分别读取，与并发的record()之间可能相差一次记录
+void WiFiConfigLatencyHistogram::snapshot(WiFiConfigLatency& out) const {
+  for (size_t i = 0; i < WIFI_CONFIG_LATENCY_BUCKETS; i++) {
+    out.buckets[i] = _buckets[i].load(std::memory_order_relaxed);
+  }
+  out.count = _count.load(std::memory_order_relaxed);
+  out.sumUs = _sumUs.load(std::memory_order_relaxed);
+  out.maxUs = _maxUs.load(std::memory_order_relaxed);
+}
+
+// 直方图按Prometheus的约定输出累计的桶，单位为秒
+static void writeHistogram(WiFiConfigChunkWriter& out, const char* name, const char* help,
+                           const WiFiConfigLatency& latency) {
+  char line[128];
+  snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s histogram\n", name, help, name);
+  out.print(line);
+
+  uint32_t cumulative = 0;
+  for (size_t i = 0; i < WIFI_CONFIG_LATENCY_BUCKETS; i++) {
+    cumulative += latency.buckets[i];
+    if (i < WIFI_CONFIG_LATENCY_BUCKETS - 1) {
+      uint32_t bound = WiFiConfigLatencyHistogram::BOUNDS[i];
+      snprintf(line, sizeof(line), "%s_bucket{le=\"%lu.%06lu\"} %lu\n", name, (unsigned long)(bound / 1000000),
+               (unsigned long)(bound % 1000000), (unsigned long)cumulative);
+    } else {
+      snprintf(line, sizeof(line), "%s_bucket{le=\"+Inf\"} %lu\n", name, (unsigned long)cumulative);
+    }
+    out.print(line);
+  }
+  snprintf(line, sizeof(line), "%s_sum %lu.%06lu\n%s_count %lu\n", name, (unsigned long)(latency.sumUs / 1000000),
+           (unsigned long)(latency.sumUs % 1000000), name, (unsigned long)latency.count);
+  out.print(line);
+}
+
+static void writeValue(WiFiConfigChunkWriter& out, const char* name, const char* type, const char* help,
+                       long value) {
+  char line[256];
+  snprintf(line, sizeof(line), "# HELP %s %s\n# TYPE %s %s\n%s %ld\n", name, help, name, type, name, value);
+  out.print(line);
+}
+
+void wifiConfigWriteMetrics(WiFiConfigChunkWriter& out, const WiFiConfigMetrics& metrics) {
+  writeHistogram(out, "wificonfig_loop_seconds", "Duration of WiFiConfigManager::loop().", metrics.loop);
+  writeHistogram(out, "wificonfig_dns_batch_seconds", "Time to answer a batch of captive DNS queries.", metrics.dns);
+  writeHistogram(out, "wificonfig_http_handler_seconds", "Duration of portal HTTP handlers.", metrics.http);
+
+  writeValue(out, "wificonfig_connect_scan_ms", "gauge", "Scan phase of the last connection.", metrics.lastScanMs);
+  writeValue(out, "wificonfig_connect_auth_ms", "gauge", "WiFi.begin() to association of the last connection.",
+             metrics.lastAuthMs);
+  writeValue(out, "wificonfig_connect_dhcp_ms", "gauge", "DHCP phase of the last connection.", metrics.lastDhcpMs);
+  writeValue(out, "wificonfig_connects_total", "counter", "Successful connections.", metrics.connects);
+  writeValue(out, "wificonfig_connect_failures_total", "counter", "Failed connection attempts.",
+             metrics.connectFailures);
+  writeValue(out, "wificonfig_link_losses_total", "counter", "Established connections that dropped.",
+             metrics.linkLosses);
+
+  writeValue(out, "wificonfig_flash_commits_total", "counter", "Configuration writes to flash.", metrics.flashCommits);
+  writeValue(out, "wificonfig_flash_bytes_total", "counter", "Bytes written to flash.", metrics.flashBytes);
+
+  writeValue(out, "wificonfig_heap_free_bytes", "gauge", "Free heap.", metrics.freeHeap);
+  writeValue(out, "wificonfig_heap_largest_block_bytes", "gauge", "Largest allocatable heap block.",
+             metrics.largestFreeBlock);
+  writeValue(out, "wificonfig_rssi_dbm", "gauge", "Signal strength, 0 when not connected.", metrics.rssi);
+  writeValue(out, "wificonfig_uptime_seconds", "counter", "Seconds since boot.", metrics.uptimeS);
+}
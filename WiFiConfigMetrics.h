@@ -0,0 +1,97 @@
+#ifndef WIFI_CONFIG_METRICS_H
+#define WIFI_CONFIG_METRICS_H
+
+#include <Arduino.h>
+#include <atomic>
+#include "WiFiConfigTemplate.h"
+
+// 耗时直方图的桶数，各桶上界见WIFI_CONFIG_LATENCY_BOUNDS，最后一个桶没有上界
+#define WIFI_CONFIG_LATENCY_BUCKETS 8
+
+// 耗时直方图的快照
+struct WiFiConfigLatency {
+  uint32_t buckets[WIFI_CONFIG_LATENCY_BUCKETS];  // 各桶的次数（不累加）
+  uint32_t count;
+  uint32_t sumUs;   // 总耗时，超过约71分钟后回绕
+  uint32_t maxUs;
+};
+
+// 运行时指标的快照，由WiFiConfigManager::getMetrics()返回
+struct WiFiConfigMetrics {
+  WiFiConfigLatency loop;  // 每次loop()的耗时
+  WiFiConfigLatency dns;   // 每批DNS查询的处理耗时
+  WiFiConfigLatency http;  // 每个HTTP处理函数的耗时
+
+  // 最近一次连接各阶段的耗时（毫秒）：扫描（使用缓存的接入点时为0）、
+  // 从WiFi.begin()到关联完成（包括驱动自己的扫描和四次握手）、DHCP
+  uint32_t lastScanMs;
+  uint32_t lastAuthMs;
+  uint32_t lastDhcpMs;
+  uint32_t connects;         // 连接成功的次数
+  uint32_t connectFailures;  // 单次连接尝试失败的次数
+  uint32_t linkLosses;       // 已建立的连接断开的次数
+
+  uint32_t flashCommits;     // 配置写入存储的次数
+  uint32_t flashBytes;       // 写入存储的字节数
+
+  // 以下在读取快照时采样
+  uint32_t freeHeap;
+  uint32_t largestFreeBlock;
+  int8_t rssi;               // 未连接时为0
+  uint32_t uptimeS;
+};
+
+// 耗时直方图：固定的桶，记录一次只需要几次比较和relaxed原子加法，不加锁
+class WiFiConfigLatencyHistogram {
+public:
+  WiFiConfigLatencyHistogram();
+
+  void record(uint32_t us) {
+    size_t i = 0;
+    while (i < WIFI_CONFIG_LATENCY_BUCKETS - 1 && us > BOUNDS[i]) {
+      i++;
+    }
+    _buckets[i].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sumUs.fetch_add(us, std::memory_order_relaxed);
+    // 只有一个任务写入（loop()或持有锁的门户任务），不需要比较交换
+    if (us > _maxUs.load(std::memory_order_relaxed)) {
+      _maxUs.store(us, std::memory_order_relaxed);
+    }
+  }
+
+  void snapshot(WiFiConfigLatency& out) const;
+
+  // 各桶的上界（微秒）
+  static const uint32_t BOUNDS[WIFI_CONFIG_LATENCY_BUCKETS - 1];
+
+private:
+  std::atomic<uint32_t> _buckets[WIFI_CONFIG_LATENCY_BUCKETS];
+  std::atomic<uint32_t> _count;
+  std::atomic<uint32_t> _sumUs;
+  std::atomic<uint32_t> _maxUs;
+};
+
+// 管理器内部的计数器，热路径上只做relaxed原子操作
+struct WiFiConfigCounters {
+  WiFiConfigLatencyHistogram loop;
+  WiFiConfigLatencyHistogram dns;
+  WiFiConfigLatencyHistogram http;
+  std::atomic<uint32_t> lastScanMs{ 0 };
+  std::atomic<uint32_t> lastAuthMs{ 0 };
+  std::atomic<uint32_t> lastDhcpMs{ 0 };
+  std::atomic<uint32_t> connects{ 0 };
+  std::atomic<uint32_t> connectFailures{ 0 };
+  std::atomic<uint32_t> linkLosses{ 0 };
+  std::atomic<uint32_t> flashCommits{ 0 };
+  std::atomic<uint32_t> flashBytes{ 0 };
+
+  static void add(std::atomic<uint32_t>& counter, uint32_t value = 1) {
+    counter.fetch_add(value, std::memory_order_relaxed);
+  }
+};
+
+// 以Prometheus文本格式输出指标，边生成边发送
+void wifiConfigWriteMetrics(WiFiConfigChunkWriter& out, const WiFiConfigMetrics& metrics);
+
+#endif  // WIFI_CONFIG_METRICS_H
@@ -0,0 +1,115 @@
+#include "WiFiConfigOTA.h"
+
+static int hexValue(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+  return -1;
+}
+
+WiFiConfigOTA::WiFiConfigOTA()
+  : _state(OTA_IDLE),
+    _written(0),
+    _size(0),
+    _error(nullptr) {
+  mbedtls_sha256_init(&_sha);
+  memset(_expected, 0, sizeof(_expected));
+}
+
+WiFiConfigOTA::~WiFiConfigOTA() {
+  if (_state == OTA_RECEIVING) {
+    Update.abort();
+  }
+  mbedtls_sha256_free(&_sha);
+}
+
+bool WiFiConfigOTA::begin(const char* expectedSha256, size_t size) {
+  if (_state == OTA_RECEIVING) {
+    abort("superseded by a new upload");
+  }
+  _state = OTA_RECEIVING;
+  _written = 0;
+  _size = size;
+  _error = nullptr;
+
+  // 没有预期的摘要就无法在激活前校验，直接拒绝
+  if (!expectedSha256 || strlen(expectedSha256) != sizeof(_expected) * 2) {
+    return fail("sha256 must be 64 hex digits");
+  }
+  for (size_t i = 0; i < sizeof(_expected); i++) {
+    int high = hexValue(expectedSha256[i * 2]);
+    int low = hexValue(expectedSha256[i * 2 + 1]);
+    if (high < 0 || low < 0) {
+      return fail("sha256 must be 64 hex digits");
+    }
+    _expected[i] = (uint8_t)(high << 4 | low);
+  }
+
+  if (!Update.begin(size ? size : UPDATE_SIZE_UNKNOWN)) {
+    return fail(Update.errorString());
+  }
+  // mbedTLS 2.x中这些函数没有返回值，3.x中返回值在参数有效时总是0，这里不检查
+  mbedtls_sha256_starts(&_sha, 0);
+  return true;
+}
+
+bool WiFiConfigOTA::write(const uint8_t* data, size_t length) {
+  if (_state != OTA_RECEIVING) {
+    return false;
+  }
+  if (_size && _written + length > _size) {
+    abort("image larger than announced size");
+    return false;
+  }
+  // Update.write()的参数不是const，但不会修改数据
+  if (Update.write(const_cast<uint8_t*>(data), length) != length) {
+    const char* reason = Update.errorString();
+    Update.abort();
+    return fail(reason);
+  }
+  mbedtls_sha256_update(&_sha, data, length);
+  _written += length;
+  return true;
+}
+
+bool WiFiConfigOTA::end() {
+  if (_state != OTA_RECEIVING) {
+    return false;
+  }
+  if (_size && _written != _size) {
+    abort("image smaller than announced size");
+    return false;
+  }
+
+  uint8_t digest[32];
+  mbedtls_sha256_finish(&_sha, digest);
+  // 逐字节累加差异，比较时间与内容无关
+  uint8_t diff = 0;
+  for (size_t i = 0; i < sizeof(digest); i++) {
+    diff |= digest[i] ^ _expected[i];
+  }
+  if (diff) {
+    abort("sha256 mismatch");
+    return false;
+  }
+
+  // 摘要一致后才激活：Update.end()校验镜像格式并设置启动分区
+  if (!Update.end(true)) {
+    return fail(Update.errorString());
+  }
+  _state = OTA_DONE;
+  return true;
+}
+
+void WiFiConfigOTA::abort(const char* reason) {
+  if (_state == OTA_RECEIVING) {
+    Update.abort();
+  }
+  fail(reason);
+}
+
+bool WiFiConfigOTA::fail(const char* reason) {
+  _state = OTA_FAILED;
+  _error = reason;
+  return false;
+}
@@ -0,0 +1,64 @@
+#ifndef WIFI_CONFIG_OTA_H
+#define WIFI_CONFIG_OTA_H
+
+#include <Arduino.h>
+#include <Update.h>
+#include <mbedtls/sha256.h>
+
+// 通过配置门户上传的固件更新
+/*
+  上传的数据每收到一段就交给Update.write()写入未运行的OTA分区，同时累加SHA-256，
+  整个镜像不会保存在内存中（Update内部只缓存一个4KB扇区）。
+  全部收到后先核对大小和SHA-256，一致时才调用Update.end()把分区标记为下次启动的分区；
+  不一致或上传中断时调用Update.abort()，当前运行的固件不受影响。
+*/
+class WiFiConfigOTA {
+public:
+  enum State {
+    OTA_IDLE,       // 没有进行过更新
+    OTA_RECEIVING,  // 正在接收和写入
+    OTA_DONE,       // 已校验并激活，重启后运行新固件
+    OTA_FAILED      // 最近一次更新失败，原因见error()
+  };
+
+  WiFiConfigOTA();
+  ~WiFiConfigOTA();
+
+  // 开始接收固件；expectedSha256为64个十六进制字符（不区分大小写），
+  // size为0表示大小未知，以OTA分区的大小为上限
+  bool begin(const char* expectedSha256, size_t size);
+  // 写入一段数据，失败后之后的数据都被忽略
+  bool write(const uint8_t* data, size_t length);
+  // 数据全部收到：核对大小和SHA-256，一致时激活新固件
+  bool end();
+  // 放弃正在进行的更新
+  void abort(const char* reason);
+
+  State state() const {
+    return _state;
+  }
+  // 已写入的字节数
+  size_t written() const {
+    return _written;
+  }
+  // 预期的大小，0表示未知
+  size_t size() const {
+    return _size;
+  }
+  // 失败原因，没有失败时为nullptr
+  const char* error() const {
+    return _error;
+  }
+
+private:
+  bool fail(const char* reason);
+
+  mbedtls_sha256_context _sha;
+  uint8_t _expected[32];
+  State _state;
+  size_t _written;
+  size_t _size;
+  const char* _error;
+};
+
+#endif  // WIFI_CONFIG_OTA_H
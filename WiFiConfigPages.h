@@ -0,0 +1,211 @@
+// 由tools/embed_pages.py根据html/目录生成，请勿手动修改
+#ifndef WIFI_CONFIG_PAGES_H
+#define WIFI_CONFIG_PAGES_H
+
+#include <Arduino.h>
+
+// html/index.html: 4075字节模板
+static const char PAGE_INDEX_TEMPLATE[] PROGMEM = R"rawliteral(<!DOCTYPE html>
+<html>
+<head>
+    <title>ESP32 WiFi Configuration</title>
+    <meta name="viewport" content="width=device-width, initial-scale=1">
+    <link rel="stylesheet" href="/style.css">
+    <script>
+        function toggleMQTT() {
+            var checkbox = document.getElementById('enableMQTT');
+            var mqttConfig = document.getElementById('mqttConfig');
+            mqttConfig.className = checkbox.checked ? 'mqtt-config' : 'mqtt-config hidden';
+        }
+
+        function toggleUDP() {
+            var checkbox = document.getElementById('enableUDP');
+            var udpConfig = document.getElementById('udpConfig');
+            udpConfig.className = checkbox.checked ? 'udp-config' : 'udp-config hidden';
+        }
+        // 从/scan取得附近的网络填入SSID输入框的候选列表；设备仍在扫描时稍后再取
+        function loadNetworks(attempt) {
+            var xhr = new XMLHttpRequest();
+            xhr.open('GET', '/scan');
+            xhr.onload = function() {
+                if (xhr.status != 200) return;
+                var result = JSON.parse(xhr.responseText);
+                var list = document.getElementById('ssidList');
+                list.innerHTML = '';
+                for (var i = 0; i < result.networks.length; i++) {
+                    var net = result.networks[i];
+                    var option = document.createElement('option');
+                    option.value = net.ssid;
+                    option.label = net.rssi + ' dBm' + (net.secure ? '' : ', open');
+                    list.appendChild(option);
+                }
+                if (result.scanning && attempt < 10) {
+                    setTimeout(function() { loadNetworks(attempt + 1); }, 1500);
+                }
+            };
+            xhr.send();
+        }
+
+        window.onload = function() {
+            toggleMQTT();
+            toggleUDP();
+            loadNetworks(0);
+        }
+    </script>
+</head>
+<body>
+    <div class="container">
+        <h1>ESP32 WiFi Configuration</h1>
+        <form action="/save" method="post">
+            <h2>WiFi Settings</h2>
+            <label for="ssid">WiFi SSID:</label>
+            <input %SSID% list="ssidList" autocomplete="off" placeholder="Enter or pick a WiFi name" required>
+            <datalist id="ssidList"></datalist>
+
+            <label for="password">WiFi Password:</label>
+            <input %PASSWORD% placeholder="Enter WiFi password (leave empty to keep the saved one)">
+
+            <h2>MQTT Configuration</h2>
+            <label>
+                <input %ENABLE_MQTT% onchange="toggleMQTT()"> Enable MQTT Connection
+            </label>
+
+            <div id="mqttConfig" class="mqtt-config hidden">
+                <label for="mqttServer">MQTT Server Address:</label>
+                <input %MQTT_SERVER% placeholder="e.g., mqtt.example.com">
+
+                <label for="mqttPort">MQTT Port:</label>
+                <input %MQTT_PORT% placeholder="e.g., 1883">
+
+                <label for="mqttUsername">MQTT Username:</label>
+                <input %MQTT_USERNAME% placeholder="Enter MQTT username">
+
+                <label for="mqttPassword">MQTT Password:</label>
+                <input %MQTT_PASSWORD% placeholder="Enter MQTT password (leave empty to keep the saved one)">
+
+                <label for="mqttClientID">MQTT Client ID:</label>
+                <input %MQTT_CLIENT_ID% placeholder="Enter MQTT client ID">
+            </div>
+
+            <h2>UDP Broadcast</h2>
+            <label>
+                <input %ENABLE_UDP% onchange="toggleUDP()"> Enable Periodic UDP Broadcast
+            </label>
+
+            <div id="udpConfig" class="udp-config hidden">
+                <label for="udpPort">UDP Broadcast Port:</label>
+                <input %UDP_PORT% placeholder="e.g., 4210">
+
+                <label for="deviceName">Device Name:</label>
+                <input %DEVICE_NAME% placeholder="Enter device name">
+            </div>
+
+            <input type="submit" value="Save Configuration">
+        </form>
+        <p id="status"></p>
+    </div>
+</body>
+</html>
+)rawliteral";
+
+
+// html/style.css: 1172字节，gzip后477字节
+static const uint8_t PAGE_STYLE_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x7d, 0x54, 0xdb, 0x6e, 0x9c, 0x30,
+  0x10, 0x7d, 0xe7, 0x2b, 0x2c, 0xad, 0x22, 0xb5, 0xd2, 0xb2, 0x82, 0xbd, 0x44, 0x09, 0x51, 0x1f,
+  0xa2, 0x48, 0xfd, 0x89, 0x2a, 0x0f, 0xc6, 0x36, 0x30, 0x5a, 0x63, 0xbb, 0xb6, 0x09, 0x6c, 0xab,
+  0xfd, 0xf7, 0x1a, 0xb0, 0xb7, 0x2c, 0x90, 0x60, 0x5e, 0x3c, 0xcc, 0xf1, 0x9c, 0x73, 0x66, 0x4c,
+  0x2e, 0xe9, 0x05, 0xfd, 0x8d, 0x90, 0x7b, 0x0a, 0x29, 0x6c, 0x5c, 0xe0, 0x1a, 0xf8, 0x25, 0x43,
+  0xaf, 0x1a, 0x30, 0xdf, 0x22, 0x83, 0x85, 0x89, 0x0d, 0xd3, 0x50, 0xbc, 0x0c, 0x39, 0x35, 0xd6,
+  0x25, 0x88, 0x0c, 0x25, 0xe3, 0x56, 0x61, 0x4a, 0x41, 0x94, 0x19, 0xda, 0x27, 0xaa, 0x1b, 0x43,
+  0x39, 0x26, 0xe7, 0x52, 0xcb, 0x46, 0xd0, 0x98, 0x48, 0x2e, 0x75, 0x86, 0x36, 0xc5, 0xbe, 0x5f,
+  0x2f, 0xd1, 0x35, 0xda, 0x11, 0x57, 0x03, 0x83, 0x60, 0xda, 0xd7, 0x5c, 0x66, 0xb7, 0x15, 0x58,
+  0xe6, 0x8f, 0x92, 0x9a, 0x32, 0x1d, 0x6b, 0x4c, 0xa1, 0x31, 0x19, 0x7a, 0x0a, 0x25, 0xd6, 0xaa,
+  0xca, 0x2e, 0x36, 0x15, 0xa6, 0xb2, 0x75, 0xdc, 0xd0, 0x5e, 0x75, 0x28, 0x75, 0xdf, 0x90, 0x2e,
+  0x73, 0xfc, 0x2d, 0xd9, 0x22, 0xff, 0xee, 0xd2, 0xef, 0x41, 0x46, 0x17, 0xb7, 0x40, 0x6d, 0x95,
+  0xa1, 0x53, 0x72, 0x3b, 0xe4, 0x26, 0x0e, 0xe1, 0xc6, 0xca, 0x9e, 0x6f, 0x95, 0x7a, 0x9e, 0x41,
+  0x4a, 0x92, 0x3c, 0x3e, 0x12, 0x32, 0xa6, 0x5b, 0xd6, 0xd9, 0x18, 0x73, 0x28, 0x1d, 0x84, 0x30,
+  0x61, 0x99, 0x1e, 0x20, 0xfb, 0x19, 0xe4, 0x70, 0x38, 0x4c, 0x8f, 0x8f, 0xad, 0x54, 0x81, 0xf9,
+  0x35, 0xe2, 0x38, 0x67, 0xdc, 0x03, 0x28, 0x18, 0xc5, 0xb1, 0xf3, 0x3e, 0xe7, 0x92, 0x9c, 0x97,
+  0x98, 0xf4, 0x46, 0x74, 0xe8, 0x54, 0xcb, 0xa0, 0xac, 0xac, 0xcb, 0x96, 0x9c, 0xf6, 0x47, 0x81,
+  0x50, 0x8d, 0xfd, 0x65, 0x2f, 0x8a, 0xfd, 0xe8, 0x99, 0xbd, 0x6f, 0xd1, 0x24, 0xa2, 0xb0, 0x31,
+  0xad, 0xb3, 0xf3, 0x3e, 0x2a, 0x9a, 0x3a, 0x67, 0xfa, 0xdd, 0xd7, 0xf7, 0x86, 0xa4, 0x49, 0xf2,
+  0x30, 0xf3, 0x39, 0x5d, 0x58, 0xe4, 0x7a, 0x11, 0x66, 0xe0, 0x46, 0x1b, 0x04, 0x77, 0x9d, 0x8d,
+  0x27, 0xec, 0xc7, 0x06, 0x3a, 0xbc, 0xcb, 0x36, 0x92, 0x03, 0x45, 0x1b, 0x12, 0xdc, 0x9b, 0x35,
+  0xf7, 0x78, 0xd7, 0x49, 0xf8, 0x33, 0xd4, 0xf5, 0x39, 0x2e, 0x34, 0x13, 0x48, 0x2a, 0x46, 0xce,
+  0x2e, 0x1c, 0xa8, 0x7b, 0x9b, 0xf4, 0xe8, 0x48, 0xea, 0xcd, 0x9d, 0x00, 0x4c, 0x93, 0xd7, 0x60,
+  0x3f, 0x55, 0xba, 0x32, 0xb4, 0xc7, 0xb7, 0xd7, 0x9f, 0x27, 0x2f, 0x71, 0x39, 0x9a, 0xff, 0xad,
+  0x71, 0xc4, 0x27, 0x73, 0xb8, 0xe2, 0x4f, 0x30, 0x41, 0x48, 0xc1, 0xbe, 0x96, 0x4e, 0x1a, 0x6d,
+  0xfa, 0x3a, 0x4a, 0x42, 0x98, 0xa6, 0xa5, 0x84, 0xac, 0x92, 0x1f, 0x5f, 0x5c, 0x9f, 0xcd, 0xf1,
+  0x84, 0x93, 0xe3, 0xf3, 0x70, 0xd9, 0xea, 0xdf, 0xd6, 0xba, 0xb8, 0x28, 0xa0, 0xdc, 0xa2, 0x5d,
+  0x43, 0x95, 0xdf, 0x78, 0xf0, 0x4a, 0x7b, 0x57, 0x1a, 0x46, 0x29, 0x5d, 0x65, 0x7d, 0xba, 0x97,
+  0x3c, 0x1f, 0xd1, 0xb5, 0xdf, 0xc0, 0x73, 0xbf, 0x06, 0x66, 0x15, 0x50, 0xca, 0xc4, 0x7c, 0xee,
+  0x47, 0x87, 0xae, 0xd1, 0x3f, 0x8f, 0x4d, 0xe4, 0x2f, 0x94, 0x04, 0x00, 0x00,
+};
+
+static const char PAGE_STYLE_ETAG[] = "\"9a69436c8cb274c1\"";
+
+// html/success.html: 2193字节，gzip后897字节
+static const uint8_t PAGE_SUCCESS_GZ[] PROGMEM = {
+  0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xa5, 0x56, 0x6d, 0x6f, 0xdb, 0x36,
+  0x10, 0xfe, 0xde, 0x5f, 0x71, 0xd1, 0x80, 0x4a, 0x46, 0x6d, 0xd9, 0xce, 0xd0, 0x60, 0xb0, 0x25,
+  0x0f, 0x5d, 0x96, 0x01, 0xf9, 0xb4, 0x00, 0x29, 0x50, 0xf4, 0x23, 0x4d, 0x9e, 0x24, 0x2e, 0x34,
+  0x29, 0x90, 0x94, 0x5f, 0x36, 0xe4, 0xbf, 0xef, 0x68, 0x59, 0x76, 0x2d, 0x3b, 0xdd, 0x86, 0xd1,
+  0x06, 0x2c, 0xf1, 0x8e, 0x0f, 0x9f, 0xbb, 0x7b, 0xee, 0x92, 0xec, 0xe6, 0xd7, 0xdf, 0xef, 0x3f,
+  0x7f, 0x7d, 0x7a, 0x80, 0xca, 0xaf, 0xd4, 0xe2, 0x5d, 0xd6, 0xfd, 0x20, 0x13, 0x8b, 0x77, 0x40,
+  0x2b, 0xf3, 0xd2, 0x2b, 0x5c, 0xdc, 0x1b, 0x5d, 0xc8, 0xb2, 0xb1, 0xcc, 0x4b, 0xa3, 0xe1, 0xb9,
+  0xe1, 0x1c, 0x9d, 0x2b, 0x1a, 0x95, 0x8d, 0x5b, 0x7b, 0xeb, 0xbb, 0x42, 0xcf, 0x40, 0xb3, 0x15,
+  0xe6, 0xd1, 0x5a, 0xe2, 0xa6, 0x36, 0xd6, 0x47, 0xc0, 0x8d, 0xf6, 0xa8, 0x7d, 0x1e, 0x6d, 0xa4,
+  0xf0, 0x55, 0x2e, 0x70, 0x2d, 0x39, 0x8e, 0xf6, 0x2f, 0x43, 0x90, 0x5a, 0x7a, 0xc9, 0xd4, 0xc8,
+  0x71, 0xa6, 0x30, 0x9f, 0x46, 0x07, 0x20, 0xe7, 0x77, 0x1d, 0x68, 0x58, 0x4b, 0x23, 0x76, 0xf0,
+  0xd7, 0xf1, 0x35, 0xac, 0x82, 0x50, 0x47, 0x05, 0x5b, 0x49, 0xb5, 0x9b, 0xc1, 0x27, 0x4b, 0x18,
+  0x43, 0x70, 0x4c, 0xbb, 0x91, 0x43, 0x2b, 0x8b, 0xf9, 0x99, 0xef, 0x8a, 0xd9, 0x52, 0xea, 0x19,
+  0x4c, 0xce, 0xb7, 0x6b, 0x26, 0x84, 0xd4, 0xe5, 0x0c, 0x6e, 0x27, 0xf5, 0xf6, 0xdc, 0xb4, 0x64,
+  0xfc, 0xa5, 0xb4, 0xa6, 0xd1, 0x62, 0xc4, 0x8d, 0x32, 0x76, 0x06, 0x3f, 0x14, 0xb7, 0xe1, 0x73,
+  0xee, 0xe6, 0x71, 0xeb, 0x47, 0x4c, 0xc9, 0x92, 0xc0, 0x39, 0xc5, 0x88, 0xf6, 0x64, 0x7f, 0x3d,
+  0x3e, 0xa5, 0x21, 0x03, 0x4c, 0x6a, 0xb4, 0xbd, 0x18, 0x2e, 0x6f, 0xd9, 0x54, 0xd2, 0x63, 0x8f,
+  0x8a, 0xb1, 0x02, 0xed, 0xc8, 0x32, 0x21, 0x1b, 0x37, 0x83, 0x9f, 0xfa, 0x54, 0xbf, 0x17, 0x85,
+  0xd9, 0x8e, 0x5c, 0xc5, 0x84, 0xd9, 0x50, 0xec, 0x70, 0x5b, 0x6f, 0x61, 0x4a, 0x3e, 0x60, 0xcb,
+  0x25, 0x4b, 0x26, 0x43, 0x38, 0x7c, 0xd3, 0xe9, 0xa0, 0x9f, 0xae, 0x6d, 0x5b, 0x9e, 0x19, 0x7c,
+  0x9c, 0x5c, 0x80, 0x1e, 0x93, 0x09, 0xac, 0xf1, 0xe6, 0x5a, 0xbc, 0xd5, 0xb4, 0x17, 0x67, 0x97,
+  0xc2, 0xc9, 0xe4, 0xee, 0x8e, 0xf3, 0x6b, 0x47, 0xea, 0x6b, 0xd5, 0x75, 0xf2, 0x4f, 0x9c, 0xc1,
+  0xf4, 0xae, 0xcf, 0x40, 0x51, 0x2a, 0x47, 0x15, 0xca, 0xb2, 0xf2, 0x64, 0x4e, 0x3f, 0xf6, 0x01,
+  0xb3, 0xf1, 0x41, 0x3e, 0xd9, 0xb8, 0xd5, 0x71, 0x16, 0xf4, 0x73, 0x50, 0x96, 0x90, 0x6b, 0xe0,
+  0x8a, 0x39, 0x97, 0x47, 0xc7, 0xb2, 0x44, 0x27, 0xa5, 0x65, 0xd5, 0x74, 0xf1, 0x45, 0xfe, 0x26,
+  0xe1, 0x2d, 0xc1, 0xdf, 0x10, 0xe8, 0xf4, 0x1b, 0xff, 0x7a, 0xf1, 0xf0, 0xfc, 0xf4, 0xe3, 0x2d,
+  0x6c, 0xa4, 0x52, 0xe0, 0xed, 0x0e, 0xbc, 0x09, 0x8a, 0xd7, 0xc8, 0x7d, 0x78, 0xf4, 0x15, 0xc2,
+  0x1e, 0x4f, 0xa3, 0xdf, 0x18, 0xfb, 0x02, 0x3b, 0xd3, 0x80, 0xab, 0x91, 0xcb, 0x42, 0xa2, 0x48,
+  0xb3, 0x71, 0xfd, 0x2d, 0x16, 0x48, 0x91, 0x47, 0xce, 0x33, 0xdf, 0xb8, 0x28, 0xb4, 0x5c, 0x40,
+  0xa1, 0xda, 0xa6, 0xe9, 0x75, 0x47, 0xb6, 0xc6, 0x68, 0xd1, 0xb3, 0x2c, 0x1e, 0x8b, 0xee, 0xfe,
+  0x40, 0x5c, 0x3a, 0x70, 0x47, 0xee, 0x43, 0xa2, 0x43, 0x1b, 0x9f, 0x9e, 0x5a, 0xb6, 0xae, 0x6a,
+  0x3c, 0x90, 0x38, 0x34, 0xb0, 0x82, 0xa4, 0x0b, 0x0c, 0x0a, 0xdc, 0x80, 0x43, 0x3a, 0x2e, 0x5c,
+  0xfa, 0x7d, 0xdc, 0x82, 0x49, 0xe5, 0x4e, 0x78, 0xc4, 0x79, 0xe7, 0x80, 0xad, 0x69, 0x97, 0x2d,
+  0x15, 0x02, 0xd3, 0x62, 0x1f, 0x29, 0x67, 0x1a, 0x32, 0x06, 0x95, 0xc5, 0x22, 0x8f, 0xc6, 0xd1,
+  0x82, 0x1f, 0xb2, 0x4a, 0x1e, 0x25, 0xa5, 0x3e, 0x1b, 0xb3, 0xc5, 0xe9, 0xa2, 0x6c, 0x4c, 0xc5,
+  0xe9, 0x06, 0x00, 0xb7, 0xb2, 0xf6, 0x27, 0x02, 0x45, 0xa3, 0xdb, 0x8b, 0x6b, 0xa3, 0x54, 0x32,
+  0xe8, 0xcb, 0x05, 0x3d, 0xaf, 0x92, 0x78, 0xdc, 0xa6, 0x2e, 0x1e, 0xa4, 0x94, 0x76, 0x9d, 0x74,
+  0x67, 0x12, 0x4b, 0xfe, 0x60, 0xd1, 0x37, 0x56, 0x83, 0x4d, 0xff, 0x70, 0xb4, 0x35, 0x98, 0xc3,
+  0x6b, 0xdf, 0xcd, 0xf5, 0x61, 0xc3, 0x5a, 0x33, 0x0b, 0xa8, 0x20, 0xa7, 0x44, 0xf1, 0x66, 0x45,
+  0x3d, 0x9e, 0x96, 0xe8, 0x1f, 0x14, 0x86, 0xc7, 0x5f, 0x76, 0x8f, 0x22, 0x89, 0xbb, 0x4b, 0xe7,
+  0x17, 0x67, 0xdf, 0x3e, 0x42, 0x95, 0x0b, 0x2c, 0x69, 0x7c, 0xdc, 0xb7, 0xd3, 0x11, 0xf2, 0x8b,
+  0xd3, 0x61, 0xb9, 0x34, 0xb8, 0x3e, 0x58, 0x6b, 0x2c, 0xfc, 0x0c, 0xf1, 0x33, 0xfa, 0xa0, 0x07,
+  0x47, 0x95, 0x68, 0x94, 0x00, 0x6d, 0x3c, 0x2c, 0x11, 0x36, 0x56, 0x7a, 0xc2, 0x08, 0x72, 0x2b,
+  0x48, 0xd9, 0x15, 0xec, 0xd0, 0x0f, 0x43, 0xbc, 0x76, 0xd7, 0x8a, 0x27, 0x86, 0x19, 0xc4, 0xf1,
+  0x25, 0x3f, 0x59, 0x40, 0x42, 0x37, 0x10, 0x7f, 0x84, 0x3c, 0xcf, 0x21, 0x3e, 0x14, 0x18, 0x45,
+  0x7c, 0x2d, 0x15, 0x61, 0xa1, 0x3a, 0x67, 0x0d, 0xf1, 0x7d, 0x77, 0xe6, 0x06, 0x1e, 0x9f, 0x80,
+  0x86, 0x91, 0x25, 0xb1, 0xd1, 0x7d, 0xf0, 0x81, 0xd8, 0xcb, 0x7a, 0x7e, 0x15, 0xa6, 0x2d, 0xc6,
+  0xa5, 0xed, 0xf5, 0x9f, 0x39, 0x4a, 0xa1, 0x30, 0x86, 0xf7, 0xef, 0x09, 0x9d, 0xd5, 0xff, 0x99,
+  0x66, 0xa7, 0x5d, 0x14, 0x90, 0x58, 0x64, 0x24, 0x85, 0x03, 0xd3, 0xc3, 0xcb, 0x07, 0x88, 0x07,
+  0x43, 0xa8, 0x15, 0xbd, 0x21, 0xf0, 0x0a, 0xf9, 0xcb, 0xbe, 0x85, 0x6b, 0x1a, 0x18, 0xd4, 0xbe,
+  0x22, 0x8d, 0xff, 0x6f, 0x3c, 0x6f, 0x33, 0xd3, 0x25, 0x24, 0x2d, 0x97, 0x36, 0x5a, 0xa2, 0x32,
+  0x3c, 0x8e, 0x8d, 0xd6, 0xc0, 0xa8, 0xce, 0xab, 0xda, 0x07, 0x13, 0x98, 0xe2, 0x7c, 0xd3, 0xed,
+  0xb9, 0x87, 0x6a, 0x5f, 0xd2, 0x70, 0xe8, 0x3f, 0xcb, 0x15, 0x9a, 0xc6, 0x27, 0xa1, 0x7f, 0x86,
+  0xf4, 0x77, 0x60, 0x32, 0xe9, 0x09, 0x96, 0xda, 0x81, 0xb3, 0xd0, 0x46, 0xc7, 0x7e, 0xb8, 0x96,
+  0xdc, 0x7f, 0x87, 0x74, 0x75, 0xc4, 0xef, 0x1b, 0x77, 0xde, 0x4d, 0xe8, 0x43, 0x7f, 0x67, 0xe3,
+  0x76, 0x36, 0xd3, 0x54, 0xdd, 0xff, 0xe7, 0xf1, 0x37, 0x91, 0xa1, 0xf6, 0xbb, 0x91, 0x08, 0x00,
+  0x00,
+};
+
+static const char PAGE_SUCCESS_ETAG[] = "\"db8be398a5524f7a\"";
+
+#endif  // WIFI_CONFIG_PAGES_H
@@ -0,0 +1,298 @@
+#include "WiFiConfigRecord.h"
+
+#include <string.h>
+
+// 按位计算的CRC32，不占用查表所需的1KB内存；配置只在启动和保存时校验一次
+uint32_t wifiConfigCrc32(const void* data, size_t length, uint32_t crc) {
+  const uint8_t* p = (const uint8_t*)data;
+  crc = ~crc;
+  while (length--) {
+    crc ^= *p++;
+    for (int k = 0; k < 8; k++) {
+      crc = (crc >> 1) ^ (0xEDB88320UL & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+void wifiConfigReset(WiFiConfigRecord& record) {
+  memset(&record, 0, sizeof(record));
+}
+
+void wifiConfigSeal(WiFiConfigRecord& record) {
+  record.magic = WIFI_CONFIG_MAGIC;
+  record.version = WIFI_CONFIG_VERSION;
+  record.length = WIFI_CONFIG_DATA_SIZE;
+  record.crc = wifiConfigCrc32((const uint8_t*)&record + WIFI_CONFIG_HEADER_SIZE, WIFI_CONFIG_DATA_SIZE);
+}
+
+// 字段表中各类字段的检查，按字段类型在编译时选择
+template <size_t N>
+static bool fieldValid(const WiFiConfigString<N>& field) {
+  return field.terminated();
+}
+
+static bool fieldValid(uint16_t) {
+  return true;
+}
+
+const char* wifiConfigValidate(const WiFiConfigRecord& record) {
+  if (record.magic != WIFI_CONFIG_MAGIC) {
+    return "no configuration stored";
+  }
+  if (record.version != WIFI_CONFIG_VERSION || record.length != WIFI_CONFIG_DATA_SIZE) {
+    return "unsupported version";
+  }
+  if (record.crc != wifiConfigCrc32((const uint8_t*)&record + WIFI_CONFIG_HEADER_SIZE, WIFI_CONFIG_DATA_SIZE)) {
+    return "CRC mismatch";
+  }
+
+  // 保存时所有字符串都以'\0'结尾，CRC正确时这里只是额外的防护
+  for (const WiFiConfigNetwork& network : record.networks) {
+    if (!network.ssid.terminated() || !network.password.terminated()) {
+      return "unterminated string";
+    }
+  }
+#define WIFI_CONFIG_CHECK_FIELD(type, member, formName, placeholder, inputType, group) \
+  if (!fieldValid(record.member)) { \
+    return "unterminated string"; \
+  }
+#define WIFI_CONFIG_SKIP_FLAGS(member)
+  WIFI_CONFIG_FIELD_TABLE(WIFI_CONFIG_CHECK_FIELD, WIFI_CONFIG_SKIP_FLAGS)
+#undef WIFI_CONFIG_CHECK_FIELD
+#undef WIFI_CONFIG_SKIP_FLAGS
+  return nullptr;
+}
+
+// 版本1的记录：只有一个网络，直接保存在记录开头
+struct WiFiConfigRecordV1 {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t length;
+  uint32_t crc;
+  WiFiConfigString<33> ssid;
+  WiFiConfigString<65> password;
+  uint8_t flags;
+  WiFiConfigString<101> mqttClientID;
+  WiFiConfigString<65> mqttServer;
+  uint16_t mqttPort;
+  WiFiConfigString<101> mqttUsername;
+  WiFiConfigString<257> mqttPassword;
+  WiFiConfigString<33> deviceName;
+  uint16_t udpPort;
+} __attribute__((packed));
+
+static_assert(sizeof(WiFiConfigRecordV1) == 672, "version 1 layout is fixed");
+
+static const char* upgradeFromV1(WiFiConfigRecord& record, const void* data, size_t length) {
+  if (length < sizeof(WiFiConfigRecordV1)) {
+    return "truncated record";
+  }
+
+  WiFiConfigRecordV1 old;
+  memcpy(&old, data, sizeof(old));
+  if (old.length != sizeof(old) - WIFI_CONFIG_HEADER_SIZE) {
+    return "unsupported version";
+  }
+  if (old.crc != wifiConfigCrc32((const uint8_t*)&old + WIFI_CONFIG_HEADER_SIZE, old.length)) {
+    return "CRC mismatch";
+  }
+  if (!old.ssid.terminated() || !old.password.terminated()) {
+    return "unterminated string";
+  }
+
+  // 其他字段按字段表逐个复制，版本1中都有同名同类型的字段
+  wifiConfigReset(record);
+  record.networks[0].ssid = old.ssid;
+  record.networks[0].password = old.password;
+#define WIFI_CONFIG_COPY_FIELD(type, member, formName, placeholder, inputType, group) record.member = old.member;
+#define WIFI_CONFIG_COPY_FLAGS(member) record.member = old.member;
+  WIFI_CONFIG_FIELD_TABLE(WIFI_CONFIG_COPY_FIELD, WIFI_CONFIG_COPY_FLAGS)
+#undef WIFI_CONFIG_COPY_FIELD
+#undef WIFI_CONFIG_COPY_FLAGS
+
+  // 版本1允许SSID为空；新版本中空SSID表示未使用的条目
+  wifiConfigSeal(record);
+  return wifiConfigValidate(record);
+}
+
+const char* wifiConfigLoad(WiFiConfigRecord& record, const void* data, size_t length) {
+  if (length < WIFI_CONFIG_HEADER_SIZE) {
+    return "no configuration stored";
+  }
+
+  WiFiConfigRecord header;
+  memcpy(&header, data, WIFI_CONFIG_HEADER_SIZE);
+  if (header.magic != WIFI_CONFIG_MAGIC) {
+    return "no configuration stored";
+  }
+
+  if (header.version == 1) {
+    return upgradeFromV1(record, data, length);
+  }
+  if (header.version > WIFI_CONFIG_VERSION || header.length > WIFI_CONFIG_DATA_SIZE) {
+    return "unsupported version";
+  }
+  if (length < WIFI_CONFIG_HEADER_SIZE + header.length) {
+    return "truncated record";
+  }
+
+  // 版本2以后的旧记录是当前记录的前缀：校验原有部分，新增字段保持为0
+  if (header.version < WIFI_CONFIG_VERSION) {
+    if (header.crc != wifiConfigCrc32((const uint8_t*)data + WIFI_CONFIG_HEADER_SIZE, header.length)) {
+      return "CRC mismatch";
+    }
+    wifiConfigReset(record);
+    memcpy(&record, data, WIFI_CONFIG_HEADER_SIZE + header.length);
+    wifiConfigSeal(record);
+  } else {
+    memcpy(&record, data, sizeof(record));
+  }
+  return wifiConfigValidate(record);
+}
+
+// 旧的固定地址布局：字符串最多maxLength字节，后面跟'\0'（占用下一个字段的第一个字节）
+// 开关为字符'1'或'0'，端口为十进制数字串
+struct WiFiConfigLegacyField {
+  uint16_t address;
+  uint16_t maxLength;
+};
+
+static const WiFiConfigLegacyField LEGACY_SSID = { 1, 32 };
+static const WiFiConfigLegacyField LEGACY_PASS = { 33, 32 };
+static const WiFiConfigLegacyField LEGACY_MQTT_ENABLE = { 65, 1 };
+static const WiFiConfigLegacyField LEGACY_MQTT_DEVICE_ID = { 66, 100 };
+static const WiFiConfigLegacyField LEGACY_MQTT_SERVER = { 167, 31 };
+static const WiFiConfigLegacyField LEGACY_MQTT_PORT = { 199, 5 };
+static const WiFiConfigLegacyField LEGACY_MQTT_USERNAME = { 205, 100 };
+static const WiFiConfigLegacyField LEGACY_MQTT_PASSWD = { 306, 256 };
+static const WiFiConfigLegacyField LEGACY_UDP_ENABLE = { 563, 1 };
+static const WiFiConfigLegacyField LEGACY_UDP_DEVICE_NAME = { 564, 31 };
+static const WiFiConfigLegacyField LEGACY_UDP_PORT = { 596, 5 };
+
+// 与旧固件的readFromEEPROM()相同：读到'\0'或maxLength字节为止
+// 旧固件只写入表单中的文本，出现控制字符或0xFF（擦除后未写入）说明不是旧布局的数据
+static bool legacyString(const uint8_t* eeprom, const WiFiConfigLegacyField& field, const char*& value,
+                         size_t& length) {
+  value = (const char*)eeprom + field.address;
+  for (length = 0; length < field.maxLength && value[length] != '\0'; length++) {
+    uint8_t c = (uint8_t)value[length];
+    if (c < 0x20 || c == 0xFF) {
+      return false;
+    }
+  }
+  return true;
+}
+
+template <size_t N>
+static bool legacyString(const uint8_t* eeprom, const WiFiConfigLegacyField& field, WiFiConfigString<N>& out) {
+  const char* value;
+  size_t length;
+  if (!legacyString(eeprom, field, value, length)) {
+    return false;
+  }
+  out.assign(value, length);
+  return true;
+}
+
+// 与旧固件的String::toInt()相同，只取开头的数字；超出范围时为0，不是旧布局的数据时返回-1
+static int32_t legacyPort(const uint8_t* eeprom, const WiFiConfigLegacyField& field) {
+  const char* value;
+  size_t length;
+  if (!legacyString(eeprom, field, value, length)) {
+    return -1;
+  }
+  uint32_t number = 0;
+  for (size_t i = 0; i < length && value[i] >= '0' && value[i] <= '9'; i++) {
+    number = number * 10 + (value[i] - '0');
+  }
+  return number <= 0xFFFF ? (int32_t)number : 0;
+}
+
+static bool legacyFlag(const uint8_t* eeprom, const WiFiConfigLegacyField& field, uint8_t bit, uint8_t& flags) {
+  char c = (char)eeprom[field.address];
+  if (c == '1') {
+    flags |= bit;
+  } else if (c != '0' && c != '\0') {
+    return false;
+  }
+  return true;
+}
+
+const char* wifiConfigImportLegacy(WiFiConfigRecord& record, const uint8_t* eeprom) {
+  const char* ssid;
+  const char* password;
+  size_t ssidLength;
+  size_t passwordLength;
+  if (!legacyString(eeprom, LEGACY_SSID, ssid, ssidLength)
+      || !legacyString(eeprom, LEGACY_PASS, password, passwordLength)) {
+    return "not a legacy layout";
+  }
+  if (ssidLength == 0) {
+    return "no configuration stored";
+  }
+
+  wifiConfigReset(record);
+  wifiConfigAddNetwork(record, ssid, ssidLength, password, passwordLength);
+  int32_t mqttPort = legacyPort(eeprom, LEGACY_MQTT_PORT);
+  int32_t udpPort = legacyPort(eeprom, LEGACY_UDP_PORT);
+  bool valid = mqttPort >= 0 && udpPort >= 0
+               && legacyFlag(eeprom, LEGACY_MQTT_ENABLE, WIFI_CONFIG_FLAG_MQTT, record.flags)
+               && legacyString(eeprom, LEGACY_MQTT_DEVICE_ID, record.mqttClientID)
+               && legacyString(eeprom, LEGACY_MQTT_SERVER, record.mqttServer)
+               && legacyString(eeprom, LEGACY_MQTT_USERNAME, record.mqttUsername)
+               && legacyString(eeprom, LEGACY_MQTT_PASSWD, record.mqttPassword)
+               && legacyFlag(eeprom, LEGACY_UDP_ENABLE, WIFI_CONFIG_FLAG_UDP, record.flags)
+               && legacyString(eeprom, LEGACY_UDP_DEVICE_NAME, record.deviceName);
+  if (!valid) {
+    wifiConfigReset(record);
+    return "not a legacy layout";
+  }
+  record.mqttPort = (uint16_t)mqttPort;
+  record.udpPort = (uint16_t)udpPort;
+
+  wifiConfigSeal(record);
+  return wifiConfigValidate(record);
+}
+
+uint8_t wifiConfigNetworkCount(const WiFiConfigRecord& record) {
+  uint8_t count = 0;
+  while (count < WIFI_CONFIG_MAX_NETWORKS && !record.networks[count].ssid.empty()) {
+    count++;
+  }
+  return count;
+}
+
+bool wifiConfigAddNetwork(WiFiConfigRecord& record, const char* ssid, size_t ssidLength,
+                          const char* password, size_t passwordLength) {
+  if (ssidLength == 0) {
+    return false;
+  }
+  if (ssidLength > record.networks[0].ssid.capacity()) {
+    ssidLength = record.networks[0].ssid.capacity();
+  }
+
+  // 已有同名网络时原地更新，否则占用最后一个位置（列表已满时覆盖最旧的网络）
+  uint8_t count = wifiConfigNetworkCount(record);
+  uint8_t index = 0;
+  while (index < count && !record.networks[index].ssid.equals(ssid, ssidLength)) {
+    index++;
+  }
+  if (index == WIFI_CONFIG_MAX_NETWORKS) {
+    index = WIFI_CONFIG_MAX_NETWORKS - 1;
+  }
+
+  WiFiConfigNetwork entry = record.networks[index];
+  bool changed = index != 0;
+  if (entry.ssid.assign(ssid, ssidLength)) {
+    entry.successes = 0;
+    entry.lastRssi = 0;
+    changed = true;
+  }
+  changed |= entry.password.assign(password, passwordLength);
+
+  // 移到最前面
+  memmove(&record.networks[1], &record.networks[0], index * sizeof(WiFiConfigNetwork));
+  record.networks[0] = entry;
+  return changed;
+}
@@ -0,0 +1,129 @@
+#ifndef WIFI_CONFIG_RECORD_H
+#define WIFI_CONFIG_RECORD_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "WiFiConfigString.h"
+
+// 配置记录的魔数和结构版本，结构变化时必须增加版本号
+// 从版本2开始新字段只追加在记录末尾，旧记录加载时缺少的部分为0
+#define WIFI_CONFIG_MAGIC 0x57434647UL  // "WCFG"
+#define WIFI_CONFIG_VERSION 3
+
+// 最多保存的WiFi网络数量
+#define WIFI_CONFIG_MAX_NETWORKS 4
+
+// flags字段的位定义
+#define WIFI_CONFIG_FLAG_MQTT 0x01
+#define WIFI_CONFIG_FLAG_UDP 0x02
+
+// 配置字段表：记录布局、校验、表单解析、变化检测和表单输入框都由这张表展开生成
+// FIELD(类型, 成员名, 表单参数名, 页面占位符, 输入框类型, 所属功能位)
+//   所属功能位为0的字段总是有效，否则只在flags中对应的位置位时才从表单读取
+// FLAGS(成员名)：功能开关字节，各个位由WIFI_CONFIG_FLAG_TABLE描述
+// 字段按存储顺序排列，增删字段或改变大小都会改变记录布局，必须同时增加WIFI_CONFIG_VERSION
+#define WIFI_CONFIG_FIELD_TABLE(FIELD, FLAGS) \
+  FLAGS(flags) \
+  FIELD(WiFiConfigString<101>, mqttClientID, "mqttClientID", "MQTT_CLIENT_ID", "text", WIFI_CONFIG_FLAG_MQTT) \
+  FIELD(WiFiConfigString<65>, mqttServer, "mqttServer", "MQTT_SERVER", "text", WIFI_CONFIG_FLAG_MQTT) \
+  FIELD(uint16_t, mqttPort, "mqttPort", "MQTT_PORT", "number", WIFI_CONFIG_FLAG_MQTT) \
+  FIELD(WiFiConfigString<101>, mqttUsername, "mqttUsername", "MQTT_USERNAME", "text", WIFI_CONFIG_FLAG_MQTT) \
+  FIELD(WiFiConfigString<257>, mqttPassword, "mqttPassword", "MQTT_PASSWORD", "password", WIFI_CONFIG_FLAG_MQTT) \
+  FIELD(WiFiConfigString<33>, deviceName, "deviceName", "DEVICE_NAME", "text", WIFI_CONFIG_FLAG_UDP) \
+  FIELD(uint16_t, udpPort, "udpPort", "UDP_PORT", "number", WIFI_CONFIG_FLAG_UDP)
+
+// 功能开关表：FLAG(位, 表单复选框名, 页面占位符)
+#define WIFI_CONFIG_FLAG_TABLE(FLAG) \
+  FLAG(WIFI_CONFIG_FLAG_MQTT, "enableMQTT", "ENABLE_MQTT") \
+  FLAG(WIFI_CONFIG_FLAG_UDP, "enableUDP", "ENABLE_UDP")
+
+// 一个已知的WiFi网络及其连接统计，用于开机时排序
+struct WiFiConfigNetwork {
+  WiFiConfigString<33> ssid;      // 为空表示未使用
+  WiFiConfigString<65> password;
+  uint8_t successes;              // 成功连接次数，到255后不再增加
+  int8_t lastRssi;                // 最近一次连接时的信号强度（dBm），0表示未知
+} __attribute__((packed));
+
+// 最近一次成功连接的接入点和DHCP租约，用于下次启动时跳过扫描（和DHCP）
+struct WiFiConfigLease {
+  uint32_t ssidCrc;  // 所属网络SSID的CRC32，0表示没有租约
+  uint8_t bssid[6];
+  uint8_t channel;
+  uint8_t reserved;
+  uint32_t ip;       // 以下均为lwIP的网络字节序
+  uint32_t gateway;
+  uint32_t subnet;
+  uint32_t dns;
+} __attribute__((packed));
+
+// 保存在配置日志（或EEPROM）中的配置记录，整体一次读取和写入
+// 头部之后的所有字节由CRC32保护，字符串字段均以'\0'结尾
+struct WiFiConfigRecord {
+  // 头部
+  uint32_t magic;    // 固定为WIFI_CONFIG_MAGIC
+  uint16_t version;  // 结构版本
+  uint16_t length;   // 数据部分长度
+  uint32_t crc;      // 数据部分的CRC32
+
+  // 已知网络，按最近配置的顺序排列，已使用的条目总是连续排在前面
+  WiFiConfigNetwork networks[WIFI_CONFIG_MAX_NETWORKS];
+
+  // 其他配置字段，见WIFI_CONFIG_FIELD_TABLE
+#define WIFI_CONFIG_DECLARE_FIELD(type, member, formName, placeholder, inputType, group) type member;
+#define WIFI_CONFIG_DECLARE_FLAGS(member) uint8_t member;
+  WIFI_CONFIG_FIELD_TABLE(WIFI_CONFIG_DECLARE_FIELD, WIFI_CONFIG_DECLARE_FLAGS)
+#undef WIFI_CONFIG_DECLARE_FIELD
+#undef WIFI_CONFIG_DECLARE_FLAGS
+
+  // 版本3
+  WiFiConfigLease lease;
+} __attribute__((packed));
+
+// 头部长度，CRC从这里开始计算
+static const size_t WIFI_CONFIG_HEADER_SIZE = offsetof(WiFiConfigRecord, crc) + sizeof(uint32_t);
+static const size_t WIFI_CONFIG_DATA_SIZE = sizeof(WiFiConfigRecord) - WIFI_CONFIG_HEADER_SIZE;
+
+// 编译时检查：数据部分正好由网络列表和字段表中的字段紧密排列而成，且当前版本的布局没有被改变
+#define WIFI_CONFIG_FIELD_SIZE(type, member, formName, placeholder, inputType, group) +sizeof(type)
+#define WIFI_CONFIG_FLAGS_SIZE(member) +sizeof(uint8_t)
+static_assert(WIFI_CONFIG_DATA_SIZE == sizeof(WiFiConfigNetwork) * WIFI_CONFIG_MAX_NETWORKS
+                WIFI_CONFIG_FIELD_TABLE(WIFI_CONFIG_FIELD_SIZE, WIFI_CONFIG_FLAGS_SIZE) + sizeof(WiFiConfigLease),
+              "record contains fields outside WIFI_CONFIG_FIELD_TABLE");
+#undef WIFI_CONFIG_FIELD_SIZE
+#undef WIFI_CONFIG_FLAGS_SIZE
+static_assert(WIFI_CONFIG_VERSION != 3 || sizeof(WiFiConfigRecord) == 1002,
+              "record layout changed, bump WIFI_CONFIG_VERSION");
+
+// 标准CRC32（多项式0xEDB88320），crc参数用于分段计算
+uint32_t wifiConfigCrc32(const void* data, size_t length, uint32_t crc = 0);
+
+// 清空记录，所有字段回到默认值（空字符串、0）
+void wifiConfigReset(WiFiConfigRecord& record);
+
+// 填写头部（魔数、版本、长度、CRC），保存前调用
+void wifiConfigSeal(WiFiConfigRecord& record);
+
+// 校验记录，有效时返回nullptr，否则返回原因
+const char* wifiConfigValidate(const WiFiConfigRecord& record);
+
+// 从存储中读出的原始数据加载记录，旧版本的记录会被转换为当前版本
+// 有效时返回nullptr，否则返回原因
+const char* wifiConfigLoad(WiFiConfigRecord& record, const void* data, size_t length);
+
+// 使用配置记录之前的固件把各字段以字符串形式保存在EEPROM的固定地址上（地址0到601）
+#define WIFI_CONFIG_LEGACY_SIZE 602
+
+// 从旧的固定地址布局导入配置，eeprom指向EEPROM地址0开始的WIFI_CONFIG_LEGACY_SIZE字节
+// 成功时得到当前版本的记录并返回nullptr，否则返回原因（没有保存网络或不是旧布局写入的数据）
+const char* wifiConfigImportLegacy(WiFiConfigRecord& record, const uint8_t* eeprom);
+
+// 已保存的网络数量
+uint8_t wifiConfigNetworkCount(const WiFiConfigRecord& record);
+
+// 添加网络或更新已有网络的密码，并将其移到列表最前面；列表已满时丢弃最后一个
+// 返回值表示记录是否发生变化
+bool wifiConfigAddNetwork(WiFiConfigRecord& record, const char* ssid, size_t ssidLength,
+                          const char* password, size_t passwordLength);
+
+#endif  // WIFI_CONFIG_RECORD_H
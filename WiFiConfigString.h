@@ -0,0 +1,61 @@
+#ifndef WIFI_CONFIG_STRING_H
+#define WIFI_CONFIG_STRING_H
+
+#include <stddef.h>
+#include <string.h>
+
+// 固定容量的字符串，内容直接存放在对象内部，不使用堆内存
+// 内存布局与char[N]完全相同，可以作为配置记录的字段整体读写
+// N包含结尾的'\0'，最多保存N-1个字符；未使用的部分始终为0，保证记录的CRC只取决于内容
+template <size_t N>
+struct WiFiConfigString {
+  char data[N];
+
+  const char* c_str() const {
+    return data;
+  }
+
+  size_t length() const {
+    return strnlen(data, N);
+  }
+
+  bool empty() const {
+    return data[0] == '\0';
+  }
+
+  static constexpr size_t capacity() {
+    return N - 1;
+  }
+
+  // 从存储中读出的内容必须以'\0'结尾
+  bool terminated() const {
+    return data[N - 1] == '\0';
+  }
+
+  bool equals(const char* value, size_t valueLength) const {
+    return valueLength <= capacity() && strncmp(data, value, valueLength) == 0 && data[valueLength] == '\0';
+  }
+
+  // 写入新内容，超出容量的部分被截断；返回值表示内容是否发生变化
+  bool assign(const char* value, size_t valueLength) {
+    if (valueLength > capacity()) {
+      valueLength = capacity();
+    }
+    if (equals(value, valueLength)) {
+      return false;
+    }
+    memcpy(data, value, valueLength);
+    memset(data + valueLength, 0, N - valueLength);
+    return true;
+  }
+
+  bool assign(const char* value) {
+    return assign(value, strlen(value));
+  }
+
+  void clear() {
+    memset(data, 0, N);
+  }
+};
+
+#endif  // WIFI_CONFIG_STRING_H
@@ -0,0 +1,128 @@
+#include "WiFiConfigTemplate.h"
+
+// 占位符名称的最大长度，超过时按普通文本处理
+static const size_t MAX_PLACEHOLDER = 32;
+
+WiFiConfigChunkWriter::WiFiConfigChunkWriter(WebServer* server)
+  : _server(server),
+    _length(0),
+    _sent(0) {}
+
+void WiFiConfigChunkWriter::begin(int code, const char* contentType) {
+  _server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+  _server->send(code, contentType, "");
+}
+
+void WiFiConfigChunkWriter::write(const char* data, size_t length) {
+  // 比缓冲区大的内容直接发送，不再复制
+  if (length >= sizeof(_buffer)) {
+    flush();
+    _server->sendContent(data, length);
+    _sent += length;
+    return;
+  }
+
+  if (_length + length > sizeof(_buffer)) {
+    flush();
+  }
+  memcpy(_buffer + _length, data, length);
+  _length += length;
+}
+
+void WiFiConfigChunkWriter::print(unsigned long value) {
+  char digits[12];
+  snprintf(digits, sizeof(digits), "%lu", value);
+  print(digits);
+}
+
+void WiFiConfigChunkWriter::printEscaped(const char* text) {
+  const char* start = text;
+  for (const char* p = text; *p; p++) {
+    const char* entity = nullptr;
+    switch (*p) {
+      case '&': entity = "&amp;"; break;
+      case '<': entity = "&lt;"; break;
+      case '>': entity = "&gt;"; break;
+      case '"': entity = "&quot;"; break;
+      case '\'': entity = "&#39;"; break;
+      default: continue;
+    }
+    write(start, p - start);
+    print(entity);
+    start = p + 1;
+  }
+  print(start);
+}
+
+void WiFiConfigChunkWriter::printJsonString(const char* text) {
+  print("\"");
+  const char* start = text;
+  for (const char* p = text; *p; p++) {
+    unsigned char c = (unsigned char)*p;
+    if (c != '"' && c != '\\' && c >= 0x20) {
+      continue;
+    }
+    write(start, p - start);
+    char escaped[8];
+    if (c == '"' || c == '\\') {
+      escaped[0] = '\\';
+      escaped[1] = (char)c;
+      escaped[2] = '\0';
+    } else {
+      snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+    }
+    print(escaped);
+    start = p + 1;
+  }
+  print(start);
+  print("\"");
+}
+
+void WiFiConfigChunkWriter::flush() {
+  if (_length > 0) {
+    _server->sendContent(_buffer, _length);
+    _sent += _length;
+    _length = 0;
+  }
+}
+
+void WiFiConfigChunkWriter::end() {
+  flush();
+  _server->sendContent("", 0);
+}
+
+void wifiConfigRenderTemplate(WiFiConfigChunkWriter& out, PGM_P tpl, size_t length,
+                              WiFiConfigTemplateResolver resolve, void* context) {
+  const char* end = tpl + length;
+  const char* literal = tpl;
+  const char* p = tpl;
+
+  while (p < end) {
+    if (*p != '%') {
+      p++;
+      continue;
+    }
+
+    // 查找占位符的结束'%'
+    const char* name = p + 1;
+    const char* q = name;
+    while (q < end && q - name < (ptrdiff_t)MAX_PLACEHOLDER
+           && ((*q >= 'A' && *q <= 'Z') || (*q >= '0' && *q <= '9') || *q == '_')) {
+      q++;
+    }
+
+    if (q < end && *q == '%' && q > name) {
+      out.write(literal, p - literal);
+      if (resolve(context, name, q - name, out)) {
+        literal = q + 1;
+      } else {
+        literal = p;  // 不认识的占位符原样输出
+      }
+      p = q + 1;
+    } else {
+      p++;
+    }
+  }
+
+  out.write(literal, end - literal);
+}
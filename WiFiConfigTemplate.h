@@ -0,0 +1,54 @@
+#ifndef WIFI_CONFIG_TEMPLATE_H
+#define WIFI_CONFIG_TEMPLATE_H
+
+#include <Arduino.h>
+#include <WebServer.h>
+
+// 分块传输的响应输出：内容先攒在固定大小的缓冲区里，满了再作为一个chunk发送
+// 整个响应不在内存中拼接，占用的内存与页面大小无关
+class WiFiConfigChunkWriter {
+public:
+  explicit WiFiConfigChunkWriter(WebServer* server);
+
+  // 发送状态码和响应头，开始分块传输
+  void begin(int code, const char* contentType);
+
+  void write(const char* data, size_t length);
+  void print(const char* text) {
+    write(text, strlen(text));
+  }
+  void print(unsigned long value);
+
+  // 按HTML属性值的规则转义后输出
+  void printEscaped(const char* text);
+
+  // 输出带引号的JSON字符串，转义引号、反斜杠和控制字符
+  void printJsonString(const char* text);
+
+  // 发送剩余内容和结束chunk
+  void end();
+
+  // 已发送的正文字节数
+  size_t bytesSent() const {
+    return _sent;
+  }
+
+private:
+  void flush();
+
+  WebServer* _server;
+  char _buffer[512];
+  size_t _length;
+  size_t _sent;
+};
+
+// 占位符解析函数：认识name时输出对应的值并返回true，否则返回false（占位符原样输出）
+typedef bool (*WiFiConfigTemplateResolver)(void* context, const char* name, size_t nameLength,
+                                           WiFiConfigChunkWriter& out);
+
+// 单遍扫描模板，字面内容直接写出，%NAME%形式的占位符（NAME由大写字母、数字和下划线组成）
+// 交给resolve填充
+void wifiConfigRenderTemplate(WiFiConfigChunkWriter& out, PGM_P tpl, size_t length,
+                              WiFiConfigTemplateResolver resolve, void* context);
+
+#endif  // WIFI_CONFIG_TEMPLATE_H
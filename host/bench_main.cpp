@@ -0,0 +1,318 @@
+// 主机端基准测试：配置加载和保存、HTTP处理函数、空闲loop()的开销
+// 结果以JSON输出到标准输出（以及命令行参数指定的文件），用于在版本之间比较性能
+#include "WiFiConfigManager.h"
+#include "HostHal.h"
+#include "esp_partition.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <new>
+#include <string>
+#include <vector>
+
+static const unsigned long TICK_MS = 10;
+static const uint32_t CONFIG_PARTITION_SIZE = 0x4000;  // 与partitions.csv一致
+
+// 统计堆分配：所有operator new都经过这里
+// 替换后的new/delete成对使用malloc/free，GCC在内联后仍会误报不匹配
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+static std::atomic<unsigned long> s_allocs{ 0 };
+static std::atomic<unsigned long> s_allocBytes{ 0 };
+
+void* operator new(size_t size) {
+  s_allocs.fetch_add(1, std::memory_order_relaxed);
+  s_allocBytes.fetch_add(size, std::memory_order_relaxed);
+  void* p = malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  return p;
+}
+void* operator new[](size_t size) {
+  return operator new(size);
+}
+void operator delete(void* p) noexcept {
+  free(p);
+}
+void operator delete[](void* p) noexcept {
+  free(p);
+}
+void operator delete(void* p, size_t) noexcept {
+  free(p);
+}
+void operator delete[](void* p, size_t) noexcept {
+  free(p);
+}
+
+static double nowNs() {
+  using namespace std::chrono;
+  return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// 一项测试的结果：每次操作的平均和最短耗时，以及附加的每次操作统计
+struct BenchResult {
+  std::string name;
+  unsigned long ops = 0;
+  double totalNs = 0;
+  double minNs = 0;
+  std::vector<std::pair<std::string, double>> extra;
+
+  void add(double ns) {
+    if (ops == 0 || ns < minNs) minNs = ns;
+    totalNs += ns;
+    ops++;
+  }
+  void set(const char* key, double value) {
+    extra.push_back({ key, value });
+  }
+};
+
+static std::vector<BenchResult> s_results;
+
+static HostRequest request(HTTPMethod method, const char* uri, HostArgs args = {}) {
+  HostRequest req;
+  req.method = method;
+  req.uri = uri;
+  req.args = args;
+  return req;
+}
+
+// 完整的配置表单；variant不同时每个字段都不同
+static HostRequest fullSave(int variant, const char* password = nullptr) {
+  char ssid[16], pass[16], server[16], port[8], user[16], mqttPass[16], client[16], device[16], udp[8];
+  snprintf(ssid, sizeof(ssid), "BenchNet%d", variant);
+  snprintf(pass, sizeof(pass), "secret%d", variant);
+  snprintf(server, sizeof(server), "192.0.2.%d", 10 + variant);
+  snprintf(port, sizeof(port), "%d", 1883 + variant);
+  snprintf(user, sizeof(user), "user%d", variant);
+  snprintf(mqttPass, sizeof(mqttPass), "mqttpass%d", variant);
+  snprintf(client, sizeof(client), "client%d", variant);
+  snprintf(device, sizeof(device), "sensor%d", variant);
+  snprintf(udp, sizeof(udp), "%d", 4210 + variant);
+  return request(HTTP_POST, "/save",
+                 { { "ssid", ssid },
+                   { "password", password ? password : pass },
+                   { "enableMQTT", "on" },
+                   { "mqttClientID", client },
+                   { "mqttServer", server },
+                   { "mqttPort", port },
+                   { "mqttUsername", user },
+                   { "mqttPassword", mqttPass },
+                   { "enableUDP", "on" },
+                   { "deviceName", device },
+                   { "udpPort", udp } });
+}
+
+// 选择存储后端：配置日志分区或EEPROM
+static void selectStorage(bool journal) {
+  hostReset();
+  EEPROM.hostErase();
+  EEPROM.hostResetCounters();
+  hostPartitionRemove("wcfg");
+  if (journal) hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  WiFi.hostFindNetwork("HomeNet")->reachable = true;
+}
+
+static unsigned long flashBytes(bool journal) {
+  return journal ? hostPartitionStats("wcfg").bytesProgrammed : EEPROM.hostFlashBytesWritten();
+}
+
+// 提交一次保存请求并走完回复、写入、连接三步；返回写入步骤的耗时
+static double submitSave(WiFiConfigManager& mgr, const HostRequest& req) {
+  WebServer::hostInstance()->hostRequest(req);
+  double t0 = nowNs();
+  mgr.loop();  // 写入存储
+  double ns = nowNs() - t0;
+  mgr.loop();  // 发起连接
+  hostAdvance(TICK_MS);
+  return ns;
+}
+
+// 从存储中加载整条配置记录（eepromBegin()：打开存储并校验、解析记录）
+static void benchLoad(bool journal) {
+  selectStorage(journal);
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    mgr.begin();
+    submitSave(mgr, fullSave(1));
+  }
+
+  BenchResult r;
+  r.name = journal ? "config_load_journal" : "config_load_eeprom";
+  WiFiConfigManager mgr;
+  const int iterations = 20000;
+  unsigned long allocs = s_allocs;
+  for (int i = 0; i < iterations; i++) {
+    double t0 = nowNs();
+    mgr.eepromBegin();
+    r.add(nowNs() - t0);
+  }
+  r.set("allocs_per_op", (double)(s_allocs - allocs) / iterations);
+  r.set("mb_per_s", sizeof(WiFiConfigRecord) / (r.totalNs / r.ops) * 1000.0);
+  r.set("loaded", mgr.getNetworkCount() == 1 && strcmp(mgr.getNetworkSSID(0), "BenchNet1") == 0);
+  s_results.push_back(r);
+}
+
+// 保存配置：未变化、少数字段变化、全部字段变化时写入存储的耗时和字节数
+static void benchSave(bool journal, const char* change) {
+  selectStorage(journal);
+  WiFi.hostFindNetwork("HomeNet")->reachable = false;  // 不连接成功，避免连接统计触发额外的保存
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  submitSave(mgr, fullSave(0));
+  submitSave(mgr, fullSave(1));
+
+  BenchResult r;
+  r.name = std::string("config_save_") + change + (journal ? "_journal" : "_eeprom");
+  const int iterations = 2000;
+  unsigned long bytes = flashBytes(journal);
+  unsigned long commits = EEPROM.hostCommits();
+  HostFlashStats before = hostPartitionStats("wcfg");
+  for (int i = 0; i < iterations; i++) {
+    HostRequest req;
+    if (strcmp(change, "none") == 0) {
+      req = fullSave(1);
+    } else if (strcmp(change, "few") == 0) {
+      req = fullSave(1, i % 2 ? "secretA" : "secretB");
+    } else {
+      req = fullSave(i % 2);
+    }
+    r.add(submitSave(mgr, req));
+  }
+  r.set("flash_bytes_per_op", (double)(flashBytes(journal) - bytes) / iterations);
+  if (journal) {
+    HostFlashStats after = hostPartitionStats("wcfg");
+    r.set("sector_erases_per_op", (double)(after.sectorErases - before.sectorErases) / iterations);
+  } else {
+    r.set("commits_per_op", (double)(EEPROM.hostCommits() - commits) / iterations);
+  }
+  s_results.push_back(r);
+}
+
+// HTTP处理函数：耗时和堆分配次数（减去替身分发一个空请求的分配）
+static void benchHandler(const char* name, const HostRequest& req, int iterations) {
+  selectStorage(true);
+  WiFi.hostFindNetwork("HomeNet")->reachable = false;
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  submitSave(mgr, fullSave(1));
+  WebServer* server = WebServer::hostInstance();
+  server->on("/bench-noop", HTTP_GET, [] {});
+
+  // 替身分发请求本身（复制请求参数、记录响应）的分配
+  HostRequest noop = request(HTTP_GET, "/bench-noop");
+  unsigned long allocs = s_allocs;
+  unsigned long allocBytes = s_allocBytes;
+  for (int i = 0; i < 100; i++) server->hostRequest(noop);
+  double baseAllocs = (double)(s_allocs - allocs) / 100;
+  double baseAllocBytes = (double)(s_allocBytes - allocBytes) / 100;
+
+  BenchResult r;
+  r.name = name;
+  unsigned long handlerAllocs = 0;
+  unsigned long handlerAllocBytes = 0;
+  size_t responseBytes = 0;
+  for (int i = 0; i < iterations; i++) {
+    allocs = s_allocs;
+    allocBytes = s_allocBytes;
+    double t0 = nowNs();
+    const HostResponse& res = server->hostRequest(req);
+    r.add(nowNs() - t0);
+    handlerAllocs += s_allocs - allocs;
+    handlerAllocBytes += s_allocBytes - allocBytes;
+    responseBytes = res.body.size();
+    // 保存请求之后完成写入和连接步骤，不计入处理函数
+    if (req.method == HTTP_POST || req.method == HTTP_PUT) {
+      mgr.loop();
+      mgr.loop();
+    }
+  }
+  r.set("allocs_per_op", (double)handlerAllocs / iterations - baseAllocs);
+  r.set("alloc_bytes_per_op", (double)handlerAllocBytes / iterations - baseAllocBytes);
+  r.set("response_bytes", (double)responseBytes);
+  s_results.push_back(r);
+}
+
+// 已连接设备上空闲loop()的每次开销
+static void benchIdleLoop() {
+  selectStorage(true);
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    mgr.begin();
+    submitSave(mgr, request(HTTP_POST, "/save", { { "ssid", "HomeNet" }, { "password", "secret123" } }));
+  }
+  hostReset();
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  for (int i = 0; i < 3000 && mgr.getConnectionState() != WiFiConfigManager::CONN_CONNECTED; i++) {
+    mgr.loop();
+    hostAdvance(TICK_MS);
+  }
+
+  BenchResult r;
+  r.name = "loop_idle_connected";
+  const int iterations = 200000;
+  unsigned long allocs = s_allocs;
+  for (int i = 0; i < iterations; i++) {
+    double t0 = nowNs();
+    mgr.loop();
+    r.add(nowNs() - t0);
+    hostAdvance(TICK_MS);
+  }
+  r.set("allocs_per_op", (double)(s_allocs - allocs) / iterations);
+  r.set("connected", mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED);
+  s_results.push_back(r);
+}
+
+static void writeJson(FILE* out) {
+  fprintf(out, "{\n  \"suite\": \"wificonfig-host\",\n  \"record_bytes\": %zu,\n  \"results\": [\n",
+          sizeof(WiFiConfigRecord));
+  for (size_t i = 0; i < s_results.size(); i++) {
+    const BenchResult& r = s_results[i];
+    fprintf(out, "    {\"name\": \"%s\", \"ops\": %lu, \"ns_per_op\": %.1f, \"ns_min\": %.1f", r.name.c_str(),
+            r.ops, r.ops ? r.totalNs / r.ops : 0.0, r.minNs);
+    for (const auto& kv : r.extra) {
+      fprintf(out, ", \"%s\": %.3f", kv.first.c_str(), kv.second);
+    }
+    fprintf(out, "}%s\n", i + 1 < s_results.size() ? "," : "");
+  }
+  fprintf(out, "  ]\n}\n");
+}
+
+int main(int argc, char** argv) {
+  Serial.setQuiet(true);
+  WiFi.hostAddNetwork("HomeNet", "secret123");
+
+  benchLoad(false);
+  benchLoad(true);
+  for (bool journal : { false, true }) {
+    benchSave(journal, "none");
+    benchSave(journal, "few");
+    benchSave(journal, "all");
+  }
+  benchHandler("http_root", request(HTTP_GET, "/"), 5000);
+  benchHandler("http_save", fullSave(1), 2000);
+  benchHandler("http_status", request(HTTP_GET, "/status"), 5000);
+  benchHandler("http_config_get", request(HTTP_GET, "/api/config"), 5000);
+  HostRequest put = request(HTTP_PUT, "/api/config");
+  put.body = "{\"ssid\":\"BenchNet1\",\"password\":\"secret1\",\"enableMQTT\":true,\"mqttServer\":\"192.0.2.11\","
+             "\"mqttPort\":1884,\"enableUDP\":true,\"deviceName\":\"sensor1\",\"udpPort\":4211}";
+  benchHandler("http_config_put", put, 5000);
+  benchIdleLoop();
+
+  writeJson(stdout);
+  if (argc > 1) {
+    FILE* f = fopen(argv[1], "w");
+    if (!f) {
+      perror(argv[1]);
+      return 1;
+    }
+    writeJson(f);
+    fclose(f);
+  }
+  return 0;
+}
@@ -0,0 +1,265 @@
+// 主机端Arduino核心API替身：String、IPAddress、Serial、虚拟时钟等
+// 仅实现WiFiConfigManager用到的接口，行为尽量贴近arduino-esp32
+#ifndef HOST_MOCK_ARDUINO_H
+#define HOST_MOCK_ARDUINO_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <algorithm>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define PROGMEM
+#define PGM_P const char*
+#define PSTR(s) (s)
+#define F(s) (s)
+#define pgm_read_byte(addr) (*(const uint8_t*)(addr))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+#define IRAM_ATTR
+#define RTC_DATA_ATTR
+#define RTC_NOINIT_ATTR
+
+#define LOW 0x0
+#define HIGH 0x1
+
+using std::min;
+using std::max;
+
+// 虚拟时钟：millis()/micros()返回虚拟时间，delay()推进虚拟时间
+unsigned long millis();
+unsigned long micros();
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+void yield();
+
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+class String {
+public:
+  String() {}
+  String(const char* s) : _s(s ? s : "") {}
+  String(const char* s, size_t len) : _s(s ? s : "", s ? len : 0) {}
+  String(const std::string& s) : _s(s) {}
+  explicit String(char c) : _s(1, c) {}
+  explicit String(int v, unsigned char base = 10);
+  explicit String(unsigned int v, unsigned char base = 10);
+  explicit String(long v, unsigned char base = 10);
+  explicit String(unsigned long v, unsigned char base = 10);
+
+  unsigned int length() const {
+    return (unsigned int)_s.size();
+  }
+  bool isEmpty() const {
+    return _s.empty();
+  }
+  const char* c_str() const {
+    return _s.c_str();
+  }
+  bool reserve(unsigned int size) {
+    _s.reserve(size);
+    return true;
+  }
+  char charAt(unsigned int i) const {
+    return i < _s.size() ? _s[i] : 0;
+  }
+  char operator[](unsigned int i) const {
+    return charAt(i);
+  }
+
+  String& operator=(const char* s) {
+    _s = s ? s : "";
+    return *this;
+  }
+  String& operator+=(const String& o) {
+    _s += o._s;
+    return *this;
+  }
+  String& operator+=(const char* s) {
+    _s += s ? s : "";
+    return *this;
+  }
+  String& operator+=(char c) {
+    _s += c;
+    return *this;
+  }
+  bool concat(const String& o) {
+    _s += o._s;
+    return true;
+  }
+  bool concat(const char* s, unsigned int len) {
+    _s.append(s, len);
+    return true;
+  }
+
+  bool operator==(const String& o) const {
+    return _s == o._s;
+  }
+  bool operator!=(const String& o) const {
+    return _s != o._s;
+  }
+  bool operator==(const char* s) const {
+    return _s == (s ? s : "");
+  }
+  bool operator!=(const char* s) const {
+    return !(*this == s);
+  }
+  bool equals(const String& o) const {
+    return _s == o._s;
+  }
+  bool startsWith(const String& p) const {
+    return _s.compare(0, p._s.size(), p._s) == 0;
+  }
+  bool endsWith(const String& p) const {
+    return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0;
+  }
+  int indexOf(char c, unsigned int from = 0) const {
+    size_t p = _s.find(c, from);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  int indexOf(const String& s, unsigned int from = 0) const {
+    size_t p = _s.find(s._s, from);
+    return p == std::string::npos ? -1 : (int)p;
+  }
+  String substring(unsigned int from) const {
+    return from < _s.size() ? String(_s.substr(from)) : String();
+  }
+  String substring(unsigned int from, unsigned int to) const {
+    if (from > to) std::swap(from, to);
+    if (from >= _s.size()) return String();
+    return String(_s.substr(from, to - from));
+  }
+  void replace(const String& find, const String& with);
+  void trim();
+  void toLowerCase();
+  long toInt() const {
+    return strtol(_s.c_str(), nullptr, 10);
+  }
+
+  friend String operator+(const String& a, const String& b) {
+    return String(a._s + b._s);
+  }
+  friend String operator+(const String& a, const char* b) {
+    return String(a._s + (b ? b : ""));
+  }
+  friend String operator+(const char* a, const String& b) {
+    return String((a ? a : "") + b._s);
+  }
+  friend String operator+(const String& a, char c) {
+    return String(a._s + c);
+  }
+
+private:
+  std::string _s;
+};
+
+class IPAddress {
+public:
+  IPAddress() : _addr(0) {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+    : _addr((uint32_t)a | ((uint32_t)b << 8) | ((uint32_t)c << 16) | ((uint32_t)d << 24)) {}
+  IPAddress(uint32_t addr) : _addr(addr) {}
+  operator uint32_t() const {
+    return _addr;
+  }
+  uint8_t operator[](int i) const {
+    return (uint8_t)(_addr >> (8 * i));
+  }
+  bool operator==(const IPAddress& o) const {
+    return _addr == o._addr;
+  }
+  bool operator!=(const IPAddress& o) const {
+    return _addr != o._addr;
+  }
+  bool fromString(const char* s);
+  String toString() const;
+
+private:
+  uint32_t _addr;  // 网络字节序，与lwIP一致
+};
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* buf, size_t len);
+  size_t write(const char* s) {
+    return write((const uint8_t*)s, strlen(s));
+  }
+
+  size_t print(const char* s) {
+    return write(s);
+  }
+  size_t print(const String& s) {
+    return write((const uint8_t*)s.c_str(), s.length());
+  }
+  size_t print(char c) {
+    return write((uint8_t)c);
+  }
+  size_t print(int v, int base = 10) {
+    return print(String((long)v, (unsigned char)base));
+  }
+  size_t print(unsigned int v, int base = 10) {
+    return print(String((unsigned long)v, (unsigned char)base));
+  }
+  size_t print(long v, int base = 10) {
+    return print(String(v, (unsigned char)base));
+  }
+  size_t print(unsigned long v, int base = 10) {
+    return print(String(v, (unsigned char)base));
+  }
+  size_t print(double v, int digits = 2);
+  size_t print(const IPAddress& ip) {
+    return print(ip.toString());
+  }
+
+  size_t println() {
+    return write("\r\n");
+  }
+  template<typename T>
+  size_t println(const T& v) {
+    size_t n = print(v);
+    return n + println();
+  }
+  size_t printf(const char* format, ...) __attribute__((format(printf, 2, 3)));
+};
+
+// 串口替身：默认输出到stdout，基准测试时可静音
+class HardwareSerial : public Print {
+public:
+  void begin(unsigned long) {}
+  void flush() {}
+  size_t write(uint8_t c) override;
+  size_t write(const uint8_t* buf, size_t len) override;
+  using Print::write;
+  void setQuiet(bool quiet) {
+    _quiet = quiet;
+  }
+
+private:
+  bool _quiet = false;
+};
+extern HardwareSerial Serial;
+
+// ESP.restart()在主机端抛出该异常，由模拟程序捕获后"重启"
+struct HostRestart {};
+
+class EspClass {
+public:
+  [[noreturn]] void restart();
+  uint32_t getFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getCycleCount();
+};
+extern EspClass ESP;
+
+#endif  // HOST_MOCK_ARDUINO_H
@@ -0,0 +1,89 @@
+// 主机端EEPROM替身：RAM缓冲 + 模拟Flash，统计提交次数和写入字节数
+#ifndef HOST_MOCK_EEPROM_H
+#define HOST_MOCK_EEPROM_H
+
+#include "Arduino.h"
+#include <vector>
+
+class EEPROMClass {
+public:
+  bool begin(size_t size);
+  void end();
+  uint8_t read(int address);
+  void write(int address, uint8_t val);
+  bool commit();
+  uint8_t* getDataPtr() {
+    _dirty = true;
+    return _data.data();
+  }
+  const uint8_t* getConstDataPtr() const {
+    return _data.data();
+  }
+  uint16_t length() const {
+    return (uint16_t)_data.size();
+  }
+
+  template<typename T>
+  T& get(int address, T& t) {
+    if (address >= 0 && address + sizeof(T) <= _data.size()) {
+      memcpy((uint8_t*)&t, _data.data() + address, sizeof(T));
+      _bytesRead += sizeof(T);
+    }
+    return t;
+  }
+
+  template<typename T>
+  const T& put(int address, const T& t) {
+    if (address >= 0 && address + sizeof(T) <= _data.size()) {
+      if (memcmp(_data.data() + address, (const uint8_t*)&t, sizeof(T)) != 0) {
+        memcpy(_data.data() + address, (const uint8_t*)&t, sizeof(T));
+        _dirty = true;
+      }
+    }
+    return t;
+  }
+
+  // ---- 主机端控制接口 ----
+  // 模拟掉电重启：丢弃未提交的RAM内容，保留Flash
+  void hostPowerCycle();
+  // 清空EEPROM区域（出厂状态，全部为0）
+  void hostErase();
+  // 直接修改Flash中的字节，用于模拟数据损坏
+  void hostCorrupt(int address, uint8_t val);
+  void hostResetCounters();
+
+  // begin()的调用次数（每次都从Flash读出整个区域）
+  unsigned long hostBegins() const {
+    return _begins;
+  }
+  unsigned long hostCommits() const {
+    return _commits;
+  }
+  unsigned long hostFlashBytesWritten() const {
+    return _flashBytesWritten;
+  }
+  unsigned long hostReadCalls() const {
+    return _readCalls;
+  }
+  unsigned long hostWriteCalls() const {
+    return _writeCalls;
+  }
+  unsigned long hostBytesRead() const {
+    return _bytesRead;
+  }
+
+private:
+  std::vector<uint8_t> _data;   // EEPROM.begin()加载到RAM中的副本
+  std::vector<uint8_t> _flash;  // 模拟的Flash存储
+  bool _dirty = false;
+
+  unsigned long _begins = 0;
+  unsigned long _commits = 0;
+  unsigned long _flashBytesWritten = 0;
+  unsigned long _readCalls = 0;
+  unsigned long _writeCalls = 0;
+  unsigned long _bytesRead = 0;
+};
+extern EEPROMClass EEPROM;
+
+#endif  // HOST_MOCK_EEPROM_H
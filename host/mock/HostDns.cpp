@@ -0,0 +1,123 @@
+// 主机端lwIP异步域名解析和TCP/IP任务替身的实现
+#include "lwip/dns.h"
+#include "lwip/tcpip.h"
+#include "Arduino.h"
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+struct HostDnsName {
+  uint32_t ip;
+  unsigned long delayMs;
+};
+
+struct HostDnsQuery {
+  std::string name;
+  unsigned long dueAt;
+  dns_found_callback found;
+  void* arg;
+};
+
+static std::mutex s_dnsLock;
+static std::map<std::string, HostDnsName> s_names;
+static std::map<std::string, uint32_t> s_cache;
+static std::vector<HostDnsQuery> s_pending;
+static unsigned long s_queries = 0;
+
+// 模拟TCP/IP核心：tcpip_callback()的回调和解析完成通知都在持有该锁时执行
+static std::recursive_mutex s_coreLock;
+static thread_local int s_inCore = 0;
+static std::atomic<unsigned long> s_unlockedCalls(0);
+
+err_t tcpip_callback(tcpip_callback_fn function, void* ctx) {
+  std::lock_guard<std::recursive_mutex> core(s_coreLock);
+  s_inCore++;
+  function(ctx);
+  s_inCore--;
+  return ERR_OK;
+}
+
+unsigned long hostLwipUnlockedCalls() {
+  return s_unlockedCalls.load();
+}
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg) {
+  if (!s_inCore) s_unlockedCalls++;
+  if (!hostname || !hostname[0]) return ERR_ARG;
+  struct in_addr numeric;
+  if (inet_pton(AF_INET, hostname, &numeric) == 1) {
+    addr->addr = numeric.s_addr;
+    return ERR_OK;
+  }
+
+  std::lock_guard<std::mutex> lock(s_dnsLock);
+  s_queries++;
+  auto cached = s_cache.find(hostname);
+  if (cached != s_cache.end()) {
+    addr->addr = cached->second;
+    return ERR_OK;
+  }
+  auto name = s_names.find(hostname);
+  unsigned long delayMs = name != s_names.end() ? name->second.delayMs : HOST_DNS_TIMEOUT_MS;
+  s_pending.push_back({ hostname, millis() + delayMs, found, callback_arg });
+  return ERR_INPROGRESS;
+}
+
+void hostDnsAdd(const char* name, uint32_t ip, unsigned long delayMs) {
+  std::lock_guard<std::mutex> lock(s_dnsLock);
+  s_names[name] = { ip, delayMs };
+}
+
+void hostDnsUpdate() {
+  std::vector<HostDnsQuery> due;
+  {
+    std::lock_guard<std::mutex> lock(s_dnsLock);
+    unsigned long now = millis();
+    for (size_t i = 0; i < s_pending.size();) {
+      if ((long)(now - s_pending[i].dueAt) >= 0) {
+        due.push_back(s_pending[i]);
+        s_pending.erase(s_pending.begin() + i);
+      } else {
+        i++;
+      }
+    }
+  }
+
+  // 回调在锁外调用，回调中可以再次查询
+  for (const HostDnsQuery& query : due) {
+    ip_addr_t addr;
+    bool known;
+    {
+      std::lock_guard<std::mutex> lock(s_dnsLock);
+      auto name = s_names.find(query.name);
+      known = name != s_names.end();
+      if (known) {
+        addr.addr = name->second.ip;
+        s_cache[query.name] = addr.addr;
+      }
+    }
+    if (query.found) {
+      std::lock_guard<std::recursive_mutex> core(s_coreLock);
+      s_inCore++;
+      query.found(query.name.c_str(), known ? &addr : nullptr, query.arg);
+      s_inCore--;
+    }
+  }
+}
+
+void hostDnsReset() {
+  std::lock_guard<std::mutex> lock(s_dnsLock);
+  s_cache.clear();
+  s_pending.clear();
+  s_queries = 0;
+  s_unlockedCalls = 0;
+}
+
+unsigned long hostDnsQueries() {
+  std::lock_guard<std::mutex> lock(s_dnsLock);
+  return s_queries;
+}
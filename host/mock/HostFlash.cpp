@@ -0,0 +1,124 @@
+// 主机端esp_partition替身的实现
+#include "esp_partition.h"
+
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+static const uint32_t SECTOR = 4096;
+
+struct HostPartition {
+  esp_partition_t info;
+  std::vector<uint8_t> data;
+  std::vector<unsigned long> erases;
+  HostFlashStats stats;
+  bool failWrites = false;
+};
+
+static std::vector<std::unique_ptr<HostPartition>> s_partitions;
+
+static HostPartition* findPartition(const char* label) {
+  for (auto& p : s_partitions) {
+    if (strcmp(p->info.label, label) == 0) return p.get();
+  }
+  return nullptr;
+}
+
+static HostPartition* fromInfo(const esp_partition_t* info) {
+  for (auto& p : s_partitions) {
+    if (&p->info == info) return p.get();
+  }
+  return nullptr;
+}
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label) {
+  for (auto& p : s_partitions) {
+    if (type != ESP_PARTITION_TYPE_ANY && p->info.type != type) continue;
+    if (subtype != ESP_PARTITION_SUBTYPE_ANY && p->info.subtype != subtype) continue;
+    if (label && strcmp(p->info.label, label) != 0) continue;
+    return &p->info;
+  }
+  return nullptr;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size) {
+  HostPartition* p = fromInfo(partition);
+  if (!p || src_offset + size > p->data.size()) return ESP_ERR_INVALID_SIZE;
+  memcpy(dst, p->data.data() + src_offset, size);
+  p->stats.bytesRead += size;
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size) {
+  HostPartition* p = fromInfo(partition);
+  if (!p || dst_offset + size > p->data.size()) return ESP_ERR_INVALID_SIZE;
+  if (p->failWrites) return ESP_FAIL;
+  // NOR Flash只能把1写成0
+  const uint8_t* in = (const uint8_t*)src;
+  for (size_t i = 0; i < size; i++) p->data[dst_offset + i] &= in[i];
+  p->stats.bytesProgrammed += size;
+  return ESP_OK;
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size) {
+  HostPartition* p = fromInfo(partition);
+  if (!p || offset % SECTOR || size % SECTOR || offset + size > p->data.size()) return ESP_ERR_INVALID_ARG;
+  if (p->failWrites) return ESP_FAIL;
+  std::fill(p->data.begin() + offset, p->data.begin() + offset + size, 0xFF);
+  for (size_t s = offset / SECTOR; s < (offset + size) / SECTOR; s++) {
+    p->erases[s]++;
+    p->stats.sectorErases++;
+    p->stats.maxSectorErases = std::max(p->stats.maxSectorErases, p->erases[s]);
+  }
+  return ESP_OK;
+}
+
+void hostPartitionCreate(const char* label, uint32_t size) {
+  HostPartition* p = findPartition(label);
+  if (!p) {
+    s_partitions.emplace_back(new HostPartition());
+    p = s_partitions.back().get();
+  }
+  memset(&p->info, 0, sizeof(p->info));
+  p->info.type = ESP_PARTITION_TYPE_DATA;
+  p->info.subtype = (esp_partition_subtype_t)0x40;
+  p->info.size = size;
+  strncpy(p->info.label, label, sizeof(p->info.label) - 1);
+  p->data.assign(size, 0xFF);
+  p->erases.assign(size / SECTOR, 0);
+  p->stats = HostFlashStats();
+  p->failWrites = false;
+}
+
+void hostPartitionRemove(const char* label) {
+  s_partitions.erase(std::remove_if(s_partitions.begin(), s_partitions.end(),
+                                    [&](const std::unique_ptr<HostPartition>& p) {
+                                      return strcmp(p->info.label, label) == 0;
+                                    }),
+                     s_partitions.end());
+}
+
+HostFlashStats hostPartitionStats(const char* label) {
+  HostPartition* p = findPartition(label);
+  return p ? p->stats : HostFlashStats();
+}
+
+void hostPartitionResetStats(const char* label) {
+  HostPartition* p = findPartition(label);
+  if (!p) return;
+  p->stats = HostFlashStats();
+  std::fill(p->erases.begin(), p->erases.end(), 0);
+}
+
+void hostPartitionCorrupt(const char* label, uint32_t offset, uint8_t val) {
+  HostPartition* p = findPartition(label);
+  if (p && offset < p->data.size()) p->data[offset] = val;
+}
+
+void hostPartitionFailWrites(const char* label, bool fail) {
+  HostPartition* p = findPartition(label);
+  if (p) p->failWrites = fail;
+}
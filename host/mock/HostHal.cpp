@@ -0,0 +1,852 @@
+// 主机端HAL替身的实现
+#include "HostHal.h"
+#include "WiFi.h"
+#include "EEPROM.h"
+#include "WebServer.h"
+#include "esp_system.h"
+#include "esp_sleep.h"
+#include "lwip/dns.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+EEPROMClass EEPROM;
+
+// ---------------- 虚拟时钟 ----------------
+
+// 门户任务（独立线程）也会读取虚拟时钟
+static std::atomic<unsigned long long> s_nowUs(0);
+
+unsigned long millis() {
+  return (unsigned long)(s_nowUs / 1000ULL);
+}
+
+unsigned long micros() {
+  return (unsigned long)s_nowUs;
+}
+
+void hostAdvanceMicros(unsigned long us) {
+  s_nowUs += us;
+  WiFi.hostUpdate();
+  hostDnsUpdate();
+}
+
+void hostAdvance(unsigned long ms) {
+  hostAdvanceMicros(ms * 1000UL);
+}
+
+unsigned long hostNowMs() {
+  return millis();
+}
+
+static esp_reset_reason_t s_resetReason = ESP_RST_POWERON;
+
+esp_reset_reason_t esp_reset_reason(void) {
+  return s_resetReason;
+}
+
+void hostReset() {
+  s_nowUs = 0;
+  s_resetReason = ESP_RST_POWERON;
+  WiFi.hostReset();
+  EEPROM.hostPowerCycle();
+  hostDnsReset();
+}
+
+void hostRestart() {
+  hostReset();
+  s_resetReason = ESP_RST_SW;
+}
+
+static uint64_t s_timerWakeupUs = 0;
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us) {
+  s_timerWakeupUs = time_in_us;
+  return ESP_OK;
+}
+
+void esp_deep_sleep_start(void) {
+  uint64_t wakeupUs = s_timerWakeupUs;
+  s_timerWakeupUs = 0;
+  throw HostDeepSleep{ wakeupUs };
+}
+
+void hostDeepSleepWake() {
+  hostReset();
+  s_resetReason = ESP_RST_DEEPSLEEP;
+}
+
+void delay(unsigned long ms) {
+  hostAdvance(ms);
+}
+
+void delayMicroseconds(unsigned int us) {
+  hostAdvanceMicros(us);
+}
+
+void yield() {}
+
+static unsigned long s_randState = 1;
+
+void randomSeed(unsigned long seed) {
+  s_randState = seed ? seed : 1;
+}
+
+long random(long howbig) {
+  if (howbig <= 0) return 0;
+  // xorshift，保证同一种子下结果可复现
+  s_randState ^= s_randState << 13;
+  s_randState ^= s_randState >> 7;
+  s_randState ^= s_randState << 17;
+  return (long)(s_randState % (unsigned long)howbig);
+}
+
+long random(long howsmall, long howbig) {
+  if (howsmall >= howbig) return howsmall;
+  return howsmall + random(howbig - howsmall);
+}
+
+// ---------------- String / IPAddress / Print ----------------
+
+static std::string toBase(unsigned long v, unsigned char base, bool negative) {
+  if (base < 2 || base > 36) base = 10;
+  char buf[72];
+  int i = sizeof(buf) - 1;
+  buf[i] = '\0';
+  do {
+    int d = (int)(v % base);
+    buf[--i] = (char)(d < 10 ? '0' + d : 'a' + d - 10);
+    v /= base;
+  } while (v && i > 1);
+  if (negative) buf[--i] = '-';
+  return std::string(&buf[i]);
+}
+
+String::String(int v, unsigned char base)
+  : String((long)v, base) {}
+
+String::String(unsigned int v, unsigned char base)
+  : String((unsigned long)v, base) {}
+
+String::String(long v, unsigned char base)
+  : _s(v < 0 && base == 10 ? toBase((unsigned long)(-(v + 1)) + 1, base, true)
+                           : toBase((unsigned long)v, base, false)) {}
+
+String::String(unsigned long v, unsigned char base)
+  : _s(toBase(v, base, false)) {}
+
+void String::replace(const String& find, const String& with) {
+  if (find._s.empty()) return;
+  size_t pos = 0;
+  while ((pos = _s.find(find._s, pos)) != std::string::npos) {
+    _s.replace(pos, find._s.size(), with._s);
+    pos += with._s.size();
+  }
+}
+
+void String::trim() {
+  size_t b = _s.find_first_not_of(" \t\r\n");
+  size_t e = _s.find_last_not_of(" \t\r\n");
+  _s = b == std::string::npos ? std::string() : _s.substr(b, e - b + 1);
+}
+
+void String::toLowerCase() {
+  for (auto& c : _s) c = (char)tolower((unsigned char)c);
+}
+
+bool IPAddress::fromString(const char* s) {
+  unsigned a, b, c, d;
+  char tail;
+  if (sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4) return false;
+  if (a > 255 || b > 255 || c > 255 || d > 255) return false;
+  *this = IPAddress((uint8_t)a, (uint8_t)b, (uint8_t)c, (uint8_t)d);
+  return true;
+}
+
+String IPAddress::toString() const {
+  char buf[16];
+  snprintf(buf, sizeof(buf), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+  return String(buf);
+}
+
+size_t Print::write(const uint8_t* buf, size_t len) {
+  size_t n = 0;
+  while (len--) n += write(*buf++);
+  return n;
+}
+
+size_t Print::print(double v, int digits) {
+  char buf[48];
+  snprintf(buf, sizeof(buf), "%.*f", digits, v);
+  return print(buf);
+}
+
+size_t Print::printf(const char* format, ...) {
+  char buf[512];
+  va_list ap;
+  va_start(ap, format);
+  int n = vsnprintf(buf, sizeof(buf), format, ap);
+  va_end(ap);
+  if (n < 0) return 0;
+  return write((const uint8_t*)buf, std::min((size_t)n, sizeof(buf) - 1));
+}
+
+size_t HardwareSerial::write(uint8_t c) {
+  if (!_quiet) fputc(c, stdout);
+  return 1;
+}
+
+size_t HardwareSerial::write(const uint8_t* buf, size_t len) {
+  if (!_quiet) fwrite(buf, 1, len, stdout);
+  return len;
+}
+
+// ---------------- ESP ----------------
+
+void EspClass::restart() {
+  throw HostRestart();
+}
+
+uint32_t EspClass::getFreeHeap() {
+  return 280000;
+}
+
+uint32_t EspClass::getMaxAllocHeap() {
+  return 110000;
+}
+
+uint32_t EspClass::getCycleCount() {
+  return (uint32_t)(s_nowUs.load() * 240ULL);
+}
+
+// ---------------- WiFi ----------------
+
+bool WiFiClass::mode(wifi_mode_t m) {
+  if (m == _mode) return true;
+  _modeSwitches++;
+  bool staBefore = _mode == WIFI_STA || _mode == WIFI_AP_STA;
+  bool staAfter = m == WIFI_STA || m == WIFI_AP_STA;
+  if (staBefore && !staAfter) {
+    _pending = false;
+    _dhcpPending = false;
+    if (_connected >= 0) {
+      _connected = -1;
+      raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+    }
+    setStatus(WL_DISCONNECTED);
+  }
+  if (_apUp && m != WIFI_AP && m != WIFI_AP_STA) {
+    _apUp = false;
+    _stations = 0;
+    raise(ARDUINO_EVENT_WIFI_AP_STOP);
+  }
+  _mode = m;
+  return true;
+}
+
+wifi_mode_t WiFiClass::getMode() {
+  return _mode;
+}
+
+wl_status_t WiFiClass::begin(const char* ssid, const char* passphrase, int32_t channel,
+                             const uint8_t* bssid, bool connect) {
+  _beginCalls++;
+  if (_mode == WIFI_MODE_NULL || _mode == WIFI_AP) mode(_mode == WIFI_AP ? WIFI_AP_STA : WIFI_STA);
+  _targetSSID = ssid ? ssid : "";
+  _targetPass = passphrase ? passphrase : "";
+  _dhcpPending = false;
+  if (_connected >= 0) {
+    _connected = -1;
+    raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+  }
+  setStatus(WL_DISCONNECTED);
+  if (!connect) {
+    _pending = false;
+    return _status;
+  }
+
+  // 有信道和BSSID提示时跳过全信道扫描；提示与实际不符时只探测该信道，很快失败
+  // 关联完成后再经过DHCP耗时才获得地址
+  unsigned long latency = 2000;
+  _dhcpMs = 0;
+  _hintMismatch = false;
+  HostNetwork* net = hostFindNetwork(_targetSSID.c_str());
+  if (net) {
+    bool hinted = channel == net->channel && bssid && memcmp(bssid, net->bssid, 6) == 0;
+    _hintMismatch = (channel || bssid) && !hinted;
+    if (_hintMismatch) {
+      latency = net->authMs;
+    } else {
+      latency = (hinted ? 0 : net->scanMs) + net->authMs;
+      _dhcpMs = _staticIP ? 0 : net->dhcpMs;
+    }
+  }
+  _pending = true;
+  _readyAt = millis() + latency;
+  return _status;
+}
+
+bool WiFiClass::disconnect(bool wifioff, bool eraseap) {
+  (void)eraseap;
+  _pending = false;
+  _dhcpPending = false;
+  if (_connected >= 0) {
+    _connected = -1;
+    raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_ASSOC_LEAVE);
+  }
+  setStatus(WL_DISCONNECTED);
+  if (wifioff) mode(WIFI_OFF);
+  return true;
+}
+
+wl_status_t WiFiClass::status() {
+  _statusCalls++;
+  return _status;
+}
+
+bool WiFiClass::softAP(const char* ssid, const char* passphrase, int channel, int ssid_hidden,
+                       int max_connection) {
+  (void)ssid;
+  (void)passphrase;
+  (void)channel;
+  (void)ssid_hidden;
+  (void)max_connection;
+  if (_mode != WIFI_AP && _mode != WIFI_AP_STA) mode(_mode == WIFI_STA ? WIFI_AP_STA : WIFI_AP);
+  if (!_apUp) {
+    _apUp = true;
+    raise(ARDUINO_EVENT_WIFI_AP_START);
+  }
+  return true;
+}
+
+bool WiFiClass::softAPdisconnect(bool wifioff) {
+  if (_apUp) {
+    _apUp = false;
+    _stations = 0;
+    raise(ARDUINO_EVENT_WIFI_AP_STOP);
+  }
+  if (_mode == WIFI_AP_STA) mode(WIFI_STA);
+  else if (_mode == WIFI_AP && wifioff) mode(WIFI_OFF);
+  return true;
+}
+
+IPAddress WiFiClass::softAPIP() {
+  return _apUp ? IPAddress(192, 168, 4, 1) : IPAddress();
+}
+
+bool WiFiClass::config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1,
+                       IPAddress dns2) {
+  (void)dns2;
+  _staticIP = local_ip;
+  _staticGateway = local_ip ? gateway : IPAddress();
+  _staticSubnet = local_ip ? subnet : IPAddress();
+  _staticDns = local_ip ? dns1 : IPAddress();
+  return true;
+}
+
+// DHCP服务器总是分配同一个地址
+uint8_t* WiFiClass::macAddress(uint8_t* mac) {
+  static const uint8_t staMac[6] = { 0x24, 0x6f, 0x28, 0x12, 0x34, 0x56 };
+  memcpy(mac, staMac, sizeof(staMac));
+  return mac;
+}
+
+IPAddress WiFiClass::localIP() {
+  if (_status != WL_CONNECTED) return IPAddress();
+  return _staticIP ? _staticIP : IPAddress(192, 168, 1, 100);
+}
+
+IPAddress WiFiClass::gatewayIP() {
+  if (_status != WL_CONNECTED) return IPAddress();
+  return _staticIP ? _staticGateway : IPAddress(192, 168, 1, 1);
+}
+
+IPAddress WiFiClass::subnetMask() {
+  if (_status != WL_CONNECTED) return IPAddress();
+  return _staticIP ? _staticSubnet : IPAddress(255, 255, 255, 0);
+}
+
+IPAddress WiFiClass::dnsIP(uint8_t dns_no) {
+  if (_status != WL_CONNECTED || dns_no > 0) return IPAddress();
+  return _staticIP ? _staticDns : IPAddress(192, 168, 1, 1);
+}
+
+uint8_t* WiFiClass::BSSID() {
+  return _connected >= 0 ? _networks[_connected].bssid : nullptr;
+}
+
+int32_t WiFiClass::channel() {
+  return _connected >= 0 ? _networks[_connected].channel : 0;
+}
+
+String WiFiClass::SSID() {
+  return _connected >= 0 ? _networks[_connected].ssid : String();
+}
+
+int8_t WiFiClass::RSSI() {
+  return _connected >= 0 ? (int8_t)_networks[_connected].rssi : 0;
+}
+
+int16_t WiFiClass::scanNetworks(bool async, bool show_hidden, bool passive, uint32_t max_ms_per_chan,
+                                uint8_t channel) {
+  (void)show_hidden;
+  (void)passive;
+  (void)max_ms_per_chan;
+  (void)channel;
+  if (_mode == WIFI_MODE_NULL || _mode == WIFI_AP) mode(_mode == WIFI_AP ? WIFI_AP_STA : WIFI_STA);
+  _scans++;
+  _scanResults.clear();
+  _scanning = true;
+  _scanDone = false;
+  _scanDoneAt = millis() + hostScanMs;
+  if (async) return WIFI_SCAN_RUNNING;
+  delay(hostScanMs);
+  return scanComplete();
+}
+
+int16_t WiFiClass::scanComplete() {
+  if (_scanning) return WIFI_SCAN_RUNNING;
+  return _scanDone ? (int16_t)_scanResults.size() : WIFI_SCAN_FAILED;
+}
+
+void WiFiClass::scanDelete() {
+  _scanning = false;
+  _scanDone = false;
+  _scanResults.clear();
+}
+
+String WiFiClass::SSID(uint8_t i) {
+  return i < _scanResults.size() ? _networks[_scanResults[i]].ssid : String();
+}
+
+int32_t WiFiClass::RSSI(uint8_t i) {
+  return i < _scanResults.size() ? _networks[_scanResults[i]].rssi : 0;
+}
+
+// 没有密码的网络为开放网络，其余按WPA2处理
+wifi_auth_mode_t WiFiClass::encryptionType(uint8_t i) {
+  if (i >= _scanResults.size()) return WIFI_AUTH_OPEN;
+  return _networks[_scanResults[i]].password.length() ? WIFI_AUTH_WPA2_PSK : WIFI_AUTH_OPEN;
+}
+
+int32_t WiFiClass::channel(uint8_t i) {
+  return i < _scanResults.size() ? _networks[_scanResults[i]].channel : 0;
+}
+
+uint8_t* WiFiClass::BSSID(uint8_t i) {
+  static uint8_t none[6];
+  return i < _scanResults.size() ? _networks[_scanResults[i]].bssid : none;
+}
+
+void WiFiClass::hostReset() {
+  _mode = WIFI_MODE_NULL;
+  _status = WL_IDLE_STATUS;
+  _apUp = false;
+  _pending = false;
+  _dhcpPending = false;
+  _connected = -1;
+  _scanning = false;
+  _scanDone = false;
+  _scanResults.clear();
+  _handlers.clear();
+  _stations = 0;
+  _autoReconnect = true;
+  _staticIP = IPAddress();
+  _staticGateway = IPAddress();
+  _staticSubnet = IPAddress();
+  _staticDns = IPAddress();
+  _dhcpLeases = 0;
+  _beginCalls = 0;
+  _statusCalls = 0;
+  _modeSwitches = 0;
+  _scans = 0;
+}
+
+HostNetwork& WiFiClass::hostAddNetwork(const char* ssid, const char* password) {
+  HostNetwork net;
+  net.ssid = ssid;
+  net.password = password;
+  net.bssid[5] = (uint8_t)(_networks.size() + 1);
+  _networks.push_back(net);
+  return _networks.back();
+}
+
+HostNetwork* WiFiClass::hostFindNetwork(const char* ssid) {
+  for (auto& n : _networks) {
+    if (n.ssid == ssid) return &n;
+  }
+  return nullptr;
+}
+
+void WiFiClass::hostDropLink() {
+  if (_status == WL_CONNECTED) {
+    _connected = -1;
+    setStatus(WL_CONNECTION_LOST);
+    raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_BEACON_TIMEOUT);
+  }
+}
+
+void WiFiClass::hostUpdate() {
+  if (_scanning && (long)(millis() - _scanDoneAt) >= 0) {
+    _scanning = false;
+    _scanDone = true;
+    for (size_t i = 0; i < _networks.size(); i++) {
+      if (_networks[i].reachable) _scanResults.push_back((int)i);
+    }
+    raise(ARDUINO_EVENT_WIFI_SCAN_DONE);
+  }
+
+  if (_pending && (long)(millis() - _readyAt) >= 0) {
+    _pending = false;
+    HostNetwork* net = hostFindNetwork(_targetSSID.c_str());
+    if (!net || !net->reachable || _hintMismatch) {
+      setStatus(WL_NO_SSID_AVAIL);
+      raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_NO_AP_FOUND);
+    } else if (net->password != _targetPass) {
+      setStatus(WL_CONNECT_FAILED);
+      raise(ARDUINO_EVENT_WIFI_STA_DISCONNECTED, WIFI_REASON_AUTH_FAIL);
+    } else {
+      _connected = (int)(net - _networks.data());
+      if (!_staticIP) _dhcpLeases++;
+      raise(ARDUINO_EVENT_WIFI_STA_CONNECTED);
+      _dhcpPending = true;
+      _gotIPAt = millis() + _dhcpMs;
+    }
+  }
+
+  if (_dhcpPending && (long)(millis() - _gotIPAt) >= 0) {
+    _dhcpPending = false;
+    setStatus(WL_CONNECTED);
+    raise(ARDUINO_EVENT_WIFI_STA_GOT_IP);
+  }
+}
+
+void WiFiClass::hostStationJoin() {
+  if (!_apUp) return;
+  _stations++;
+  raise(ARDUINO_EVENT_WIFI_AP_STACONNECTED);
+}
+
+void WiFiClass::hostStationLeave() {
+  if (!_apUp || _stations == 0) return;
+  _stations--;
+  raise(ARDUINO_EVENT_WIFI_AP_STADISCONNECTED);
+}
+
+wifi_event_id_t WiFiClass::onEvent(WiFiEventFuncCb cbEvent, arduino_event_id_t event) {
+  _handlers.push_back({ _nextHandlerId, event, cbEvent });
+  return _nextHandlerId++;
+}
+
+void WiFiClass::removeEvent(wifi_event_id_t id) {
+  for (size_t i = 0; i < _handlers.size(); i++) {
+    if (_handlers[i].id == id) {
+      _handlers.erase(_handlers.begin() + i);
+      return;
+    }
+  }
+}
+
+void WiFiClass::raise(arduino_event_id_t event, uint8_t reason) {
+  arduino_event_info_t info;
+  memset(&info, 0, sizeof(info));
+  if (event == ARDUINO_EVENT_WIFI_STA_DISCONNECTED) {
+    info.wifi_sta_disconnected.reason = reason;
+  }
+  std::vector<Handler> handlers = _handlers;  // 回调中可能注销自己
+  for (auto& h : handlers) {
+    if (h.event == ARDUINO_EVENT_MAX || h.event == event) h.fn(event, info);
+  }
+}
+
+void WiFiClass::setStatus(wl_status_t s) {
+  _status = s;
+}
+
+// ---------------- EEPROM ----------------
+
+bool EEPROMClass::begin(size_t size) {
+  _begins++;
+  // 与arduino-esp32一致：新建的EEPROM区域全部为0
+  if (_flash.size() < size) _flash.resize(size, 0);
+  _data.assign(_flash.begin(), _flash.begin() + size);
+  _dirty = false;
+  return true;
+}
+
+void EEPROMClass::end() {
+  commit();
+  _data.clear();
+}
+
+uint8_t EEPROMClass::read(int address) {
+  _readCalls++;
+  if (address < 0 || (size_t)address >= _data.size()) return 0;
+  _bytesRead++;
+  return _data[address];
+}
+
+void EEPROMClass::write(int address, uint8_t val) {
+  _writeCalls++;
+  if (address < 0 || (size_t)address >= _data.size()) return;
+  if (_data[address] != val) {
+    _data[address] = val;
+    _dirty = true;
+  }
+}
+
+bool EEPROMClass::commit() {
+  if (!_dirty) return true;
+  // arduino-esp32把整个EEPROM缓冲作为一个NVS blob重新写入
+  std::copy(_data.begin(), _data.end(), _flash.begin());
+  _commits++;
+  _flashBytesWritten += _data.size();
+  _dirty = false;
+  return true;
+}
+
+void EEPROMClass::hostPowerCycle() {
+  _data.clear();
+  _dirty = false;
+}
+
+void EEPROMClass::hostErase() {
+  std::fill(_flash.begin(), _flash.end(), 0);
+  _data.clear();
+}
+
+void EEPROMClass::hostCorrupt(int address, uint8_t val) {
+  if (address >= 0 && (size_t)address < _flash.size()) _flash[address] = val;
+}
+
+void EEPROMClass::hostResetCounters() {
+  _begins = 0;
+  _commits = 0;
+  _flashBytesWritten = 0;
+  _readCalls = 0;
+  _writeCalls = 0;
+  _bytesRead = 0;
+}
+
+// ---------------- WebServer ----------------
+
+static bool argNameEquals(const String& a, const String& b) {
+  return strcasecmp(a.c_str(), b.c_str()) == 0;
+}
+
+String HostResponse::header(const char* name) const {
+  for (auto& h : headers) {
+    if (argNameEquals(h.first, name)) return h.second;
+  }
+  return String();
+}
+
+WebServer* WebServer::_last = nullptr;
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction fn) {
+  _routes.push_back({ uri, method, fn, nullptr });
+}
+
+void WebServer::on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn) {
+  _routes.push_back({ uri, method, fn, ufn });
+}
+
+void WebServer::handleClient() {
+  {
+    std::lock_guard<std::mutex> lock(_queueLock);
+    if (!_begun || _queue.empty()) return;
+    _current = _queue.front();
+    _queue.pop_front();
+  }
+  if (_current.readDelayMs) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(_current.readDelayMs));
+  }
+  _response = HostResponse();
+  _pendingHeaders.clear();
+  _contentLength = CONTENT_LENGTH_NOT_SET;
+
+  THandlerFunction handler = _notFound;
+  THandlerFunction uploadHandler;
+  for (auto& r : _routes) {
+    if (r.uri == _current.uri && (r.method == HTTP_ANY || r.method == _current.method)) {
+      handler = r.fn;
+      uploadHandler = r.ufn;
+      break;
+    }
+  }
+  if (uploadHandler && _current.uploadName.length() > 0 && !dispatchUpload(uploadHandler)) {
+    // 连接中断：不调用请求处理函数，也没有响应
+    _handled++;
+    return;
+  }
+  _rawBody = uploadHandler && _current.uploadName.length() == 0 && _current.method != HTTP_GET;
+  if (_rawBody && !dispatchRaw(uploadHandler)) {
+    _handled++;
+    return;
+  }
+  if (handler) handler();
+  else send(404, "text/plain", "Not found");
+  _handled++;
+}
+
+// 与Arduino WebServer解析multipart请求时的顺序相同：START、若干WRITE、END
+bool WebServer::dispatchUpload(THandlerFunction& uploadHandler) {
+  const std::string& data = _current.upload;
+  _upload.status = UPLOAD_FILE_START;
+  _upload.filename = _current.uploadName;
+  _upload.name = "update";
+  _upload.type = "application/octet-stream";
+  _upload.totalSize = 0;
+  _upload.currentSize = 0;
+  uploadHandler();
+  for (size_t offset = 0; offset < data.size(); offset += HTTP_UPLOAD_BUFLEN) {
+    if (_current.uploadAbortAt && offset >= _current.uploadAbortAt) {
+      _upload.status = UPLOAD_FILE_ABORTED;
+      _upload.currentSize = 0;
+      uploadHandler();
+      return false;
+    }
+    size_t chunk = std::min((size_t)HTTP_UPLOAD_BUFLEN, data.size() - offset);
+    memcpy(_upload.buf, data.data() + offset, chunk);
+    _upload.status = UPLOAD_FILE_WRITE;
+    _upload.currentSize = chunk;
+    _upload.totalSize += chunk;
+    uploadHandler();
+  }
+  _upload.status = UPLOAD_FILE_END;
+  _upload.currentSize = 0;
+  uploadHandler();
+  return true;
+}
+
+// 与Arduino WebServer解析非表单请求体时的顺序相同：START、若干WRITE、END
+bool WebServer::dispatchRaw(THandlerFunction& rawHandler) {
+  const String& data = _current.body;
+  _raw.status = RAW_START;
+  _raw.totalSize = 0;
+  _raw.currentSize = 0;
+  rawHandler();
+  for (size_t offset = 0; offset < data.length(); offset += HTTP_RAW_BUFLEN) {
+    if (_current.uploadAbortAt && offset >= _current.uploadAbortAt) {
+      _raw.status = RAW_ABORTED;
+      _raw.currentSize = 0;
+      rawHandler();
+      return false;
+    }
+    size_t chunk = std::min((size_t)HTTP_RAW_BUFLEN, data.length() - offset);
+    memcpy(_raw.buf, data.c_str() + offset, chunk);
+    _raw.status = RAW_WRITE;
+    _raw.currentSize = chunk;
+    _raw.totalSize += chunk;
+    rawHandler();
+  }
+  _raw.status = RAW_END;
+  _raw.currentSize = 0;
+  rawHandler();
+  return true;
+}
+
+const HostResponse& WebServer::hostRequest(const HostRequest& req) {
+  {
+    std::lock_guard<std::mutex> lock(_queueLock);
+    // 服务器没有监听时连接被拒绝：不排队，返回空响应
+    if (!_begun) {
+      _response = HostResponse();
+      return _response;
+    }
+    _queue.push_front(req);
+  }
+  handleClient();
+  return _response;
+}
+
+String WebServer::arg(const String& name) const {
+  if (name == "plain") return _rawBody ? String() : _current.body;
+  for (auto& a : _current.args) {
+    if (a.first == name) return a.second;
+  }
+  return String();
+}
+
+String WebServer::arg(int i) const {
+  return i >= 0 && (size_t)i < _current.args.size() ? _current.args[i].second : String();
+}
+
+String WebServer::argName(int i) const {
+  return i >= 0 && (size_t)i < _current.args.size() ? _current.args[i].first : String();
+}
+
+int WebServer::args() const {
+  return (int)_current.args.size();
+}
+
+bool WebServer::hasArg(const String& name) const {
+  if (name == "plain") return !_rawBody && _current.body.length() > 0;
+  for (auto& a : _current.args) {
+    if (a.first == name) return true;
+  }
+  return false;
+}
+
+String WebServer::header(const String& name) const {
+  for (auto& h : _current.headers) {
+    if (argNameEquals(h.first, name)) return h.second;
+  }
+  return String();
+}
+
+bool WebServer::hasHeader(const String& name) const {
+  for (auto& h : _current.headers) {
+    if (argNameEquals(h.first, name)) return true;
+  }
+  return false;
+}
+
+void WebServer::collectHeaders(const char* headerKeys[], const size_t headerKeysCount) {
+  _collected.clear();
+  for (size_t i = 0; i < headerKeysCount; i++) _collected.push_back(headerKeys[i]);
+}
+
+void WebServer::startResponse(int code, const char* contentType, size_t length) {
+  _response.code = code;
+  _response.contentType = contentType ? contentType : "";
+  _response.headers = _pendingHeaders;
+  _response.handled = true;
+  _response.chunked = length == CONTENT_LENGTH_UNKNOWN;
+  _pendingHeaders.clear();
+}
+
+void WebServer::send(int code, const char* contentType, const String& content) {
+  size_t len = _contentLength == CONTENT_LENGTH_NOT_SET ? content.length() : _contentLength;
+  startResponse(code, contentType, len);
+  if (content.length()) sendContent(content);
+}
+
+void WebServer::send_P(int code, PGM_P contentType, PGM_P content) {
+  send_P(code, contentType, content, strlen(content));
+}
+
+void WebServer::send_P(int code, PGM_P contentType, PGM_P content, size_t contentLength) {
+  startResponse(code, contentType, contentLength);
+  _response.body.append(content, contentLength);
+  _response.chunks++;
+}
+
+void WebServer::sendHeader(const String& name, const String& value, bool first) {
+  if (first) _pendingHeaders.insert(_pendingHeaders.begin(), { name, value });
+  else _pendingHeaders.push_back({ name, value });
+}
+
+void WebServer::sendContent(const String& content) {
+  sendContent(content.c_str(), content.length());
+}
+
+void WebServer::sendContent(const char* content, size_t size) {
+  _response.body.append(content, size);
+  _response.chunks++;
+}
@@ -0,0 +1,21 @@
+// 主机端模拟环境的控制接口：虚拟时钟和全局复位
+#ifndef HOST_MOCK_HOSTHAL_H
+#define HOST_MOCK_HOSTHAL_H
+
+#include "Arduino.h"
+
+// 推进虚拟时钟，同时推进WiFi模型
+void hostAdvance(unsigned long ms);
+void hostAdvanceMicros(unsigned long us);
+// 当前虚拟时间
+unsigned long hostNowMs();
+// 上电复位：复位虚拟时钟和所有外设替身（EEPROM和分区的Flash内容保留）
+void hostReset();
+// 软件重启（ESP.restart()之后）：与hostReset()相同，但复位原因为ESP_RST_SW，
+// RTC内存中的内容保留
+void hostRestart();
+// 深度睡眠唤醒（esp_deep_sleep_start()之后）：与hostReset()相同，但复位原因为ESP_RST_DEEPSLEEP，
+// RTC内存中的内容保留
+void hostDeepSleepWake();
+
+#endif  // HOST_MOCK_HOSTHAL_H
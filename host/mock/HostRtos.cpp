@@ -0,0 +1,79 @@
+// 主机端FreeRTOS替身的实现
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+struct HostTask {
+  std::thread thread;
+};
+
+struct HostSemaphore {
+  std::recursive_timed_mutex mutex;
+};
+
+static std::atomic<int> s_tasks(0);
+static HostTaskInfo s_lastTask = { nullptr, 0, 0, 0 };
+static thread_local BaseType_t s_core = 1;  // Arduino的loop()运行在核心1
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+                                   void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask,
+                                   BaseType_t xCoreID) {
+  s_lastTask = { pcName, usStackDepth, uxPriority, xCoreID };
+  HostTask* task = new HostTask;
+  s_tasks++;
+  task->thread = std::thread([=] {
+    s_core = xCoreID == tskNO_AFFINITY ? 0 : xCoreID;
+    pvTaskCode(pvParameters);
+    s_tasks--;
+    delete task;
+  });
+  if (pvCreatedTask) *pvCreatedTask = task;
+  task->thread.detach();
+  return pdPASS;
+}
+
+void vTaskDelete(TaskHandle_t xTaskToDelete) {
+  (void)xTaskToDelete;
+}
+
+void vTaskDelay(TickType_t xTicksToDelay) {
+  std::this_thread::sleep_for(std::chrono::milliseconds(xTicksToDelay * portTICK_PERIOD_MS));
+}
+
+BaseType_t xPortGetCoreID(void) {
+  return s_core;
+}
+
+int hostTaskCount() {
+  return s_tasks.load();
+}
+
+HostTaskInfo hostLastTask() {
+  return s_lastTask;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+  return new HostSemaphore;
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t xMutex, TickType_t xTicksToWait) {
+  if (xTicksToWait == portMAX_DELAY) {
+    xMutex->mutex.lock();
+    return pdTRUE;
+  }
+  return xMutex->mutex.try_lock_for(std::chrono::milliseconds(xTicksToWait)) ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t xMutex) {
+  xMutex->mutex.unlock();
+  return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore) {
+  delete xSemaphore;
+}
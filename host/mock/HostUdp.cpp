@@ -0,0 +1,100 @@
+// 主机端WiFiUDP替身的实现
+#include "WiFiUdp.h"
+
+#include <map>
+
+static std::map<uint16_t, WiFiUDP*> s_bound;
+static std::mutex s_boundLock;
+
+WiFiUDP::~WiFiUDP() {
+  stop();
+}
+
+uint8_t WiFiUDP::begin(uint16_t port) {
+  stop();
+  std::lock_guard<std::mutex> lock(s_boundLock);
+  if (s_bound.count(port)) return 0;
+  s_bound[port] = this;
+  _port = port;
+  return 1;
+}
+
+void WiFiUDP::stop() {
+  {
+    std::lock_guard<std::mutex> lock(s_boundLock);
+    if (_port && s_bound[_port] == this) s_bound.erase(_port);
+  }
+  _port = 0;
+  std::lock_guard<std::mutex> lock(_lock);
+  _incoming.clear();
+}
+
+int WiFiUDP::parsePacket() {
+  std::lock_guard<std::mutex> lock(_lock);
+  if (_incoming.empty()) return 0;
+  _current = std::move(_incoming.front());
+  _incoming.pop_front();
+  _readPos = 0;
+  return (int)_current.data.size();
+}
+
+int WiFiUDP::read(uint8_t* buffer, size_t len) {
+  size_t n = std::min(len, _current.data.size() - _readPos);
+  memcpy(buffer, _current.data.data() + _readPos, n);
+  _readPos += n;
+  return (int)n;
+}
+
+int WiFiUDP::beginPacket(IPAddress ip, uint16_t port) {
+  _outgoing = HostPacket();
+  _outgoing.ip = ip;
+  _outgoing.port = port;
+  _building = true;
+  return 1;
+}
+
+size_t WiFiUDP::write(const uint8_t* buffer, size_t size) {
+  if (!_building) return 0;
+  _outgoing.data.insert(_outgoing.data.end(), buffer, buffer + size);
+  return size;
+}
+
+int WiFiUDP::endPacket() {
+  if (!_building) return 0;
+  _building = false;
+  _outgoing.atUs = micros();
+  {
+    std::lock_guard<std::mutex> lock(s_boundLock);
+    hostWire().push_back(_outgoing);
+  }
+  std::lock_guard<std::mutex> lock(_lock);
+  _sent.push_back(std::move(_outgoing));
+  _sentCount++;
+  return 1;
+}
+
+std::vector<HostPacket>& WiFiUDP::hostWire() {
+  static std::vector<HostPacket> wire;
+  return wire;
+}
+
+WiFiUDP* WiFiUDP::hostFind(uint16_t port) {
+  std::lock_guard<std::mutex> lock(s_boundLock);
+  auto it = s_bound.find(port);
+  return it == s_bound.end() ? nullptr : it->second;
+}
+
+void WiFiUDP::hostInject(const IPAddress& ip, uint16_t port, const uint8_t* data, size_t len) {
+  HostPacket packet;
+  packet.ip = ip;
+  packet.port = port;
+  packet.data.assign(data, data + len);
+  packet.atUs = micros();
+  std::lock_guard<std::mutex> lock(_lock);
+  _incoming.push_back(std::move(packet));
+}
+
+size_t WiFiUDP::hostPending() {
+  std::lock_guard<std::mutex> lock(_lock);
+  return _incoming.size();
+}
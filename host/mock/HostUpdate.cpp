@@ -0,0 +1,123 @@
+// 主机端Update替身的实现
+#include "Update.h"
+
+UpdateClass Update;
+
+// 固件镜像头的第一个字节
+static const uint8_t IMAGE_MAGIC = 0xE9;
+
+bool UpdateClass::begin(size_t size, int command, int, uint8_t, const char*) {
+  reset();
+  _error = UPDATE_ERROR_OK;
+  if (command != U_FLASH || size == 0) {
+    _error = UPDATE_ERROR_BAD_ARGUMENT;
+    return false;
+  }
+  _partition = esp_partition_find_first(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, "app1");
+  if (!_partition) {
+    _error = UPDATE_ERROR_NO_PARTITION;
+    return false;
+  }
+  if (size == UPDATE_SIZE_UNKNOWN) {
+    size = _partition->size;
+  } else if (size > _partition->size) {
+    _error = UPDATE_ERROR_SIZE;
+    return false;
+  }
+  _size = size;
+  return true;
+}
+
+size_t UpdateClass::write(uint8_t* data, size_t len) {
+  if (!isRunning() || hasError()) {
+    return 0;
+  }
+  if (len > remaining()) {
+    _error = UPDATE_ERROR_SPACE;
+    reset();
+    return 0;
+  }
+  size_t left = len;
+  while (left > 0) {
+    size_t chunk = SECTOR - _bufferLength;
+    if (chunk > left) chunk = left;
+    memcpy(_buffer + _bufferLength, data + (len - left), chunk);
+    _bufferLength += chunk;
+    left -= chunk;
+    if ((_bufferLength == SECTOR || _progress + _bufferLength == _size) && !flushBuffer()) {
+      return 0;
+    }
+  }
+  return len;
+}
+
+// 擦除下一个扇区并写入缓冲的内容
+bool UpdateClass::flushBuffer() {
+  if (_progress == 0 && _buffer[0] != IMAGE_MAGIC) {
+    _error = UPDATE_ERROR_MAGIC_BYTE;
+    reset();
+    return false;
+  }
+  if (esp_partition_erase_range(_partition, _progress, SECTOR) != ESP_OK) {
+    _error = UPDATE_ERROR_ERASE;
+    reset();
+    return false;
+  }
+  if (esp_partition_write(_partition, _progress, _buffer, _bufferLength) != ESP_OK) {
+    _error = UPDATE_ERROR_WRITE;
+    reset();
+    return false;
+  }
+  _progress += _bufferLength;
+  _bufferLength = 0;
+  return true;
+}
+
+bool UpdateClass::end(bool evenIfRemaining) {
+  if (hasError() || !isRunning()) {
+    return false;
+  }
+  if (_bufferLength > 0 && !flushBuffer()) {
+    return false;
+  }
+  if (_progress < _size && !evenIfRemaining) {
+    _error = UPDATE_ERROR_SIZE;
+    reset();
+    return false;
+  }
+  if (_progress == 0) {
+    _error = UPDATE_ERROR_SIZE;
+    reset();
+    return false;
+  }
+  _activations++;
+  _activatedSize = _progress;
+  reset();
+  return true;
+}
+
+void UpdateClass::abort() {
+  reset();
+  _error = UPDATE_ERROR_ABORT;
+}
+
+void UpdateClass::reset() {
+  _size = 0;
+  _progress = 0;
+  _bufferLength = 0;
+}
+
+const char* UpdateClass::errorString() const {
+  switch (_error) {
+    case UPDATE_ERROR_OK: return "No Error";
+    case UPDATE_ERROR_WRITE: return "Flash Write Failed";
+    case UPDATE_ERROR_ERASE: return "Flash Erase Failed";
+    case UPDATE_ERROR_SPACE: return "Not Enough Space";
+    case UPDATE_ERROR_SIZE: return "Bad Size Given";
+    case UPDATE_ERROR_MAGIC_BYTE: return "Wrong Magic Byte";
+    case UPDATE_ERROR_NO_PARTITION: return "Partition Could Not be Found";
+    case UPDATE_ERROR_BAD_ARGUMENT: return "Bad Argument";
+    case UPDATE_ERROR_ABORT: return "Aborted";
+  }
+  return "UNKNOWN";
+}
@@ -0,0 +1,78 @@
+// 主机端Update替身：固件写入名为"app1"的模拟分区（与partitions.csv中的OTA分区同名）
+// 与Arduino的UpdateClass一样先攒满一个4KB扇区，再擦除并写入；end()成功后记录为下次启动的分区
+#ifndef HOST_MOCK_UPDATE_H
+#define HOST_MOCK_UPDATE_H
+
+#include "Arduino.h"
+#include "esp_partition.h"
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+#define U_FLASH 0
+
+#define UPDATE_ERROR_OK 0
+#define UPDATE_ERROR_WRITE 1
+#define UPDATE_ERROR_ERASE 2
+#define UPDATE_ERROR_SPACE 4
+#define UPDATE_ERROR_SIZE 5
+#define UPDATE_ERROR_MAGIC_BYTE 8
+#define UPDATE_ERROR_NO_PARTITION 10
+#define UPDATE_ERROR_BAD_ARGUMENT 11
+#define UPDATE_ERROR_ABORT 12
+
+class UpdateClass {
+public:
+  bool begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = U_FLASH, int ledPin = -1, uint8_t ledOn = LOW,
+             const char* label = nullptr);
+  size_t write(uint8_t* data, size_t len);
+  bool end(bool evenIfRemaining = false);
+  void abort();
+
+  bool isRunning() const {
+    return _size > 0;
+  }
+  bool hasError() const {
+    return _error != UPDATE_ERROR_OK;
+  }
+  uint8_t getError() const {
+    return _error;
+  }
+  const char* errorString() const;
+  size_t size() const {
+    return _size;
+  }
+  size_t progress() const {
+    return _progress;
+  }
+  size_t remaining() const {
+    return _size - _progress;
+  }
+
+  // ---- 主机端控制接口 ----
+  // end()成功激活固件的次数
+  unsigned long hostActivations() const {
+    return _activations;
+  }
+  // 最近一次激活的固件大小
+  size_t hostActivatedSize() const {
+    return _activatedSize;
+  }
+
+private:
+  bool flushBuffer();
+  void reset();
+
+  static const size_t SECTOR = 4096;
+
+  const esp_partition_t* _partition = nullptr;
+  size_t _size = 0;
+  size_t _progress = 0;
+  uint8_t _buffer[SECTOR];
+  size_t _bufferLength = 0;
+  uint8_t _error = UPDATE_ERROR_OK;
+  unsigned long _activations = 0;
+  size_t _activatedSize = 0;
+};
+
+extern UpdateClass Update;
+
+#endif  // HOST_MOCK_UPDATE_H
@@ -0,0 +1,211 @@
+// 主机端WebServer替身：请求由模拟程序排队，handleClient()每次分发一个
+// 响应（状态码、头、正文、分块次数）被记录下来供检查
+#ifndef HOST_MOCK_WEBSERVER_H
+#define HOST_MOCK_WEBSERVER_H
+
+#include "Arduino.h"
+#include <functional>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <utility>
+
+enum HTTPMethod {
+  HTTP_ANY = -1,
+  HTTP_DELETE = 0,
+  HTTP_GET = 1,
+  HTTP_HEAD = 2,
+  HTTP_POST = 3,
+  HTTP_PUT = 4,
+  HTTP_OPTIONS = 6,
+  HTTP_PATCH = 28
+};
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+#define CONTENT_LENGTH_NOT_SET ((size_t)-2)
+
+typedef std::vector<std::pair<String, String>> HostArgs;
+
+// 与Arduino WebServer相同：上传的文件按HTTP_UPLOAD_BUFLEN字节分段交给上传处理函数
+#define HTTP_UPLOAD_BUFLEN 1436
+
+enum HTTPUploadStatus { UPLOAD_FILE_START, UPLOAD_FILE_WRITE, UPLOAD_FILE_END, UPLOAD_FILE_ABORTED };
+
+struct HTTPUpload {
+  HTTPUploadStatus status;
+  String filename;
+  String name;
+  String type;
+  size_t totalSize;    // 到目前为止收到的字节数
+  size_t currentSize;  // buf中的字节数
+  uint8_t buf[HTTP_UPLOAD_BUFLEN];
+};
+
+// 与Arduino WebServer相同：路由带有上传处理函数时，非表单的请求体按HTTP_RAW_BUFLEN字节分段交给它，
+// 不再保存到"plain"参数中
+#define HTTP_RAW_BUFLEN 1436
+
+enum HTTPRawStatus { RAW_START, RAW_WRITE, RAW_END, RAW_ABORTED };
+
+struct HTTPRaw {
+  HTTPRawStatus status;
+  size_t totalSize;    // 到目前为止收到的字节数
+  size_t currentSize;  // buf中的字节数
+  uint8_t buf[HTTP_RAW_BUFLEN];
+};
+
+// 一个排队等待处理的请求
+struct HostRequest {
+  HTTPMethod method = HTTP_GET;
+  String uri;
+  HostArgs args;
+  HostArgs headers;
+  String body;
+  // multipart上传的文件：uploadName不为空时逐段交给路由的上传处理函数
+  String uploadName;
+  std::string upload;
+  size_t uploadAbortAt = 0;  // 不为0时在收到这么多字节后模拟连接中断
+  unsigned long readDelayMs = 0;  // 模拟缓慢的客户端：handleClient()读取请求时等待这么久（真实时间）
+};
+
+// 处理完成后记录的响应
+struct HostResponse {
+  int code = 0;
+  String contentType;
+  HostArgs headers;
+  std::string body;
+  size_t chunks = 0;
+  bool chunked = false;
+  bool handled = false;
+
+  String header(const char* name) const;
+};
+
+class WebServer {
+public:
+  typedef std::function<void(void)> THandlerFunction;
+
+  explicit WebServer(int port = 80) : _port(port) {
+    _last = this;
+  }
+  ~WebServer() {
+    if (_last == this) _last = nullptr;
+  }
+
+  void begin() {
+    _begun = true;
+  }
+  void stop() {
+    _begun = false;
+  }
+  void handleClient();
+
+  void on(const String& uri, HTTPMethod method, THandlerFunction fn);
+  void on(const String& uri, HTTPMethod method, THandlerFunction fn, THandlerFunction ufn);
+  void onNotFound(THandlerFunction fn) {
+    _notFound = fn;
+  }
+
+  String uri() const {
+    return _current.uri;
+  }
+  HTTPMethod method() const {
+    return _current.method;
+  }
+  HTTPUpload& upload() {
+    return _upload;
+  }
+  HTTPRaw& raw() {
+    return _raw;
+  }
+  String arg(const String& name) const;
+  String arg(int i) const;
+  String argName(int i) const;
+  int args() const;
+  bool hasArg(const String& name) const;
+  String header(const String& name) const;
+  bool hasHeader(const String& name) const;
+  void collectHeaders(const char* headerKeys[], const size_t headerKeysCount);
+
+  void send(int code, const char* contentType = nullptr, const String& content = String(""));
+  void send(int code, const String& contentType, const String& content) {
+    send(code, contentType.c_str(), content);
+  }
+  void send(int code, const char* contentType, const char* content) {
+    send(code, contentType, String(content));
+  }
+  void send_P(int code, PGM_P contentType, PGM_P content);
+  void send_P(int code, PGM_P contentType, PGM_P content, size_t contentLength);
+  void setContentLength(size_t len) {
+    _contentLength = len;
+  }
+  void sendHeader(const String& name, const String& value, bool first = false);
+  void sendContent(const String& content);
+  void sendContent(const char* content, size_t size);
+  void sendContent_P(PGM_P content, size_t size) {
+    sendContent(content, size);
+  }
+
+  // ---- 主机端控制接口 ----
+  // 最近创建的实例，模拟程序通过它向管理器发送请求
+  static WebServer* hostInstance() {
+    return _last;
+  }
+  // 可以在其他线程中排队，处理完成后hostHandled()增加
+  void hostQueue(const HostRequest& req) {
+    std::lock_guard<std::mutex> lock(_queueLock);
+    _queue.push_back(req);
+  }
+  // 排队并立即处理一个请求，返回其响应
+  const HostResponse& hostRequest(const HostRequest& req);
+  const HostResponse& hostLastResponse() const {
+    return _response;
+  }
+  size_t hostPending() {
+    std::lock_guard<std::mutex> lock(_queueLock);
+    return _queue.size();
+  }
+  size_t hostRouteCount() const {
+    return _routes.size();
+  }
+  bool hostBegun() const {
+    return _begun;
+  }
+  unsigned long hostHandled() const {
+    return _handled.load();
+  }
+
+private:
+  struct Route {
+    String uri;
+    HTTPMethod method;
+    THandlerFunction fn;
+    THandlerFunction ufn;
+  };
+
+  void startResponse(int code, const char* contentType, size_t length);
+  bool dispatchUpload(THandlerFunction& uploadHandler);
+  bool dispatchRaw(THandlerFunction& rawHandler);
+
+  static WebServer* _last;
+
+  int _port;
+  bool _begun = false;
+  std::vector<Route> _routes;
+  THandlerFunction _notFound;
+  std::vector<String> _collected;
+
+  std::mutex _queueLock;
+  std::deque<HostRequest> _queue;
+  HostRequest _current;
+  HTTPUpload _upload;
+  HTTPRaw _raw;
+  bool _rawBody = false;  // 当前请求的请求体已分段交给处理函数
+  HostResponse _response;
+  HostArgs _pendingHeaders;
+  size_t _contentLength = CONTENT_LENGTH_NOT_SET;
+  std::atomic<unsigned long> _handled{ 0 };
+};
+
+#endif  // HOST_MOCK_WEBSERVER_H
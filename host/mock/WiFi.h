@@ -0,0 +1,260 @@
+// 主机端WiFi替身：按虚拟时钟模拟扫描、认证和DHCP各阶段
+// 模拟程序通过host*接口布置网络环境和脚本化的状态变化
+#ifndef HOST_MOCK_WIFI_H
+#define HOST_MOCK_WIFI_H
+
+#include "Arduino.h"
+#include <functional>
+#include <vector>
+
+typedef enum {
+  WL_NO_SHIELD = 255,
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL = 1,
+  WL_SCAN_COMPLETED = 2,
+  WL_CONNECTED = 3,
+  WL_CONNECT_FAILED = 4,
+  WL_CONNECTION_LOST = 5,
+  WL_DISCONNECTED = 6
+} wl_status_t;
+
+typedef enum {
+  WIFI_MODE_NULL = 0,
+  WIFI_MODE_STA,
+  WIFI_MODE_AP,
+  WIFI_MODE_APSTA,
+  WIFI_MODE_MAX
+} wifi_mode_t;
+
+// 与arduino-esp32一致的事件编号（只列出用到的部分）
+typedef enum {
+  ARDUINO_EVENT_WIFI_READY = 0,
+  ARDUINO_EVENT_WIFI_SCAN_DONE,
+  ARDUINO_EVENT_WIFI_STA_START,
+  ARDUINO_EVENT_WIFI_STA_STOP,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_AUTHMODE_CHANGE,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP6,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP,
+  ARDUINO_EVENT_WIFI_AP_START,
+  ARDUINO_EVENT_WIFI_AP_STOP,
+  ARDUINO_EVENT_WIFI_AP_STACONNECTED,
+  ARDUINO_EVENT_WIFI_AP_STADISCONNECTED,
+  ARDUINO_EVENT_MAX = 46
+} arduino_event_id_t;
+
+// esp_wifi_types.h中的断开原因（只列出用到的部分）
+typedef enum {
+  WIFI_REASON_UNSPECIFIED = 1,
+  WIFI_REASON_AUTH_EXPIRE = 2,
+  WIFI_REASON_ASSOC_LEAVE = 8,
+  WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT = 15,
+  WIFI_REASON_BEACON_TIMEOUT = 200,
+  WIFI_REASON_NO_AP_FOUND = 201,
+  WIFI_REASON_AUTH_FAIL = 202,
+  WIFI_REASON_ASSOC_FAIL = 203,
+  WIFI_REASON_HANDSHAKE_TIMEOUT = 204,
+  WIFI_REASON_CONNECTION_FAIL = 205
+} wifi_err_reason_t;
+
+typedef struct {
+  uint8_t ssid[32];
+  uint8_t ssid_len;
+  uint8_t bssid[6];
+  uint8_t reason;
+} wifi_event_sta_disconnected_t;
+
+typedef struct {
+  uint8_t mac[6];
+  uint8_t aid;
+} wifi_event_ap_staconnected_t;
+
+typedef wifi_event_ap_staconnected_t wifi_event_ap_stadisconnected_t;
+
+typedef union {
+  wifi_event_sta_disconnected_t wifi_sta_disconnected;
+  wifi_event_ap_staconnected_t wifi_ap_staconnected;
+  wifi_event_ap_stadisconnected_t wifi_ap_stadisconnected;
+} arduino_event_info_t;
+
+typedef arduino_event_id_t WiFiEvent_t;
+typedef arduino_event_info_t WiFiEventInfo_t;
+typedef std::function<void(arduino_event_id_t event, arduino_event_info_t info)> WiFiEventFuncCb;
+typedef size_t wifi_event_id_t;
+
+#define WIFI_SCAN_RUNNING (-1)
+
+typedef enum {
+  WIFI_AUTH_OPEN = 0,
+  WIFI_AUTH_WEP,
+  WIFI_AUTH_WPA_PSK,
+  WIFI_AUTH_WPA2_PSK,
+  WIFI_AUTH_WPA_WPA2_PSK,
+  WIFI_AUTH_WPA2_ENTERPRISE,
+  WIFI_AUTH_WPA3_PSK,
+  WIFI_AUTH_WPA2_WPA3_PSK,
+  WIFI_AUTH_MAX
+} wifi_auth_mode_t;
+#define WIFI_SCAN_FAILED (-2)
+
+#define WIFI_OFF WIFI_MODE_NULL
+#define WIFI_STA WIFI_MODE_STA
+#define WIFI_AP WIFI_MODE_AP
+#define WIFI_AP_STA WIFI_MODE_APSTA
+
+// 模拟环境中的一个接入点
+struct HostNetwork {
+  String ssid;
+  String password;
+  int32_t rssi = -55;
+  int32_t channel = 6;
+  uint8_t bssid[6] = { 0x24, 0x0a, 0xc4, 0x00, 0x00, 0x01 };
+  unsigned long scanMs = 1800;  // 全信道扫描耗时
+  unsigned long authMs = 400;   // 关联与四次握手耗时
+  unsigned long dhcpMs = 700;   // DHCP耗时（使用静态IP时跳过）
+  bool reachable = true;
+};
+
+class WiFiClass {
+public:
+  bool mode(wifi_mode_t m);
+  wifi_mode_t getMode();
+  wl_status_t begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0,
+                    const uint8_t* bssid = nullptr, bool connect = true);
+  bool disconnect(bool wifioff = false, bool eraseap = false);
+  // 模拟环境中驱动不会自动重连，这里只记录设置
+  bool setAutoReconnect(bool autoReconnect) {
+    _autoReconnect = autoReconnect;
+    return true;
+  }
+  bool getAutoReconnect() {
+    return _autoReconnect;
+  }
+  wl_status_t status();
+  bool isConnected() {
+    return status() == WL_CONNECTED;
+  }
+
+  bool softAP(const char* ssid, const char* passphrase = nullptr, int channel = 1,
+              int ssid_hidden = 0, int max_connection = 4);
+  bool softAPdisconnect(bool wifioff = false);
+  IPAddress softAPIP();
+
+  // 事件回调；模拟环境中由虚拟时钟推进时调用，与真实设备一样不在调用者的调用栈上
+  wifi_event_id_t onEvent(WiFiEventFuncCb cbEvent, arduino_event_id_t event = ARDUINO_EVENT_MAX);
+  void removeEvent(wifi_event_id_t id);
+
+  // 静态IP：local_ip为0时恢复DHCP
+  bool config(IPAddress local_ip, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(),
+              IPAddress dns2 = IPAddress());
+
+  IPAddress localIP();
+  uint8_t* macAddress(uint8_t* mac);
+  IPAddress gatewayIP();
+  IPAddress subnetMask();
+  IPAddress dnsIP(uint8_t dns_no = 0);
+  String SSID();
+  int8_t RSSI();
+  uint8_t* BSSID();
+  int32_t channel();
+
+  // 扫描：异步扫描在虚拟时钟推进hostScanMs后完成，结果为当时可达的网络
+  int16_t scanNetworks(bool async = false, bool show_hidden = false, bool passive = false,
+                       uint32_t max_ms_per_chan = 300, uint8_t channel = 0);
+  int16_t scanComplete();
+  void scanDelete();
+  String SSID(uint8_t i);
+  int32_t RSSI(uint8_t i);
+  int32_t channel(uint8_t i);
+  uint8_t* BSSID(uint8_t i);
+  wifi_auth_mode_t encryptionType(uint8_t i);
+
+  // ---- 主机端控制接口 ----
+  void hostReset();
+  HostNetwork& hostAddNetwork(const char* ssid, const char* password);
+  HostNetwork* hostFindNetwork(const char* ssid);
+  size_t hostNetworkCount() const {
+    return _networks.size();
+  }
+  HostNetwork& hostNetwork(size_t index) {
+    return _networks[index];
+  }
+  // 使当前链路立即断开（例如路由器重启）
+  void hostDropLink();
+  // 由虚拟时钟推进时调用，推进连接过程
+  void hostUpdate();
+  // 配网手机连接或离开AP
+  void hostStationJoin();
+  void hostStationLeave();
+
+  unsigned long hostScanMs = 1800;
+
+  unsigned long hostBeginCalls() const {
+    return _beginCalls;
+  }
+  unsigned long hostStatusCalls() const {
+    return _statusCalls;
+  }
+  unsigned long hostModeSwitches() const {
+    return _modeSwitches;
+  }
+  unsigned long hostScans() const {
+    return _scans;
+  }
+  unsigned long hostDhcpLeases() const {
+    return _dhcpLeases;
+  }
+  bool hostAPUp() const {
+    return _apUp;
+  }
+
+private:
+  void setStatus(wl_status_t s);
+  void raise(arduino_event_id_t event, uint8_t reason = 0);
+
+  struct Handler {
+    wifi_event_id_t id;
+    arduino_event_id_t event;
+    WiFiEventFuncCb fn;
+  };
+  std::vector<Handler> _handlers;
+  wifi_event_id_t _nextHandlerId = 1;
+  int _stations = 0;
+  bool _autoReconnect = true;
+
+  std::vector<HostNetwork> _networks;
+  wifi_mode_t _mode = WIFI_MODE_NULL;
+  wl_status_t _status = WL_IDLE_STATUS;
+  bool _apUp = false;
+
+  bool _pending = false;
+  bool _hintMismatch = false;
+  unsigned long _readyAt = 0;   // 关联完成的时间
+  bool _dhcpPending = false;
+  unsigned long _dhcpMs = 0;
+  unsigned long _gotIPAt = 0;   // 获得地址的时间
+  String _targetSSID;
+  String _targetPass;
+  int _connected = -1;  // _networks中已连接网络的下标
+
+  IPAddress _staticIP;
+  IPAddress _staticGateway;
+  IPAddress _staticSubnet;
+  IPAddress _staticDns;
+
+  bool _scanning = false;
+  bool _scanDone = false;
+  unsigned long _scanDoneAt = 0;
+  std::vector<int> _scanResults;  // _networks中的下标
+
+  unsigned long _beginCalls = 0;
+  unsigned long _statusCalls = 0;
+  unsigned long _modeSwitches = 0;
+  unsigned long _scans = 0;
+  unsigned long _dhcpLeases = 0;
+};
+extern WiFiClass WiFi;
+
+#endif  // HOST_MOCK_WIFI_H
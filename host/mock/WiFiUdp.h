@@ -0,0 +1,81 @@
+// 主机端WiFiUDP替身：按端口登记，模拟程序向指定端口注入数据包并检查发出的数据包
+#ifndef HOST_MOCK_WIFIUDP_H
+#define HOST_MOCK_WIFIUDP_H
+
+#include "Arduino.h"
+#include <deque>
+#include <mutex>
+#include <vector>
+
+// 注入或发出的一个数据包，时间为虚拟时钟（微秒）
+struct HostPacket {
+  IPAddress ip;
+  uint16_t port = 0;
+  std::vector<uint8_t> data;
+  unsigned long atUs = 0;
+};
+
+class WiFiUDP {
+public:
+  WiFiUDP() {}
+  ~WiFiUDP();
+
+  uint8_t begin(uint16_t port);
+  void stop();
+
+  int parsePacket();
+  int available() {
+    return (int)(_current.data.size() - _readPos);
+  }
+  int read(uint8_t* buffer, size_t len);
+  int read(char* buffer, size_t len) {
+    return read((uint8_t*)buffer, len);
+  }
+  void flush() {
+    _readPos = _current.data.size();
+  }
+  IPAddress remoteIP() const {
+    return _current.ip;
+  }
+  uint16_t remotePort() const {
+    return _current.port;
+  }
+
+  int beginPacket(IPAddress ip, uint16_t port);
+  size_t write(const uint8_t* buffer, size_t size);
+  size_t write(uint8_t c) {
+    return write(&c, 1);
+  }
+  int endPacket();
+
+  // ---- 主机端控制接口 ----
+  // 正在监听指定端口的实例
+  static WiFiUDP* hostFind(uint16_t port);
+  void hostInject(const IPAddress& ip, uint16_t port, const uint8_t* data, size_t len);
+  size_t hostPending();
+  std::vector<HostPacket>& hostSent() {
+    return _sent;
+  }
+  // 所有实例发出的数据包，按发送顺序排列（包括没有调用begin()的实例）
+  static std::vector<HostPacket>& hostWire();
+  // 累计发出的数据包数量（不会被清空）
+  unsigned long hostSentCount() const {
+    return _sentCount;
+  }
+  uint16_t hostPort() const {
+    return _port;
+  }
+
+private:
+  uint16_t _port = 0;
+  std::mutex _lock;
+  std::deque<HostPacket> _incoming;
+  HostPacket _current;
+  size_t _readPos = 0;
+  HostPacket _outgoing;
+  bool _building = false;
+  std::vector<HostPacket> _sent;
+  unsigned long _sentCount = 0;
+};
+
+#endif  // HOST_MOCK_WIFIUDP_H
@@ -0,0 +1,60 @@
+// 主机端esp_partition替身：RAM中的NOR Flash分区
+// 写入只能把位从1变为0，擦除以4KB扇区为单位，并统计写入量和擦除次数
+#ifndef HOST_MOCK_ESP_PARTITION_H
+#define HOST_MOCK_ESP_PARTITION_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef int esp_err_t;
+#define ESP_OK 0
+#define ESP_FAIL -1
+#define ESP_ERR_INVALID_ARG 0x102
+#define ESP_ERR_INVALID_SIZE 0x104
+
+typedef enum {
+  ESP_PARTITION_TYPE_APP = 0x00,
+  ESP_PARTITION_TYPE_DATA = 0x01,
+  ESP_PARTITION_TYPE_ANY = 0xff
+} esp_partition_type_t;
+
+typedef enum {
+  ESP_PARTITION_SUBTYPE_DATA_NVS = 0x02,
+  ESP_PARTITION_SUBTYPE_ANY = 0xff
+} esp_partition_subtype_t;
+
+typedef struct {
+  esp_partition_type_t type;
+  esp_partition_subtype_t subtype;
+  uint32_t address;
+  uint32_t size;
+  char label[17];
+  bool encrypted;
+} esp_partition_t;
+
+const esp_partition_t* esp_partition_find_first(esp_partition_type_t type, esp_partition_subtype_t subtype,
+                                                const char* label);
+esp_err_t esp_partition_read(const esp_partition_t* partition, size_t src_offset, void* dst, size_t size);
+esp_err_t esp_partition_write(const esp_partition_t* partition, size_t dst_offset, const void* src, size_t size);
+esp_err_t esp_partition_erase_range(const esp_partition_t* partition, size_t offset, size_t size);
+
+// ---- 主机端控制接口 ----
+struct HostFlashStats {
+  unsigned long bytesProgrammed = 0;  // 写入的字节数
+  unsigned long sectorErases = 0;     // 擦除的扇区数
+  unsigned long maxSectorErases = 0;  // 单个扇区的最大擦除次数（磨损热点）
+  unsigned long bytesRead = 0;        // 读出的字节数
+};
+
+// 创建（或清空）一个数据分区，内容为擦除状态0xFF
+void hostPartitionCreate(const char* label, uint32_t size);
+// 删除分区，模拟使用默认分区表的设备
+void hostPartitionRemove(const char* label);
+HostFlashStats hostPartitionStats(const char* label);
+void hostPartitionResetStats(const char* label);
+// 在指定偏移处写入任意数据（不受NOR限制），用于模拟损坏
+void hostPartitionCorrupt(const char* label, uint32_t offset, uint8_t val);
+// 让写入和擦除失败，模拟Flash故障
+void hostPartitionFailWrites(const char* label, bool fail);
+
+#endif  // HOST_MOCK_ESP_PARTITION_H
@@ -0,0 +1,19 @@
+// 主机端esp_sleep替身：esp_deep_sleep_start()抛出HostDeepSleep，由模拟程序捕获后调用hostDeepSleepWake()
+#ifndef HOST_MOCK_ESP_SLEEP_H
+#define HOST_MOCK_ESP_SLEEP_H
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+#ifndef ESP_OK
+#define ESP_OK 0
+#endif
+
+struct HostDeepSleep {
+  uint64_t wakeupUs;  // 定时唤醒的时间，0表示没有设置
+};
+
+esp_err_t esp_sleep_enable_timer_wakeup(uint64_t time_in_us);
+[[noreturn]] void esp_deep_sleep_start(void);
+
+#endif  // HOST_MOCK_ESP_SLEEP_H
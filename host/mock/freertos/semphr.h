@@ -0,0 +1,14 @@
+// 主机端FreeRTOS信号量替身：递归互斥锁用std::recursive_timed_mutex实现
+#ifndef HOST_MOCK_FREERTOS_SEMPHR_H
+#define HOST_MOCK_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+
+typedef struct HostSemaphore* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t xMutex, TickType_t xTicksToWait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t xMutex);
+void vSemaphoreDelete(SemaphoreHandle_t xSemaphore);
+
+#endif  // HOST_MOCK_FREERTOS_SEMPHR_H
@@ -0,0 +1,31 @@
+// 主机端FreeRTOS任务替身：每个任务是一个std::thread
+// vTaskDelay()按真实时间休眠，不推进虚拟时钟
+#ifndef HOST_MOCK_FREERTOS_TASK_H
+#define HOST_MOCK_FREERTOS_TASK_H
+
+#include "FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void*);
+typedef struct HostTask* TaskHandle_t;
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t pvTaskCode, const char* pcName, uint32_t usStackDepth,
+                                   void* pvParameters, UBaseType_t uxPriority, TaskHandle_t* pvCreatedTask,
+                                   BaseType_t xCoreID);
+// 只支持删除当前任务（参数为nullptr），任务函数随后返回即结束线程
+void vTaskDelete(TaskHandle_t xTaskToDelete);
+void vTaskDelay(TickType_t xTicksToDelay);
+BaseType_t xPortGetCoreID(void);
+
+// ---- 主机端控制接口 ----
+// 已创建且尚未结束的任务数量
+int hostTaskCount();
+// 最近一次创建任务时的参数
+struct HostTaskInfo {
+  const char* name;
+  uint32_t stackDepth;
+  UBaseType_t priority;
+  BaseType_t core;
+};
+HostTaskInfo hostLastTask();
+
+#endif  // HOST_MOCK_FREERTOS_TASK_H
@@ -0,0 +1,36 @@
+// 主机端lwIP异步域名解析替身：名字表由模拟程序设置，结果按虚拟时钟延迟后通过回调返回
+#ifndef HOST_MOCK_LWIP_DNS_H
+#define HOST_MOCK_LWIP_DNS_H
+
+#include <stdint.h>
+#include "lwip/err.h"
+
+#define DNS_MAX_NAME_LENGTH 256
+
+// 只支持IPv4，地址为网络字节序
+typedef struct {
+  uint32_t addr;
+} ip_addr_t;
+#define IP_IS_V4(ipaddr) 1
+#define ip_addr_get_ip4_u32(ipaddr) ((ipaddr)->addr)
+
+// 解析完成时调用，失败时ipaddr为nullptr；替身在推进虚拟时钟的线程中调用，调用期间持有TCP/IP核心锁
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* ipaddr, void* callback_arg);
+
+// 名字是IP地址或已在缓存中时返回ERR_OK并填写addr，否则返回ERR_INPROGRESS，稍后调用found
+// 与lwIP相同，只能在TCP/IP任务中调用（见lwip/tcpip.h），否则计入hostLwipUnlockedCalls()
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg);
+
+// ---- 主机端控制接口 ----
+// 添加一个可解析的名字，ip为网络字节序，delayMs为从查询到回复的虚拟时间
+void hostDnsAdd(const char* name, uint32_t ip, unsigned long delayMs);
+// 不在名字表中的名字在这段虚拟时间后解析失败
+#define HOST_DNS_TIMEOUT_MS 5000
+// 推进虚拟时钟时调用，到期的查询调用回调
+void hostDnsUpdate();
+// 上电复位：清空缓存和进行中的查询，名字表保留
+void hostDnsReset();
+// dns_gethostbyname()的调用次数
+unsigned long hostDnsQueries();
+
+#endif  // HOST_MOCK_LWIP_DNS_H
@@ -0,0 +1,13 @@
+// 主机端lwIP错误码替身，只包含用到的部分
+#ifndef HOST_MOCK_LWIP_ERR_H
+#define HOST_MOCK_LWIP_ERR_H
+
+#include <stdint.h>
+
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_MEM -1
+#define ERR_INPROGRESS -5
+#define ERR_ARG -16
+
+#endif  // HOST_MOCK_LWIP_ERR_H
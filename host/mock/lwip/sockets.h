@@ -0,0 +1,14 @@
+// 主机端lwIP socket替身：直接使用系统的POSIX socket
+#ifndef HOST_MOCK_LWIP_SOCKETS_H
+#define HOST_MOCK_LWIP_SOCKETS_H
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#endif  // HOST_MOCK_LWIP_SOCKETS_H
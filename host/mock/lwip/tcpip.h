@@ -0,0 +1,16 @@
+// 主机端lwIP TCP/IP任务替身：回调在调用者的线程中立即执行，执行期间持有模拟的TCP/IP核心锁
+#ifndef HOST_MOCK_LWIP_TCPIP_H
+#define HOST_MOCK_LWIP_TCPIP_H
+
+#include "lwip/err.h"
+
+typedef void (*tcpip_callback_fn)(void* ctx);
+
+// 在TCP/IP任务的上下文中执行function
+err_t tcpip_callback(tcpip_callback_fn function, void* ctx);
+
+// ---- 主机端控制接口 ----
+// 不在TCP/IP任务上下文中调用lwIP内部接口（如dns_gethostbyname()）的次数
+unsigned long hostLwipUnlockedCalls();
+
+#endif  // HOST_MOCK_LWIP_TCPIP_H
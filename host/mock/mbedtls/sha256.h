@@ -0,0 +1,21 @@
+// 主机端mbedTLS SHA-256替身：接口与mbedTLS 3.x相同（函数返回int），纯软件实现
+#ifndef HOST_MOCK_MBEDTLS_SHA256_H
+#define HOST_MOCK_MBEDTLS_SHA256_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+typedef struct {
+  uint32_t state[8];
+  uint64_t total;       // 已输入的字节数
+  uint8_t buffer[64];   // 未满一个分组的输入
+  int is224;
+} mbedtls_sha256_context;
+
+void mbedtls_sha256_init(mbedtls_sha256_context* ctx);
+void mbedtls_sha256_free(mbedtls_sha256_context* ctx);
+int mbedtls_sha256_starts(mbedtls_sha256_context* ctx, int is224);
+int mbedtls_sha256_update(mbedtls_sha256_context* ctx, const unsigned char* input, size_t ilen);
+int mbedtls_sha256_finish(mbedtls_sha256_context* ctx, unsigned char output[32]);
+
+#endif  // HOST_MOCK_MBEDTLS_SHA256_H
@@ -0,0 +1,1919 @@
+// 主机端模拟程序：在虚拟时钟和替身外设上运行WiFiConfigManager的典型场景
+// 输出连接耗时、loop()耗时、请求处理耗时和Flash写入统计
+#include "WiFiConfigManager.h"
+#include "HostHal.h"
+#include "esp_partition.h"
+
+#include "freertos/task.h"
+#include "WiFiUdp.h"
+#include "Update.h"
+#include "mbedtls/sha256.h"
+#include "esp_sleep.h"
+#include "lwip/dns.h"
+#include "lwip/tcpip.h"
+
+#include <lwip/sockets.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+static const unsigned long TICK_MS = 10;  // 与示例sketch中的delay(10)一致
+static const uint32_t CONFIG_PARTITION_SIZE = 0x4000;  // 与partitions.csv一致
+
+static int s_failures = 0;
+
+static void check(bool cond, const char* what) {
+  if (!cond) {
+    printf("  FAILED: %s\n", what);
+    s_failures++;
+  }
+}
+
+static double nowNs() {
+  using namespace std::chrono;
+  return (double)duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+// 统计一段时间内每次loop()调用的实际耗时
+struct LoopStats {
+  unsigned long ticks = 0;
+  double totalNs = 0;
+  double maxNs = 0;
+
+  void add(double ns) {
+    ticks++;
+    totalNs += ns;
+    if (ns > maxNs) maxNs = ns;
+  }
+  double avgNs() const {
+    return ticks ? totalNs / ticks : 0;
+  }
+};
+
+// 运行loop()直到条件满足或超过虚拟时间上限，返回消耗的虚拟时间
+static unsigned long runUntil(WiFiConfigManager& mgr, std::function<bool()> done,
+                              unsigned long limitMs, LoopStats* stats = nullptr) {
+  unsigned long start = hostNowMs();
+  while (!done() && hostNowMs() - start < limitMs) {
+    double t0 = nowNs();
+    mgr.loop();
+    double t1 = nowNs();
+    if (stats) stats->add(t1 - t0);
+    hostAdvance(TICK_MS);
+  }
+  return hostNowMs() - start;
+}
+
+static HostRequest saveRequest(const char* ssid, const char* password) {
+  HostRequest req;
+  req.method = HTTP_POST;
+  req.uri = "/save";
+  req.args = { { "ssid", ssid }, { "password", password } };
+  return req;
+}
+
+// 首次启动：没有配置，进入AP模式，通过网页配置后连接成功
+static void scenarioProvision() {
+  printf("[provision]\n");
+  hostReset();
+  EEPROM.hostErase();
+  EEPROM.hostResetCounters();
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  WiFi.hostAddNetwork("HomeNet", "secret123");
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  check(WiFi.hostAPUp(), "AP should be up without saved credentials");
+
+  WebServer::hostInstance()->hostQueue(saveRequest("HomeNet", "secret123"));
+  double t0 = nowNs();
+  mgr.loop();
+  double handlerNs = nowNs() - t0;
+  check(WebServer::hostInstance()->hostLastResponse().code == 200, "save should answer 200");
+
+  unsigned long ttc = runUntil(mgr, [&] { return mgr.isConnected(); }, 30000);
+  check(mgr.isConnected(), "should connect after provisioning");
+  printf("  save handler + loop: %.1f us (host)\n", handlerNs / 1000.0);
+  printf("  time to connect after save: %lu ms (virtual)\n", ttc);
+  // 宽限期后配置AP关闭，Web服务器随之停止，配置接口不会暴露在局域网上
+  runUntil(mgr, [] { return !WiFi.hostAPUp(); }, 15000);
+  HostRequest root;
+  root.uri = "/";
+  check(!WiFi.hostAPUp() && !WebServer::hostInstance()->hostBegun()
+        && !WebServer::hostInstance()->hostRequest(root).handled, "web server should stop with the portal");
+  HostFlashStats flash = hostPartitionStats("wcfg");
+  printf("  journal: %lu bytes programmed, %lu sector erases\n", flash.bytesProgrammed,
+         flash.sectorErases);
+}
+
+// 正常启动：已有配置，测量从begin()到连接成功的时间和连接期间loop()的耗时
+static void scenarioBoot() {
+  printf("[boot]\n");
+  hostReset();
+  EEPROM.hostResetCounters();
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  unsigned long t0 = hostNowMs();
+  mgr.begin();
+  unsigned long blocked = hostNowMs() - t0;
+
+  LoopStats stats;
+  unsigned long ttc = runUntil(mgr, [&] { return mgr.isConnected(); }, 30000, &stats);
+  check(mgr.isConnected(), "should connect with saved credentials");
+  check(blocked < 50, "begin() should not block");
+  printf("  begin() blocked: %lu ms (virtual)\n", blocked);
+  printf("  time to connect: %lu ms (virtual)\n", ttc);
+  printf("  loop() during connect: %lu ticks, avg %.1f ns, max %.1f ns (host)\n", stats.ticks,
+         stats.avgNs(), stats.maxNs);
+  printf("  WiFi.status() calls: %lu\n", WiFi.hostStatusCalls());
+}
+
+// 目标网络不可用：超时后回退到AP模式，期间loop()保持响应
+static void scenarioFallback() {
+  printf("[fallback]\n");
+  hostReset();
+  WiFi.hostFindNetwork("HomeNet")->reachable = false;
+
+  WiFiConfigManager mgr;
+  mgr.setConnectionTimeout(5);
+  mgr.eepromBegin();
+  mgr.begin();
+
+  LoopStats stats;
+  unsigned long t = runUntil(mgr, [&] { return WiFi.hostAPUp(); }, 30000, &stats);
+  check(WiFi.hostAPUp(), "should fall back to AP mode");
+  printf("  fallback to AP after: %lu ms (virtual)\n", t);
+  printf("  loop() max %.1f ns over %lu ticks (host)\n", stats.maxNs, stats.ticks);
+  WiFi.hostFindNetwork("HomeNet")->reachable = true;
+}
+
+// 存储的配置损坏：CRC校验失败后使用默认配置并进入AP模式
+static void scenarioCorruptConfig() {
+  printf("[corrupt-config]\n");
+  hostReset();
+  EEPROM.hostResetCounters();
+  // 日志中只有首次配置写入的一条记录，位于扇区0开头；破坏其SSID字段
+  hostPartitionCorrupt("wcfg", 16 + 14, 'X');
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  check(WiFi.hostAPUp(), "corrupt configuration should fall back to AP mode");
+  check(WiFi.hostBeginCalls() == 0, "corrupt configuration should not be used to connect");
+}
+
+// 旧固件按固定地址保存的配置（见WiFiConfigRecord.cpp中的LEGACY_*）：启动时导入一次并保存为记录
+static void writeLegacyField(int address, const char* value) {
+  for (size_t i = 0; i <= strlen(value); i++) EEPROM.hostCorrupt(address + (int)i, (uint8_t)value[i]);
+}
+
+// 分区中残留着其他数据（例如以前分区表中的spiffs），没有任何有效记录
+static void fillPartitionGarbage() {
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  for (uint32_t offset = 0; offset < CONFIG_PARTITION_SIZE; offset += 61) {
+    hostPartitionCorrupt("wcfg", offset, (uint8_t)(offset * 7 + 1));
+  }
+}
+
+static void scenarioLegacyImport() {
+  printf("[legacy-import]\n");
+  WiFi.hostAddNetwork("OldHome", "legacy-pw");
+
+  // 2：残留数据的日志分区，1：全新的日志分区，0：没有分区
+  for (int mode = 2; mode >= 0; mode--) {
+    bool journal = mode > 0;
+    hostReset();
+    EEPROM.hostErase();
+    if (mode == 2) fillPartitionGarbage();
+    else if (journal) hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+    else hostPartitionRemove("wcfg");
+    writeLegacyField(1, "OldHome");
+    writeLegacyField(33, "legacy-pw");
+    writeLegacyField(65, "1");  // 与旧固件的写入顺序相同，开关的结尾'\0'随后被客户端ID覆盖
+    writeLegacyField(66, "old-device");
+    writeLegacyField(167, "mqtt.lan");
+    writeLegacyField(199, "1883");
+    writeLegacyField(205, "user");
+    writeLegacyField(306, "pass");
+    writeLegacyField(563, "0");
+    writeLegacyField(564, "sensor");
+    writeLegacyField(596, "5000");
+    EEPROM.hostResetCounters();
+
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    check(mgr.getNetworkCount() == 1 && strcmp(mgr.getNetworkSSID(0), "OldHome") == 0,
+          "legacy credentials should be imported");
+    check(mgr.getMQTTEnabled() && strcmp(mgr.getMQTTServer(), "mqtt.lan") == 0 && mgr.getMQTTPort() == 1883
+          && strcmp(mgr.getMQTTClientID(), "old-device") == 0 && strcmp(mgr.getMQTTUsername(), "user") == 0
+          && strcmp(mgr.getMQTTPassword(), "pass") == 0, "legacy MQTT settings should be imported");
+    check(!mgr.getUDPEnabled() && mgr.getUDPPort() == 5000 && strcmp(mgr.getDeviceName(), "sensor") == 0,
+          "legacy UDP settings should be imported");
+    unsigned long written = journal ? hostPartitionStats("wcfg").bytesProgrammed : EEPROM.hostCommits();
+    check(written > 0, "imported configuration should be saved as a record");
+    mgr.begin();
+    runUntil(mgr, [&] { return mgr.isConnected(); }, 30000);
+    check(mgr.isConnected(), "should connect with imported credentials");
+
+    // 第二次启动读取新记录，不再导入
+    hostReset();
+    WiFiConfigManager again;
+    again.eepromBegin();
+    unsigned long rewritten = journal ? hostPartitionStats("wcfg").bytesProgrammed : EEPROM.hostCommits();
+    check(again.getNetworkCount() == 1 && again.getMQTTPort() == 1883 && rewritten == written,
+          "legacy layout should be imported only once");
+    printf("  %s: imported on first boot, %lu %s\n",
+           mode == 2 ? "journal (garbage)" : journal ? "journal" : "EEPROM", written,
+           journal ? "bytes programmed" : "commit");
+  }
+
+  // EEPROM中已有配置，新启用的分区中残留数据：仍然迁移到日志
+  hostReset();
+  EEPROM.hostErase();
+  hostPartitionRemove("wcfg");
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    mgr.begin();
+    WebServer::hostInstance()->hostQueue(saveRequest("OldHome", "legacy-pw"));
+    runUntil(mgr, [] { return false; }, 3 * TICK_MS);
+  }
+  hostReset();
+  fillPartitionGarbage();
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    check(mgr.getNetworkCount() == 1 && strcmp(mgr.getNetworkSSID(0), "OldHome") == 0,
+          "EEPROM configuration should load despite a partition with garbage");
+    check(hostPartitionStats("wcfg").bytesProgrammed > 0, "EEPROM configuration should be migrated to the journal");
+  }
+  hostReset();
+  EEPROM.hostErase();
+  WiFiConfigManager again;
+  again.eepromBegin();
+  check(again.getNetworkCount() == 1 && strcmp(again.getNetworkSSID(0), "OldHome") == 0,
+        "migrated configuration should load from the journal");
+}
+
+// 反复重新配置：比较配置日志和EEPROM两种存储的写放大和擦除次数
+static void reprovision(bool journal, int rounds) {
+  hostReset();
+  EEPROM.hostErase();
+  EEPROM.hostResetCounters();
+  if (journal) hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  else hostPartitionRemove("wcfg");
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+
+  char password[16];
+  for (int i = 0; i < rounds; i++) {
+    snprintf(password, sizeof(password), "secret%03d", i);
+    WebServer::hostInstance()->hostQueue(saveRequest("HomeNet", password));
+    runUntil(mgr, [] { return false; }, 3 * TICK_MS);  // 回复、写入存储、发起连接各占一次loop()
+  }
+
+  unsigned long logical = (unsigned long)rounds * sizeof(WiFiConfigRecord);
+  if (journal) {
+    HostFlashStats flash = hostPartitionStats("wcfg");
+    printf("  journal: %d saves, %lu bytes programmed, %lu sector erases (max %lu per sector), "
+           "write amplification %.2f\n",
+           rounds, flash.bytesProgrammed, flash.sectorErases, flash.maxSectorErases,
+           (double)flash.bytesProgrammed / logical);
+    check(flash.maxSectorErases * 4 <= flash.sectorErases + 4, "journal erases should be spread");
+  } else {
+    printf("  EEPROM:  %d saves, %lu commits, %lu bytes rewritten, write amplification %.2f\n", rounds,
+           EEPROM.hostCommits(), EEPROM.hostFlashBytesWritten(),
+           (double)EEPROM.hostFlashBytesWritten() / logical);
+  }
+}
+
+static void scenarioWear() {
+  printf("[wear]\n");
+  reprovision(false, 100);
+  reprovision(true, 100);
+
+  // 重启后从日志中恢复最后一次保存的配置
+  hostReset();
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTING; }, 100);
+  check(WiFi.hostBeginCalls() == 1, "latest journal record should be used after reboot");
+  WiFi.hostFindNetwork("HomeNet")->password = "secret099";
+  runUntil(mgr, [&] { return mgr.isConnected(); }, 30000);
+  check(mgr.isConnected(), "latest journal record should hold the last password");
+  WiFi.hostFindNetwork("HomeNet")->password = "secret123";
+}
+
+// 强制进入AP模式：重启标记保存在RTC内存中，整个过程不写Flash
+static void scenarioForcedAP() {
+  printf("[forced-ap]\n");
+  hostReset();
+  EEPROM.hostResetCounters();
+  hostPartitionResetStats("wcfg");
+
+  bool restarted = false;
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    try {
+      mgr.forceEnterAPConfigMode();
+    } catch (const HostRestart&) {
+      restarted = true;
+    }
+  }
+  check(restarted, "forceEnterAPConfigMode() should restart the device");
+
+  hostRestart();
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.forceEnterAPConfigMode();  // 示例sketch每次启动都会调用，重启后不应再次重启
+  unsigned long t0 = hostNowMs();
+  mgr.begin();
+  check(WiFi.hostAPUp(), "device should be in AP mode after the forced restart");
+  check(WiFi.hostBeginCalls() == 0, "forced AP boot should not connect");
+
+  HostFlashStats flash = hostPartitionStats("wcfg");
+  check(flash.bytesProgrammed == 0 && EEPROM.hostCommits() == 0, "forced AP should not write flash");
+  printf("  forced AP boot: %lu ms in begin(), %lu journal bytes, %lu EEPROM commits\n",
+         hostNowMs() - t0, flash.bytesProgrammed, EEPROM.hostCommits());
+
+  // 下一次正常启动（非软件重启）不再进入AP模式
+  hostReset();
+  WiFiConfigManager next;
+  next.eepromBegin();
+  next.begin();
+  check(!WiFi.hostAPUp(), "boot intent should be consumed");
+}
+
+// 配置页面：预压缩的页面直接从Flash发送，浏览器已缓存时回复304
+static void scenarioPortalPage() {
+  printf("[portal-page]\n");
+  hostReset();
+  WiFi.hostFindNetwork("HomeNet")->reachable = false;
+
+  WiFiConfigManager mgr;
+  mgr.setConnectionTimeout(1);
+  mgr.eepromBegin();
+  mgr.begin();
+  runUntil(mgr, [] { return WiFi.hostAPUp(); }, 5000);
+  WiFi.hostFindNetwork("HomeNet")->reachable = true;
+
+  // 已保存的配置会填入表单，特殊字符需要转义
+  mgr.setWiFiCredentials("Cafe <\"&'>", "p&ss");
+  WiFi.hostFindNetwork("HomeNet")->reachable = false;
+  runUntil(mgr, [] { return WiFi.hostAPUp(); }, 5000);
+
+  HostRequest req;
+  req.uri = "/";
+  double t0 = nowNs();
+  HostResponse page = WebServer::hostInstance()->hostRequest(req);
+  double pageNs = nowNs() - t0;
+  check(page.code == 200, "portal page should answer 200");
+  check(page.chunked, "portal page should be sent with chunked encoding");
+  check(page.body.find("value=\"Cafe &lt;&quot;&amp;&#39;&gt;\"") != std::string::npos,
+        "saved SSID should be prefilled and escaped");
+  check(page.body.find("p&amp;ss") == std::string::npos && page.body.find("p&ss") == std::string::npos,
+        "saved password should not appear in the page");
+  check(page.body.find("type=\"password\" id=\"password\" name=\"password\" maxlength=\"64\" value=\"\"")
+        != std::string::npos, "password input should be empty");
+  check(page.body.find("<input type=\"text\" id=\"ssid\" name=\"ssid\" maxlength=\"32\"") != std::string::npos,
+        "SSID input should be generated from the field table");
+  check(page.body.find("%SSID%") == std::string::npos && page.body.find("%ENABLE_") == std::string::npos,
+        "placeholders should be replaced");
+  check(page.body.find("<link rel=\"stylesheet\" href=\"/style.css\">") != std::string::npos,
+        "portal page should link the stylesheet");
+
+  req.uri = "/style.css";
+  HostResponse style = WebServer::hostInstance()->hostRequest(req);
+  check(style.code == 200 && style.contentType == "text/css", "stylesheet should answer 200 text/css");
+  check(style.header("Content-Encoding") == "gzip", "stylesheet should be gzip encoded");
+  check(style.body.size() > 2 && (uint8_t)style.body[0] == 0x1f && (uint8_t)style.body[1] == 0x8b,
+        "stylesheet body should be gzip data");
+
+  req.headers = { { "If-None-Match", style.header("ETag") } };
+  HostResponse cached = WebServer::hostInstance()->hostRequest(req);
+  check(cached.code == 304 && cached.body.empty(), "stylesheet revalidation should answer 304 without a body");
+
+  // 密码不回显：表单提交空密码时沿用已保存的密码
+  HostRequest mqtt = saveRequest("Cafe <\"&'>", "");
+  mqtt.args.push_back({ "enableMQTT", "on" });
+  mqtt.args.push_back({ "mqttPassword", "mq-secret" });
+  WebServer::hostInstance()->hostRequest(mqtt);
+  HostRequest root;
+  root.uri = "/";
+  page = WebServer::hostInstance()->hostRequest(root);
+  check(page.body.find("mq-secret") == std::string::npos, "saved MQTT password should not appear in the page");
+  mqtt.args.back().second = "";
+  WebServer::hostInstance()->hostRequest(mqtt);
+  runUntil(mgr, [] { return false; }, 3 * TICK_MS);  // 保存的配置由下一次loop()应用
+  check(strcmp(mgr.getMQTTPassword(), "mq-secret") == 0, "empty MQTT password should keep the saved one");
+  WebServer::hostInstance()->hostRequest(saveRequest("Cafe <\"&'>", ""));  // 关闭MQTT
+
+  WiFi.hostAddNetwork("Cafe <\"&'>", "p&ss");
+  mgr.setConnectionTimeout(5);
+  WebServer::hostInstance()->hostRequest(saveRequest("Cafe <\"&'>", ""));
+  runUntil(mgr, [&] { return mgr.isConnected(); }, 30000);
+  check(mgr.isConnected() && WiFi.SSID() == "Cafe <\"&'>", "empty password should keep the saved one");
+  WiFi.hostFindNetwork("Cafe <\"&'>")->reachable = false;
+  WiFi.hostFindNetwork("HomeNet")->reachable = true;
+
+  printf("  GET /: %zu bytes in %zu chunks, %.1f us (host)\n", page.body.size(), page.chunks,
+         pageNs / 1000.0);
+  printf("  GET /style.css: %zu bytes gzip, revalidation %d\n", style.body.size(), cached.code);
+}
+
+// 一个已连接的设备上空闲loop()的开销
+static void scenarioIdle() {
+  printf("[idle]\n");
+  hostReset();
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  runUntil(mgr, [&] { return mgr.isConnected(); }, 30000);
+
+  LoopStats stats;
+  runUntil(mgr, [] { return false; }, 10000, &stats);
+  printf("  idle loop(): avg %.1f ns, max %.1f ns over %lu ticks (host)\n", stats.avgNs(),
+         stats.maxNs, stats.ticks);
+}
+
+// 重启后从begin()到管理器确认连接的时间
+static unsigned long bootToConnected(bool fast, bool reuseIP) {
+  hostReset();
+  WiFiConfigManager mgr;
+  mgr.setFastReconnect(fast, reuseIP);
+  mgr.eepromBegin();
+  mgr.begin();
+  unsigned long ttc = runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; },
+                               30000);
+  check(mgr.isConnected(), "should connect after reboot");
+  return ttc;
+}
+
+// 快速重连：使用上次的信道、BSSID（和地址）跳过扫描（和DHCP），接入点变化时回退到完整流程
+static void scenarioFastReconnect() {
+  printf("[fast-reconnect]\n");
+  hostReset();
+  WiFi.hostFindNetwork("HomeNet")->reachable = true;
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    mgr.setWiFiCredentials("HomeNet", "secret123");
+    mgr.begin();
+    runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; }, 30000);
+  }
+
+  unsigned long full = bootToConnected(false, false);
+  unsigned long fast = bootToConnected(true, false);
+  unsigned long fastDhcp = WiFi.hostDhcpLeases();
+  unsigned long fastIP = bootToConnected(true, true);
+  check(fast < full, "cached access point should skip the scan");
+  check(fastIP < fast && WiFi.hostDhcpLeases() == 0, "reused lease should skip DHCP");
+  check(WiFi.localIP() == IPAddress(192, 168, 1, 100), "reused address should match the lease");
+  printf("  boot to connected: full %lu ms, cached AP %lu ms (%lu DHCP), cached AP + lease %lu ms (virtual)\n",
+         full, fast, fastDhcp, fastIP);
+
+  // 路由器换了信道：快速连接很快失败，回退到完整流程，之后的启动使用新信道
+  WiFi.hostFindNetwork("HomeNet")->channel = 11;
+  unsigned long moved = bootToConnected(true, true);
+  check(WiFi.hostBeginCalls() == 2, "stale access point should fall back to one full attempt");
+  unsigned long after = bootToConnected(true, true);
+  check(after == fastIP, "new channel should be cached after the fallback");
+  printf("  access point moved: %lu ms with fallback, next boot %lu ms (virtual)\n", moved, after);
+  WiFi.hostFindNetwork("HomeNet")->channel = 6;
+}
+
+// 多个已知网络：开机扫描一次，按信号和以往成功次数排序，失败时直接换下一个网络
+static void scenarioMultiNetwork() {
+  printf("[multi-network]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  WiFi.hostAddNetwork("Office", "office-pass").reachable = false;
+  WiFi.hostAddNetwork("Lab", "lab-pass").rssi = -50;
+  WiFi.hostAddNetwork("Cafe", "cafe-pass").rssi = -80;
+
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    mgr.setWiFiCredentials("Lab", "lab-pass");
+    mgr.setWiFiCredentials("Cafe", "cafe-pass");
+    mgr.setWiFiCredentials("Office", "office-pass");
+    check(mgr.getNetworkCount() == 3, "three networks should be stored");
+    check(strcmp(mgr.getNetworkSSID(0), "Office") == 0, "latest network should be first");
+  }
+
+  // 重启后只扫描一次，直接连接信号最强的已知网络
+  hostReset();
+  bool apSeen = false;
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    mgr.begin();
+    unsigned long ttc = runUntil(mgr, [&] {
+      apSeen |= WiFi.hostAPUp();
+      return mgr.isConnected();
+    }, 30000);
+    check(mgr.isConnected() && WiFi.SSID() == "Lab", "should connect to the strongest saved network");
+    check(WiFi.hostScans() == 1 && WiFi.hostBeginCalls() == 1, "should scan once and connect once");
+    printf("  best of 3 saved networks: %lu ms, %lu scan, %lu begin (virtual)\n", ttc, WiFi.hostScans(),
+           WiFi.hostBeginCalls());
+  }
+
+  // 首选网络的密码已被修改：直接尝试下一个网络，不进入AP模式
+  WiFi.hostFindNetwork("Lab")->password = "changed";
+  hostReset();
+  {
+    WiFiConfigManager mgr;
+    mgr.setConnectionTimeout(15);
+    mgr.eepromBegin();
+    mgr.begin();
+    unsigned long ttc = runUntil(mgr, [&] {
+      apSeen |= WiFi.hostAPUp();
+      return mgr.isConnected();
+    }, 60000);
+    check(mgr.isConnected() && WiFi.SSID() == "Cafe", "should fall through to the next saved network");
+    printf("  first choice rejected: connected to %s after %lu ms, %lu begin (virtual)\n",
+           WiFi.SSID().c_str(), ttc, WiFi.hostBeginCalls());
+  }
+  check(!apSeen, "portal should not open while another saved network works");
+  WiFi.hostFindNetwork("Lab")->password = "lab-pass";
+}
+
+static int s_connectedCallbacks = 0;
+
+static int s_disconnectedCallbacks = 0;
+static uint8_t s_lastDisconnectReason = 0;
+
+static void countConnected() {
+  s_connectedCallbacks++;
+}
+
+static void countDisconnected(uint8_t reason) {
+  s_disconnectedCallbacks++;
+  s_lastDisconnectReason = reason;
+}
+
+// 事件驱动：链路断开在下一次loop()就被发现，每次连接建立只触发一次回调
+static void scenarioEvents() {
+  printf("[events]\n");
+  hostReset();
+  s_connectedCallbacks = 0;
+  s_disconnectedCallbacks = 0;
+
+  WiFiConfigManager mgr;
+  mgr.setConnectedCallback(countConnected);
+  mgr.setDisconnectedCallback(countDisconnected);
+  mgr.eepromBegin();
+  mgr.begin();
+  runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; }, 30000);
+  runUntil(mgr, [] { return false; }, 1000);
+  check(s_connectedCallbacks == 1, "connected callback should fire once");
+
+  WiFi.hostDropLink();
+  mgr.loop();
+  check(!mgr.isConnected() && mgr.getConnectionState() == WiFiConfigManager::CONN_RETRY,
+        "link loss should be noticed on the next loop()");
+
+  // 管理器按退避策略自行重连，不依赖驱动的自动重连
+  check(!WiFi.getAutoReconnect(), "driver auto-reconnect should be disabled");
+  unsigned long t = runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; },
+                             30000);
+  runUntil(mgr, [] { return false; }, 1000);
+  check(s_connectedCallbacks == 2, "connected callback should fire once per reconnect");
+  check(s_disconnectedCallbacks == 1 && s_lastDisconnectReason == WIFI_REASON_BEACON_TIMEOUT,
+        "disconnected callback should fire once with the reason");
+  printf("  link loss noticed after 1 loop(), reconnected after %lu ms, %d callbacks, %lu WiFi.status() calls\n",
+         t, s_connectedCallbacks, WiFi.hostStatusCalls());
+}
+
+// 路由器长时间离线：重连间隔指数增长并带随机抖动，连续失败达到上限后打开配置AP，
+// 之后按最大间隔在AP+STA模式下继续重连，路由器恢复后连接并关闭配置AP
+static void scenarioBackoff() {
+  printf("[backoff]\n");
+  hostReset();
+  randomSeed(1);
+
+  WiFiConfigManager mgr;
+  mgr.setConnectionTimeout(5);
+  mgr.setReconnectPolicy(1000, 8000, 6);
+  mgr.eepromBegin();
+  mgr.begin();
+  runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; }, 30000);
+
+  WiFi.hostFindNetwork("HomeNet")->reachable = false;
+  WiFi.hostDropLink();
+
+  // 记录每次发起连接的时间
+  std::vector<unsigned long> attempts;
+  unsigned long begins = WiFi.hostBeginCalls();
+  unsigned long scans = WiFi.hostScans();
+  unsigned long start = hostNowMs();
+  unsigned long t = runUntil(mgr, [&] {
+    if (WiFi.hostBeginCalls() + WiFi.hostScans() != begins + scans) {
+      if (mgr.getConnectionState() != WiFiConfigManager::CONN_RETRY) {
+        attempts.push_back(hostNowMs() - start);
+      }
+      begins = WiFi.hostBeginCalls();
+      scans = WiFi.hostScans();
+    }
+    return WiFi.hostAPUp();
+  }, 600000);
+  check(WiFi.hostAPUp(), "portal should open after the configured number of failures");
+  printf("  outage: portal opened after %lu ms, reconnect starts at", t);
+  for (size_t i = 0; i < attempts.size(); i++) {
+    printf(" %lu", attempts[i]);
+  }
+  printf(" ms (virtual)\n");
+  check(mgr.getConnectionState() == WiFiConfigManager::CONN_RETRY && WiFi.getMode() == WIFI_AP,
+        "reconnect should continue with the portal open, STA idle between attempts");
+
+  // 下一次重连在最大间隔的一半到全部之间发起，AP保持运行
+  unsigned long opened = hostNowMs();
+  unsigned long wait = runUntil(mgr, [&] {
+    return mgr.getConnectionState() != WiFiConfigManager::CONN_RETRY;
+  }, 20000);
+  check(wait >= 4000 - TICK_MS && wait <= 8000 + TICK_MS, "retries with the portal open should use the max interval");
+  check(WiFi.getMode() == WIFI_AP_STA && WiFi.hostAPUp(), "retry should run in AP+STA mode");
+
+  WiFi.hostFindNetwork("HomeNet")->reachable = true;
+  bool apDropped = false;
+  runUntil(mgr, [&] {
+    apDropped |= !WiFi.hostAPUp();
+    return mgr.isConnected();
+  }, 60000);
+  unsigned long reconnected = hostNowMs() - opened;
+  check(mgr.isConnected() && !apDropped, "retry should succeed once the router is back, portal kept meanwhile");
+  runUntil(mgr, [&] { return !WiFi.hostAPUp(); }, 60000);
+  check(!WiFi.hostAPUp() && mgr.isConnected(), "portal should close after the reconnect succeeds");
+  printf("  router back: reconnected %lu ms after the portal opened, portal closed\n", reconnected);
+}
+
+static HostRequest statusRequest() {
+  HostRequest req;
+  req.uri = "/status";
+  return req;
+}
+
+// 在配置页面中输错密码再改正：AP+STA模式下尝试连接，AP和手机的连接始终保持，路由只注册一次
+static void scenarioPortalRetry() {
+  printf("[portal-retry]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  WebServer* server = WebServer::hostInstance();
+  size_t routes = server->hostRouteCount();
+  WiFi.hostStationJoin();
+  check(mgr.getPortalClientCount() == 1, "phone should be associated with the portal");
+
+  unsigned long apSwitches = WiFi.hostModeSwitches();
+  bool apDropped = false;
+  server->hostQueue(saveRequest("HomeNet", "wrong-password"));
+  runUntil(mgr, [] { return false; }, 3 * TICK_MS);
+  check(WiFi.getMode() == WIFI_AP_STA, "attempt should run in AP+STA mode");
+  runUntil(mgr, [&] {
+    apDropped |= !WiFi.hostAPUp();
+    return mgr.getConnectionState() == WiFiConfigManager::CONN_IDLE && WiFi.getMode() == WIFI_AP;
+  }, 60000);
+  const HostResponse& failed = server->hostRequest(statusRequest());
+  check(failed.body.find("\"state\":\"idle\"") != std::string::npos && failed.body.find("\"ap\":true") != std::string::npos,
+        "status should report the failed attempt");
+
+  server->hostQueue(saveRequest("HomeNet", "secret123"));
+  runUntil(mgr, [] { return false; }, 3 * TICK_MS);
+  unsigned long t = runUntil(mgr, [&] {
+    apDropped |= !WiFi.hostAPUp();
+    return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED;
+  }, 60000);
+  const HostResponse& connected = server->hostRequest(statusRequest());
+  check(connected.body.find("\"state\":\"connected\"") != std::string::npos, "status should report the connection");
+  check(!apDropped && mgr.getPortalClientCount() == 1, "phone should stay associated during both attempts");
+  check(server->hostRouteCount() == routes, "routes should be registered once");
+
+  unsigned long grace = runUntil(mgr, [&] { return !WiFi.hostAPUp(); }, 60000);
+  check(!WiFi.hostAPUp() && mgr.isConnected(), "portal should close after the grace period, link kept");
+  printf("  wrong then right password: connected after %lu ms, portal closed %lu ms later, %lu mode switches,"
+         " %zu routes\n", t, grace, WiFi.hostModeSwitches() - apSwitches, server->hostRouteCount());
+  printf("  /status: %s\n", connected.body.c_str());
+}
+
+// 连续提交配置：处理函数不写Flash、不等待，提交之间的DNS/HTTP请求在下一次loop()就得到处理
+static void scenarioSaveBurst() {
+  printf("[save-burst]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  WiFi.hostFindNetwork("HomeNet")->reachable = false;  // 一直停留在配置模式
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  WebServer* server = WebServer::hostInstance();
+
+  const int rounds = 20;
+  unsigned long maxBlockedMs = 0;
+  unsigned long maxStatusDelayMs = 0;
+  double maxHandlerNs = 0;
+  for (int i = 0; i < rounds; i++) {
+    char broker[16];
+    snprintf(broker, sizeof(broker), "broker-%d", i);
+    HostRequest req = saveRequest("HomeNet", "secret123");
+    req.args.push_back({ "enableMQTT", "on" });
+    req.args.push_back({ "mqttServer", broker });
+    server->hostQueue(req);
+    server->hostQueue(statusRequest());
+
+    // 第一次loop()处理保存请求，第二次处理紧随其后的状态查询
+    unsigned long queued = hostNowMs();
+    for (int tick = 0; tick < 2; tick++) {
+      unsigned long t0 = hostNowMs();
+      double n0 = nowNs();
+      mgr.loop();
+      double ns = nowNs() - n0;
+      if (tick == 0 && ns > maxHandlerNs) maxHandlerNs = ns;
+      if (hostNowMs() - t0 > maxBlockedMs) maxBlockedMs = hostNowMs() - t0;
+      hostAdvance(TICK_MS);
+    }
+    check(server->hostLastResponse().code == 200, "status should answer between submits");
+    if (hostNowMs() - queued > maxStatusDelayMs) maxStatusDelayMs = hostNowMs() - queued;
+    runUntil(mgr, [] { return false; }, 500);
+  }
+  check(maxBlockedMs == 0, "save should not block loop()");
+  check(strcmp(mgr.getMQTTServer(), "broker-19") == 0, "last submit should win");
+
+  HostFlashStats flash = hostPartitionStats("wcfg");
+  printf("  %d submits: save loop() max %.1f us (host), max %lu ms blocked, status answered within %lu ms (virtual)\n",
+         rounds, maxHandlerNs / 1000.0, maxBlockedMs, maxStatusDelayMs);
+  printf("  journal: %lu bytes programmed\n", flash.bytesProgrammed);
+  WiFi.hostFindNetwork("HomeNet")->reachable = true;
+}
+
+// Flash写入失败：配置保持待写入状态，/status报告错误，按间隔重试直到写入成功
+static void scenarioSaveFailure() {
+  printf("[save-failure]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  WiFi.hostFindNetwork("HomeNet")->reachable = false;  // 一直停留在配置模式
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  WebServer* server = WebServer::hostInstance();
+
+  hostPartitionFailWrites("wcfg", true);
+  HostRequest req = saveRequest("HomeNet", "secret123");
+  req.args.push_back({ "enableMQTT", "on" });
+  req.args.push_back({ "mqttServer", "flaky.lan" });
+  server->hostQueue(req);
+  runUntil(mgr, [] { return false; }, 3 * TICK_MS);
+  check(server->hostRequest(statusRequest()).body.find("\"saveError\":true") != std::string::npos,
+        "status should report the failed save");
+
+  // 重试不会在每次loop()中反复擦写Flash
+  runUntil(mgr, [] { return false; }, 1000);
+  check(server->hostRequest(statusRequest()).body.find("\"saveError\":true") != std::string::npos,
+        "save should stay pending while the flash fails");
+
+  hostPartitionFailWrites("wcfg", false);
+  unsigned long t = runUntil(mgr, [&] {
+    return server->hostRequest(statusRequest()).body.find("\"saveError\":false") != std::string::npos;
+  }, 30000);
+  check(hostPartitionStats("wcfg").bytesProgrammed > 0, "retry should write the configuration");
+
+  hostReset();
+  WiFiConfigManager again;
+  again.eepromBegin();
+  check(strcmp(again.getMQTTServer(), "flaky.lan") == 0,
+        "retried save should survive a reboot");
+  printf("  flash back: saved %lu ms later\n", t);
+  WiFi.hostFindNetwork("HomeNet")->reachable = true;
+}
+
+// 主循环忙于其他工作（每次loop()之间50ms）时，另一个线程中的"手机"依次请求/status，返回平均和最大延迟（真实时间，毫秒）
+static void measurePortalLatency(bool portalTask, double& avgMs, double& maxMs) {
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+
+  WiFiConfigManager mgr;
+  if (portalTask) mgr.setPortalTask(true, 0, 2, 8192);
+  mgr.eepromBegin();
+  mgr.begin();
+  if (portalTask) {
+    HostTaskInfo task = hostLastTask();
+    check(hostTaskCount() == 1 && task.core == 0 && task.priority == 2 && task.stackDepth == 8192,
+          "portal task should be created with the requested parameters");
+  }
+  WebServer* server = WebServer::hostInstance();
+
+  const int requests = 20;
+  std::atomic<bool> done(false);
+  double total = 0;
+  maxMs = 0;
+  std::thread phone([&] {
+    for (int i = 0; i < requests; i++) {
+      unsigned long handled = server->hostHandled();
+      double t0 = nowNs();
+      server->hostQueue(statusRequest());
+      while (server->hostHandled() == handled) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+      }
+      double ms = (nowNs() - t0) / 1e6;
+      total += ms;
+      if (ms > maxMs) maxMs = ms;
+      // 错开请求与主循环的节奏
+      std::this_thread::sleep_for(std::chrono::milliseconds(7 + i % 5));
+    }
+    done = true;
+  });
+  while (!done) {
+    mgr.loop();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));  // 传感器采集等其他工作
+  }
+  phone.join();
+  avgMs = total / requests;
+}
+
+// 门户任务：DNS和HTTP在独立任务中处理，页面延迟不再取决于主循环
+static void scenarioPortalTask() {
+  printf("[portal-task]\n");
+  double loopAvg, loopMax, taskAvg, taskMax;
+  measurePortalLatency(false, loopAvg, loopMax);
+  measurePortalLatency(true, taskAvg, taskMax);
+  check(hostTaskCount() == 0, "portal task should exit with the manager");
+  check(taskMax < loopAvg, "portal task should answer faster than a busy loop()");
+
+  // 门户任务读取缓慢客户端的请求时不持有锁，loop()和publish()不受影响
+  double stallMs;
+  {
+    hostReset();
+    WiFiConfigManager mgr;
+    mgr.setPortalTask(true);
+    mgr.eepromBegin();
+    mgr.begin();
+    WebServer* server = WebServer::hostInstance();
+    HostRequest slow = statusRequest();
+    slow.readDelayMs = 300;
+    unsigned long handled = server->hostHandled();
+    server->hostQueue(slow);
+    while (server->hostPending() > 0) {
+      std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+    double t0 = nowNs();
+    mgr.loop();
+    mgr.publish("sensor/t", "21.5");
+    stallMs = (nowNs() - t0) / 1e6;
+    while (server->hostHandled() == handled) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+  }
+  check(stallMs < 100, "a slow HTTP client should not block loop()");
+  printf("  /status latency with 50 ms between loop() calls: from loop() avg %.1f ms, max %.1f ms;"
+         " from portal task avg %.1f ms, max %.1f ms (host)\n", loopAvg, loopMax, taskAvg, taskMax);
+  printf("  loop() + publish() while the portal task reads a 300 ms request: %.2f ms (host)\n", stallMs);
+}
+
+static std::vector<uint8_t> dnsQuery(uint16_t id, const char* name, uint16_t qtype) {
+  std::vector<uint8_t> q = { (uint8_t)(id >> 8), (uint8_t)id, 0x01, 0x00, 0, 1, 0, 0, 0, 0, 0, 0 };
+  const char* label = name;
+  while (*label) {
+    const char* dot = strchr(label, '.');
+    size_t len = dot ? (size_t)(dot - label) : strlen(label);
+    q.push_back((uint8_t)len);
+    q.insert(q.end(), label, label + len);
+    label += len + (dot ? 1 : 0);
+  }
+  q.push_back(0);
+  q.push_back((uint8_t)(qtype >> 8));
+  q.push_back((uint8_t)qtype);
+  q.push_back(0);
+  q.push_back(1);
+  return q;
+}
+
+// 手机连上AP后的一批联网检测查询：同一次loop()内全部回复，回复指向AP地址
+static void scenarioCaptiveDNS() {
+  printf("[captive-dns]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  WiFiUDP* dns = WiFiUDP::hostFind(53);
+  check(dns != nullptr, "DNS responder should listen on port 53");
+  if (!dns) return;
+
+  struct Query {
+    const char* name;
+    uint16_t qtype;
+  };
+  static const Query burst[] = {
+    { "connectivitycheck.gstatic.com", 1 }, { "www.google.com", 1 }, { "clients3.google.com", 1 },
+    { "connectivitycheck.gstatic.com", 28 }, { "captive.apple.com", 1 }, { "www.apple.com", 1 },
+    { "www.msftconnecttest.com", 1 }, { "www.msftncsi.com", 1 }, { "mtalk.google.com", 1 },
+    { "time.android.com", 1 }, { "Example.COM", 1 }, { "example.com", 28 },
+  };
+  const size_t count = sizeof(burst) / sizeof(burst[0]);
+  IPAddress phone(192, 168, 4, 2);
+  unsigned long injectedUs = micros();
+  for (size_t i = 0; i < count; i++) {
+    std::vector<uint8_t> q = dnsQuery((uint16_t)(0x1000 + i), burst[i].name, burst[i].qtype);
+    dns->hostInject(phone, (uint16_t)(50000 + i), q.data(), q.size());
+  }
+
+  int ticks = 0;
+  double t0 = nowNs();
+  while (dns->hostSent().size() < count && ticks < 100) {
+    mgr.loop();
+    hostAdvance(TICK_MS);
+    ticks++;
+  }
+  double hostUs = (nowNs() - t0) / 1000.0;
+  check(dns->hostSent().size() == count && ticks == 1, "whole burst should be answered in one loop()");
+
+  // 检查回复：ID对应，A记录指向AP地址，探测域名TTL为0，AAAA没有记录
+  bool ok = true;
+  unsigned long maxLatencyUs = 0;
+  for (size_t i = 0; i < dns->hostSent().size() && i < count; i++) {
+    const HostPacket& a = dns->hostSent()[i];
+    const std::vector<uint8_t>& d = a.data;
+    uint16_t ancount = (uint16_t)((d[6] << 8) | d[7]);
+    ok &= a.port == 50000 + i && a.ip == phone && d.size() >= 12;
+    ok &= ((d[0] << 8) | d[1]) == (int)(0x1000 + i) && (d[2] & 0x80) && (d[3] & 0x0f) == 0;
+    if (burst[i].qtype == 1) {
+      const uint8_t* rr = d.data() + d.size() - 16;
+      uint32_t ttl = ((uint32_t)rr[6] << 24) | ((uint32_t)rr[7] << 16) | (rr[8] << 8) | rr[9];
+      bool probe = WiFiConfigDNS::isProbeHost(burst[i].name);
+      ok &= ancount == 1 && rr[12] == 192 && rr[13] == 168 && rr[14] == 4 && rr[15] == 1;
+      ok &= probe ? ttl == 0 : ttl > 0;
+    } else {
+      ok &= ancount == 0;
+    }
+    if (a.atUs - injectedUs > maxLatencyUs) maxLatencyUs = a.atUs - injectedUs;
+  }
+  check(ok, "answers should match the queries and resolve to the AP");
+
+  // 格式错误的报文被丢弃，不影响后续查询
+  const uint8_t garbage[] = { 0x12, 0x34, 0x81, 0x80, 0, 1 };
+  dns->hostInject(phone, 40000, garbage, sizeof(garbage));
+  mgr.loop();
+
+  const WiFiConfigDNSStats& stats = mgr.getDNSStats();
+  check(stats.dropped == 1 && stats.answered == count && stats.probes == 8, "DNS counters should add up");
+  printf("  %zu queries answered in %d loop() (one per loop() before: %zu loops, %lu ms), "
+         "last answer %lu us after arrival (virtual), batch %.1f us (host)\n",
+         count, ticks, count, (unsigned long)(count * TICK_MS), maxLatencyUs, hostUs);
+  printf("  stats: %u queries, %u answered, %u probes, %u dropped, max batch %u\n", stats.queries,
+         stats.answered, stats.probes, stats.dropped, stats.maxBatch);
+}
+
+// UDP发现广播：连接后立即广播一次，之后按设定间隔（±10%）广播，重连时不会连续发送
+static void scenarioAnnounce() {
+  printf("[announce]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  randomSeed(7);
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  HostRequest req = saveRequest("HomeNet", "secret123");
+  req.args.push_back({ "enableUDP", "on" });
+  req.args.push_back({ "deviceName", "kitchen-sensor" });
+  req.args.push_back({ "udpPort", "4210" });
+  WebServer::hostInstance()->hostQueue(req);
+  std::vector<HostPacket>& wire = WiFiUDP::hostWire();
+  wire.clear();
+  runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; }, 30000);
+  unsigned long connectedAt = hostNowMs();
+  LoopStats stats;
+  runUntil(mgr, [] { return false; }, 60000, &stats);
+
+  // 只统计发往广播端口的报文
+  std::vector<HostPacket> sent;
+  for (auto& p : wire) {
+    if (p.port == 4210) sent.push_back(p);
+  }
+  check(sent.size() >= 6 && sent.size() <= 8, "should announce about every 10 s");
+  // 进入已连接状态的那次loop()中立即发送第一次广播
+  bool ok = !sent.empty() && connectedAt - sent[0].atUs / 1000 <= TICK_MS;
+  unsigned long minGap = ~0UL, maxGap = 0;
+  for (size_t i = 0; i < sent.size(); i++) {
+    WiFiConfigAnnounce a;
+    ok &= sent[i].data.size() == sizeof(a) && sent[i].ip == IPAddress(192, 168, 1, 255);
+    if (sent[i].data.size() != sizeof(a)) break;
+    memcpy(&a, sent[i].data.data(), sizeof(a));
+    ok &= a.magic == WIFI_CONFIG_ANNOUNCE_MAGIC && a.version == WIFI_CONFIG_ANNOUNCE_VERSION;
+    ok &= strncmp(a.name, "kitchen-sensor", sizeof(a.name)) == 0 && a.ip == (uint32_t)IPAddress(192, 168, 1, 100);
+    ok &= a.mac[0] == 0x24 && a.sequence == i + 1;
+    if (i > 0) {
+      unsigned long gap = (sent[i].atUs - sent[i - 1].atUs) / 1000;
+      minGap = std::min(minGap, gap);
+      maxGap = std::max(maxGap, gap);
+    }
+  }
+  check(ok, "announce packets should carry name, address, MAC and sequence");
+  check(minGap >= 9000 && maxGap <= 11000 + TICK_MS, "interval should stay within +-10%");
+
+  // 链路反复断开重连：两次广播之间仍至少间隔1秒
+  wire.clear();
+  for (int i = 0; i < 3; i++) {
+    WiFi.hostDropLink();
+    mgr.loop();
+    runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; }, 30000);
+  }
+  runUntil(mgr, [] { return false; }, 2000);
+  unsigned long flapGap = ~0UL;
+  for (size_t i = 1; i < wire.size(); i++) {
+    flapGap = std::min(flapGap, (wire[i].atUs - wire[i - 1].atUs) / 1000);
+  }
+  check(flapGap >= WiFiConfigAnnouncer::MIN_INTERVAL, "reconnects should not flood announcements");
+
+  printf("  %zu announcements in 60 s, first within %lu ms of connect, gaps %lu-%lu ms (virtual), %zu bytes each\n",
+         sent.size(), sent.empty() ? 0 : connectedAt - sent[0].atUs / 1000, minGap, maxGap,
+         sizeof(WiFiConfigAnnounce));
+  printf("  loop() while announcing: avg %.1f ns, max %.1f ns (host); %zu sent during 3 reconnects, min gap %lu ms\n",
+         stats.avgNs(), stats.maxNs, wire.size(), flapGap);
+}
+
+// 本机上的最小MQTT服务器：接受连接，回复CONNACK和PINGRESP，按顺序记录收到的PUBLISH内容
+class FakeBroker {
+public:
+  FakeBroker() {
+    _listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    bind(_listener, (struct sockaddr*)&addr, sizeof(addr));
+    socklen_t length = sizeof(addr);
+    getsockname(_listener, (struct sockaddr*)&addr, &length);
+    port = ntohs(addr.sin_port);
+    listen(_listener, 4);
+    _thread = std::thread([this] { run(); });
+  }
+  ~FakeBroker() {
+    _stop = true;
+    _thread.join();
+    close(_listener);
+  }
+
+  size_t received() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _payloads.size();
+  }
+  std::vector<std::string> payloads() {
+    std::lock_guard<std::mutex> guard(_mutex);
+    return _payloads;
+  }
+
+  uint16_t port = 0;
+  std::atomic<int> connects{ 0 };
+
+private:
+  // 等待可读，超时返回false以便检查_stop
+  bool waitReadable(int fd) {
+    fd_set readable;
+    FD_ZERO(&readable);
+    FD_SET(fd, &readable);
+    struct timeval timeout = { 0, 20000 };
+    return select(fd + 1, &readable, nullptr, nullptr, &timeout) > 0;
+  }
+
+  void run() {
+    while (!_stop) {
+      if (!waitReadable(_listener)) continue;
+      int fd = accept(_listener, nullptr, nullptr);
+      if (fd < 0) continue;
+      serve(fd);
+      close(fd);
+    }
+  }
+
+  void serve(int fd) {
+    std::vector<uint8_t> in;
+    uint8_t buffer[1024];
+    while (!_stop) {
+      if (!waitReadable(fd)) continue;
+      ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+      if (n <= 0) return;
+      in.insert(in.end(), buffer, buffer + n);
+
+      // 取出所有完整的报文
+      for (;;) {
+        size_t remaining = 0, multiplier = 1, pos = 1;
+        bool complete = false;
+        while (pos < in.size() && pos < 5) {
+          remaining += (in[pos] & 0x7f) * multiplier;
+          multiplier *= 128;
+          if ((in[pos++] & 0x80) == 0) {
+            complete = true;
+            break;
+          }
+        }
+        if (!complete || in.size() < pos + remaining) break;
+
+        uint8_t type = in[0] & 0xf0;
+        if (type == 0x10) {
+          const uint8_t connack[4] = { 0x20, 0x02, 0x00, 0x00 };
+          send(fd, connack, sizeof(connack), MSG_NOSIGNAL);
+          connects++;
+        } else if (type == 0x30) {
+          size_t topicLength = (in[pos] << 8) | in[pos + 1];
+          size_t start = pos + 2 + topicLength;
+          std::lock_guard<std::mutex> guard(_mutex);
+          _payloads.emplace_back((const char*)in.data() + start, pos + remaining - start);
+        } else if (type == 0xc0) {
+          const uint8_t pingresp[2] = { 0xd0, 0x00 };
+          send(fd, pingresp, sizeof(pingresp), MSG_NOSIGNAL);
+        }
+        in.erase(in.begin(), in.begin() + pos + remaining);
+      }
+    }
+  }
+
+  int _listener;
+  std::atomic<bool> _stop{ false };
+  std::thread _thread;
+  std::mutex _mutex;
+  std::vector<std::string> _payloads;
+};
+
+// MQTT客户端经过真实的本机TCP连接：虚拟时钟推进状态机，连接建立期间稍作等待让服务器线程回复
+static void pumpMQTT(WiFiConfigManager& mgr, std::function<bool()> done, unsigned long limitMs) {
+  unsigned long start = hostNowMs();
+  while (!done() && hostNowMs() - start < limitMs) {
+    mgr.loop();
+    hostAdvance(TICK_MS);
+    if (mgr.getMQTT().state() != WiFiConfigMQTT::MQTT_WAITING) {
+      std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+  }
+}
+
+// 断开链路并保持不可达，期间发布的消息进入队列
+static void mqttOutage(WiFiConfigManager& mgr, bool down) {
+  WiFi.hostFindNetwork("HomeNet")->reachable = !down;
+  if (down) {
+    WiFi.hostDropLink();
+    mgr.loop();
+  }
+}
+
+static std::string reading(int i) {
+  char payload[32];
+  snprintf(payload, sizeof(payload), "{\"t\":%d,\"v\":21.5}", i);
+  return payload;
+}
+
+// MQTT：断网期间发布的消息排队，恢复后按顺序批量发出；队列满时按策略丢弃
+static void scenarioMQTT() {
+  printf("[mqtt]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  FakeBroker broker;
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  char port[8];
+  snprintf(port, sizeof(port), "%u", broker.port);
+  HostRequest req = saveRequest("HomeNet", "secret123");
+  req.args.push_back({ "enableMQTT", "on" });
+  req.args.push_back({ "mqttServer", "127.0.0.1" });
+  req.args.push_back({ "mqttPort", port });
+  WebServer::hostInstance()->hostQueue(req);
+  pumpMQTT(mgr, [&] { return mgr.getMQTT().connected(); }, 30000);
+  check(mgr.getMQTT().connected(), "should connect to the broker after provisioning");
+
+  int next = 0;
+  for (; next < 10; next++) {
+    mgr.publish("sensors/kitchen", reading(next).c_str());
+  }
+  pumpMQTT(mgr, [&] { return broker.received() >= 10; }, 5000);
+  check(broker.received() == 10, "readings should be delivered while connected");
+
+  // 断网5秒，期间的读数排队
+  mqttOutage(mgr, true);
+  for (; next < 50; next++) {
+    mgr.publish("sensors/kitchen", reading(next).c_str());
+  }
+  runUntil(mgr, [] { return false; }, 5000);
+  check(!mgr.getMQTT().connected() && mgr.getMQTT().queuedMessages() == 40, "readings should queue during an outage");
+  uint32_t batchesBefore = mgr.getMQTT().stats().batches;
+  mqttOutage(mgr, false);
+  unsigned long recoverMs = hostNowMs();
+  pumpMQTT(mgr, [&] { return broker.received() >= 50; }, 120000);
+  recoverMs = hostNowMs() - recoverMs;
+  uint32_t flushBatches = mgr.getMQTT().stats().batches - batchesBefore;
+  std::vector<std::string> got = broker.payloads();
+  bool ordered = got.size() == 50;
+  for (size_t i = 0; ordered && i < got.size(); i++) {
+    ordered = got[i] == reading(i);
+  }
+  check(ordered, "queued readings should arrive once, in order");
+  check(flushBatches <= 2, "queued readings should be flushed in a batch");
+
+  // 队列满：默认丢弃最早的消息，保留最新的读数
+  mqttOutage(mgr, true);
+  int accepted = 0;
+  int first = next;
+  for (int i = 0; i < 100; i++, next++) {
+    accepted += mgr.publish("sensors/kitchen", reading(next).c_str());
+  }
+  check(accepted == 100 && mgr.getMQTT().queuedMessages() == WIFI_CONFIG_MQTT_MAX_MESSAGES,
+        "drop-oldest should accept new readings and keep the queue bounded");
+  mqttOutage(mgr, false);
+  pumpMQTT(mgr, [&] { return broker.received() >= 50 + WIFI_CONFIG_MQTT_MAX_MESSAGES; }, 120000);
+  got = broker.payloads();
+  bool newest = got.size() == 50 + WIFI_CONFIG_MQTT_MAX_MESSAGES
+                && got[50] == reading(first + 100 - WIFI_CONFIG_MQTT_MAX_MESSAGES) && got.back() == reading(next - 1);
+  check(newest, "drop-oldest should deliver the newest readings");
+
+  // 拒绝新消息：队列中保留最早的读数，publish()返回false
+  mgr.setMQTTQueuePolicy(MQTT_REJECT_NEW);
+  mqttOutage(mgr, true);
+  accepted = 0;
+  first = next;
+  for (int i = 0; i < 100; i++, next++) {
+    accepted += mgr.publish("sensors/kitchen", reading(next).c_str());
+  }
+  check(accepted == WIFI_CONFIG_MQTT_MAX_MESSAGES, "reject-new should refuse readings once the queue is full");
+  mqttOutage(mgr, false);
+  size_t expected = 50 + 2 * WIFI_CONFIG_MQTT_MAX_MESSAGES;
+  pumpMQTT(mgr, [&] { return broker.received() >= expected; }, 120000);
+  got = broker.payloads();
+  bool oldest = got.size() == expected && got[expected - WIFI_CONFIG_MQTT_MAX_MESSAGES] == reading(first)
+                && got.back() == reading(first + WIFI_CONFIG_MQTT_MAX_MESSAGES - 1);
+  check(oldest, "reject-new should deliver the oldest readings");
+
+  // 连接空闲时保持心跳，服务器不会因超时断开
+  int connectsBefore = broker.connects;
+  pumpMQTT(mgr, [] { return false; }, 120000);
+  check(mgr.getMQTT().connected() && broker.connects == connectsBefore, "keepalive should hold an idle connection");
+
+  const WiFiConfigMQTT::Stats& stats = mgr.getMQTT().stats();
+  printf("  40 queued readings flushed in %u send() call%s, %lu ms after the network returned (virtual)\n",
+         flushBatches, flushBatches == 1 ? "" : "s", recoverMs);
+  printf("  stats: %u queued, %u sent, %u dropped, %u batches, %u connects, %d broker sessions\n", stats.queued,
+         stats.sent, stats.dropped, stats.batches, stats.connects, broker.connects.load());
+}
+
+// MQTT服务器为域名：解析在后台进行，等待DNS回复期间loop()照常返回；结果被缓存，重连时不再等待
+static void scenarioMQTTResolve() {
+  printf("[mqtt-dns]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  FakeBroker broker;
+  hostDnsAdd("broker.lan", htonl(INADDR_LOOPBACK), 800);
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  char port[8];
+  snprintf(port, sizeof(port), "%u", broker.port);
+  HostRequest req = saveRequest("HomeNet", "secret123");
+  req.args.push_back({ "enableMQTT", "on" });
+  req.args.push_back({ "mqttServer", "broker.lan" });
+  req.args.push_back({ "mqttPort", port });
+  WebServer::hostInstance()->hostQueue(req);
+
+  // 统计解析期间的loop()调用
+  unsigned long resolvingLoops = 0;
+  auto countResolving = [&] {
+    if (mgr.getMQTT().state() == WiFiConfigMQTT::MQTT_RESOLVING) resolvingLoops++;
+    return mgr.getMQTT().connected();
+  };
+  pumpMQTT(mgr, countResolving, 30000);
+  check(mgr.getMQTT().connected(), "should connect to a broker given by hostname");
+  check(resolvingLoops * TICK_MS >= 800 && resolvingLoops * TICK_MS <= 800 + 2 * TICK_MS,
+        "loop() should keep running while the lookup is pending");
+  unsigned long firstLoops = resolvingLoops;
+
+  // 断网后重连：名字已在缓存中，直接连接
+  mqttOutage(mgr, true);
+  runUntil(mgr, [] { return false; }, 2000);
+  mqttOutage(mgr, false);
+  resolvingLoops = 0;
+  pumpMQTT(mgr, countResolving, 60000);
+  check(mgr.getMQTT().connected() && resolvingLoops <= 1, "a cached name should not wait for DNS again");
+
+  // 查询进行中更换服务器：旧名字的结果在连接关闭后才到达，被忽略，最终连接到新的服务器
+  // old.lan指向127.0.0.2，那里没有服务器，误用旧结果会被拒绝连接
+  hostDnsAdd("old.lan", htonl(INADDR_LOOPBACK + 1), 1500);
+  req.args.back() = { "mqttPort", port };
+  req.args[req.args.size() - 2] = { "mqttServer", "old.lan" };
+  WebServer::hostInstance()->hostQueue(req);
+  pumpMQTT(mgr, [&] { return mgr.getMQTT().state() == WiFiConfigMQTT::MQTT_RESOLVING; }, 5000);
+  req.args[req.args.size() - 2] = { "mqttServer", "broker.lan" };
+  WebServer::hostInstance()->hostQueue(req);
+  uint32_t failures = mgr.getMQTT().stats().failures;
+  pumpMQTT(mgr, [&] { return mgr.getMQTT().connected(); }, 30000);
+  check(mgr.getMQTT().connected() && strcmp(mgr.getMQTTServer(), "broker.lan") == 0
+        && mgr.getMQTT().stats().failures - failures <= 2, "a lookup for the old server should be ignored");
+  check(hostLwipUnlockedCalls() == 0, "lookups should run in the TCP/IP task");
+  printf("  broker.lan resolved in the background over %lu loop() calls (%lu ms virtual), reconnect from cache\n",
+         firstLoops, firstLoops * TICK_MS);
+}
+
+// 运行时指标：连接各阶段耗时、重连和Flash写入统计，/metrics以Prometheus文本格式返回
+static void scenarioMetrics() {
+  printf("[metrics]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+
+  // 首次配置：只有一个网络，不扫描，WiFi.begin()中包括驱动的全信道扫描
+  uint32_t provisionAuthMs = 0;
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    mgr.begin();
+    WebServer::hostInstance()->hostQueue(saveRequest("HomeNet", "secret123"));
+    runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; }, 30000);
+    WiFiConfigMetrics m = mgr.getMetrics();
+    provisionAuthMs = m.lastAuthMs;
+    check(m.lastScanMs == 0 && m.lastAuthMs >= 2200 && m.lastAuthMs <= 2200 + TICK_MS
+          && m.lastDhcpMs >= 700 && m.lastDhcpMs <= 700 + TICK_MS,
+          "provisioning phases should split into driver scan + auth and DHCP");
+    check(m.http.count == 1 && m.connects == 1, "save handler and connection should be counted");
+    check(m.flashCommits >= 1 && m.flashBytes == m.flashCommits * sizeof(WiFiConfigRecord),
+          "journal writes should be counted");
+  }
+
+  // 重启：使用缓存的接入点，/metrics在连接成功后从局域网提供
+  WiFiConfigManager mgr;
+  mgr.setMetricsEndpoint(true);
+  mgr.setFirmwareUpdate(true);
+  mgr.eepromBegin();
+  mgr.begin();
+  check(WebServer::hostInstance()->hostRouteCount() == 0, "web server should not start before connecting");
+  runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; }, 30000);
+  check(WebServer::hostInstance()->hostRouteCount() > 0, "metrics endpoint should be served on the LAN");
+  HostRequest upload;
+  upload.method = HTTP_POST;
+  upload.uri = "/update";
+  upload.uploadName = "sketch.ino.bin";
+  upload.upload = std::string(4096, '\xE9');
+  check(WebServer::hostInstance()->hostRequest(upload).code == 403
+        && mgr.getOTA().state() == WiFiConfigOTA::OTA_IDLE, "/update should be refused outside the portal");
+  // 局域网上只提供/metrics：配置页面和修改配置的接口不能访问
+  HostRequest lan;
+  lan.uri = "/";
+  bool refused = WebServer::hostInstance()->hostRequest(lan).code == 403;
+  lan.uri = "/api/config";
+  refused = refused && WebServer::hostInstance()->hostRequest(lan).code == 403;
+  lan.method = HTTP_PUT;
+  lan.body = "{\"ssid\":\"Evil\",\"password\":\"x\"}";
+  refused = refused && WebServer::hostInstance()->hostRequest(lan).code == 403;
+  HostRequest lanSave = saveRequest("Evil", "x");
+  refused = refused && WebServer::hostInstance()->hostRequest(lanSave).code == 403;
+  runUntil(mgr, [] { return false; }, 3 * TICK_MS);
+  check(refused && mgr.getNetworkCount() == 1 && strcmp(mgr.getNetworkSSID(0), "Evil") != 0,
+        "portal routes should be refused on the LAN");
+  WiFiConfigMetrics boot = mgr.getMetrics();
+  check(boot.lastScanMs == 0 && boot.lastAuthMs <= 400 + TICK_MS && boot.lastDhcpMs >= 700
+        && boot.lastDhcpMs <= 700 + TICK_MS, "cached access point should skip the scan");
+
+  WiFi.hostDropLink();
+  mgr.loop();
+  runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; }, 30000);
+  runUntil(mgr, [] { return false; }, 1000);
+
+  HostRequest req;
+  req.uri = "/metrics";
+  HostResponse res = WebServer::hostInstance()->hostRequest(req);
+  WiFiConfigMetrics m = mgr.getMetrics();
+  check(res.code == 200 && res.contentType.startsWith("text/plain"), "/metrics should answer 200 text/plain");
+  check(m.connects == 2 && m.linkLosses == 1 && m.rssi < 0 && m.freeHeap > 0, "reconnect should be counted");
+  check(m.flashCommits == boot.flashCommits, "reconnecting to the same access point should not write flash");
+  check(res.body.find("wificonfig_connects_total 2\n") != std::string::npos
+        && res.body.find("wificonfig_link_losses_total 1\n") != std::string::npos
+        && res.body.find("# TYPE wificonfig_loop_seconds histogram\n") != std::string::npos,
+        "/metrics should list counters in Prometheus text format");
+  char loops[96];
+  snprintf(loops, sizeof(loops), "wificonfig_loop_seconds_bucket{le=\"+Inf\"} %lu\n", (unsigned long)m.loop.count);
+  check(m.loop.count > 0 && res.body.find(loops) != std::string::npos, "loop histogram should count every loop()");
+
+  // 记录一次耗时的开销
+  WiFiConfigLatencyHistogram histogram;
+  const int samples = 1000000;
+  double t0 = nowNs();
+  for (int i = 0; i < samples; i++) {
+    histogram.record((uint32_t)(i & 0x3fff));
+  }
+  double recordNs = (nowNs() - t0) / samples;
+  WiFiConfigLatency snapshot;
+  histogram.snapshot(snapshot);
+  check(snapshot.count == (uint32_t)samples, "histogram should count every sample");
+
+  printf("  phases: provisioning auth %lu ms, boot scan %lu / auth %lu / DHCP %lu ms (virtual)\n",
+         (unsigned long)provisionAuthMs, (unsigned long)boot.lastScanMs, (unsigned long)boot.lastAuthMs,
+         (unsigned long)boot.lastDhcpMs);
+  printf("  %lu loops, %lu connects, %lu link losses, %lu flash commits (%lu bytes); /metrics %zu bytes in %zu chunks\n",
+         (unsigned long)m.loop.count, (unsigned long)m.connects, (unsigned long)m.linkLosses,
+         (unsigned long)m.flashCommits, (unsigned long)m.flashBytes, res.body.size(), res.chunks);
+  printf("  histogram record(): %.1f ns (host)\n", recordNs);
+}
+
+// 配置页面的网络列表：/scan从不等待扫描，结果按SSID去重后缓存，缓存有效期内的请求不再扫描
+static void scenarioScanCache() {
+  printf("[scan-cache]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  // 同一网络的第二个接入点信号更强；开放网络；名称中有需要转义的字符；隐藏网络
+  size_t firstExtra = WiFi.hostNetworkCount();
+  HostNetwork& strongHome = WiFi.hostAddNetwork("HomeNet", "secret123");
+  strongHome.rssi = -40;
+  strongHome.bssid[5] = 0x42;
+  WiFi.hostAddNetwork("Guest", "").rssi = -70;
+  WiFi.hostAddNetwork("Cafe \"Bar\"\\", "cafe").rssi = -60;
+  WiFi.hostAddNetwork("", "hidden");
+
+  WiFiConfigManager mgr;
+  mgr.eepromBegin();
+  mgr.begin();
+  check(WiFi.hostAPUp(), "portal should be up without saved credentials");
+
+  HostRequest req;
+  req.uri = "/scan";
+  unsigned long scansBefore = WiFi.hostScans();
+  unsigned long t0 = hostNowMs();
+  double h0 = nowNs();
+  HostResponse first = WebServer::hostInstance()->hostRequest(req);
+  double firstNs = nowNs() - h0;
+  check(first.code == 200 && hostNowMs() == t0 && WiFi.hostScans() == scansBefore,
+        "/scan should answer at once without scanning in the handler");
+  check(first.body == "{\"scanning\":true,\"age\":-1,\"networks\":[]}", "first /scan should report a pending scan");
+
+  unsigned long scanMs = runUntil(mgr, [&] {
+    return WebServer::hostInstance()->hostRequest(req).body.find("\"scanning\":false") != std::string::npos;
+  }, 10000);
+  HostResponse list = WebServer::hostInstance()->hostRequest(req);
+  const std::string& body = list.body;
+  size_t home = body.find("{\"ssid\":\"HomeNet\",\"rssi\":-40,");
+  size_t cafe = body.find("{\"ssid\":\"Cafe \\\"Bar\\\"\\\\\",\"rssi\":-60,");
+  size_t guest = body.find("{\"ssid\":\"Guest\",\"rssi\":-70,\"channel\":6,\"secure\":false}");
+  check(home != std::string::npos && body.find("\"HomeNet\"", home + 10) == std::string::npos,
+        "networks should be deduplicated by SSID keeping the strongest");
+  check(cafe != std::string::npos && guest != std::string::npos && home < cafe && cafe < guest,
+        "networks should be escaped and sorted by signal strength");
+  check(body.find("\"ssid\":\"\"") == std::string::npos, "hidden networks should not be listed");
+  check(WiFi.hostScans() == scansBefore + 1, "one scan should serve the portal");
+
+  // 缓存有效期内的请求直接返回缓存
+  unsigned long scans = WiFi.hostScans();
+  for (int i = 0; i < 20; i++) {
+    WebServer::hostInstance()->hostRequest(req);
+    runUntil(mgr, [] { return false; }, 1000);
+  }
+  check(WiFi.hostScans() == scans, "requests within the TTL should be served from the cache");
+
+  // 缓存过期：先返回旧列表，同时在loop()中重新扫描
+  runUntil(mgr, [] { return false; }, 10000);
+  HostResponse stale = WebServer::hostInstance()->hostRequest(req);
+  check(stale.body.find("\"scanning\":true") != std::string::npos && stale.body.find("\"HomeNet\"") != std::string::npos,
+        "an expired cache should be returned while rescanning");
+  mgr.loop();
+  check(WiFi.hostScans() == scans + 1, "an expired cache should trigger one new scan");
+
+  printf("  first /scan answered in %.1f us (host) without scanning, list ready after %lu ms (virtual), "
+         "%zu bytes; 20 requests within TTL: 0 scans\n",
+         firstNs / 1000.0, scanMs, body.size());
+
+  for (size_t i = firstExtra; i < WiFi.hostNetworkCount(); i++) {
+    WiFi.hostNetwork(i).reachable = false;
+  }
+}
+
+// JSON配置接口：GET读出配置，PUT只修改出现的成员，未变化时不写Flash，只改MQTT参数时不重新连接
+static HostRequest configRequest(HTTPMethod method, const std::string& body = std::string()) {
+  HostRequest req;
+  req.method = method;
+  req.uri = "/api/config";
+  req.body = body.c_str();
+  return req;
+}
+
+static int s_jsonMembers = 0;
+static bool s_jsonDecoded = false;
+
+static const char* countJsonMember(void*, const char* key, WiFiConfigJsonType type, const char* value, size_t) {
+  s_jsonMembers++;
+  if (strcmp(key, "d") == 0) {
+    s_jsonDecoded = type == JSON_STRING && strcmp(value, "caf\xC3\xA9 \xF0\x9F\x98\x80") == 0;
+  }
+  return nullptr;
+}
+
+static void scenarioConfigAPI() {
+  printf("[config-api]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+
+  // 读取器可以按任意分段输入，结果相同
+  const char* doc = " {\"a\":1, \"b\":[{\"c\":\"]}\"}, []], \"d\":\"caf\\u00e9 \\ud83d\\ude00\", \"e\":null} ";
+  WiFiConfigJsonReader split(countJsonMember, nullptr);
+  bool fed = true;
+  for (const char* p = doc; *p; p++) fed &= split.feed(p, 1);
+  check(fed && split.finish() && s_jsonMembers == 4 && s_jsonDecoded,
+        "reader should accept byte-by-byte input and decode escapes");
+  const char* bad[] = { "", "[]", "{\"a\":}", "{\"a\":1,}", "{\"a\":tru}", "{\"a\":\"\\x\"}", "{\"a\":[}", "{} x",
+                        "{\"a\":\"\\udc00\"}", "{\"a\":01}" };
+  bool rejected = true;
+  for (const char* text : bad) {
+    WiFiConfigJsonReader reader(countJsonMember, nullptr);
+    rejected &= !(reader.feed(text, strlen(text)) && reader.finish()) && reader.error() != nullptr;
+  }
+  check(rejected, "reader should reject malformed documents");
+
+  WiFiConfigManager mgr;
+  mgr.setMetricsEndpoint(true);
+  mgr.eepromBegin();
+  mgr.begin();
+  WebServer* server = WebServer::hostInstance();
+
+  // 整机配置一次提交，包含GET才有的只读成员
+  double t0 = nowNs();
+  HostResponse put = server->hostRequest(configRequest(HTTP_PUT,
+      "{\"ssid\":\"HomeNet\",\"password\":\"secret123\",\"networks\":[{\"ssid\":\"ignored\"}],"
+      "\"enableUDP\":true,\"deviceName\":\"caf\\u00e9 \\\"1\\\"\",\"udpPort\":4210}"));
+  double putNs = nowNs() - t0;
+  check(put.code == 200 && put.body == "{\"changed\":true,\"reconnect\":true}", "full PUT should change the config");
+  runUntil(mgr, [&] { return mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED; }, 30000);
+  check(mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED, "PUT credentials should connect");
+
+  t0 = nowNs();
+  HostResponse get = server->hostRequest(configRequest(HTTP_GET));
+  double getNs = nowNs() - t0;
+  check(get.code == 200 && get.contentType == "application/json", "GET should answer JSON");
+  check(get.body.find("\"networks\":[{\"ssid\":\"HomeNet\"}]") != std::string::npos
+        && get.body.find("\"deviceName\":\"caf\xC3\xA9 \\\"1\\\"\"") != std::string::npos
+        && get.body.find("\"enableUDP\":true") != std::string::npos
+        && get.body.find("\"udpPort\":4210") != std::string::npos,
+        "GET should return the stored fields");
+  check(get.body.find("secret123") == std::string::npos && get.body.find("mqttPassword") == std::string::npos,
+        "GET should not return passwords");
+
+  // 读出的配置原样提交：没有变化，不写Flash
+  uint32_t commits = mgr.getMetrics().flashCommits;
+  HostResponse same = server->hostRequest(configRequest(HTTP_PUT, get.body));
+  runUntil(mgr, [] { return false; }, 1000);
+  check(same.code == 200 && same.body == "{\"changed\":false,\"reconnect\":false}"
+        && mgr.getMetrics().flashCommits == commits, "an unchanged PUT should not write flash");
+
+  // 部分更新：只改MQTT参数，写入一次，不断开连接
+  uint32_t connects = mgr.getMetrics().connects;
+  HostResponse partial = server->hostRequest(configRequest(HTTP_PUT,
+      "{\"enableMQTT\":true,\"mqttServer\":\"192.0.2.1\",\"mqttPort\":1884}"));
+  // 处理函数只修改暂存副本，getMQTTServer()等接口读取的配置由loop()更新
+  bool staged = strcmp(mgr.getMQTTServer(), "192.0.2.1") != 0;
+  runUntil(mgr, [] { return false; }, 1000);
+  check(staged && strcmp(mgr.getMQTTServer(), "192.0.2.1") == 0 && mgr.getMQTTPort() == 1884,
+        "a PUT should reach the config getters through loop()");
+  WiFiConfigMetrics m = mgr.getMetrics();
+  check(partial.code == 200 && partial.body == "{\"changed\":true,\"reconnect\":false}"
+        && m.flashCommits == commits + 1 && m.connects == connects
+        && mgr.getConnectionState() == WiFiConfigManager::CONN_CONNECTED,
+        "a partial PUT should commit once without reconnecting");
+  get = server->hostRequest(configRequest(HTTP_GET));
+  check(get.body.find("\"mqttServer\":\"192.0.2.1\",\"mqttPort\":1884") != std::string::npos
+        && get.body.find("\"udpPort\":4210") != std::string::npos, "omitted members should keep their values");
+
+  // 无效的请求整体被拒绝，配置不变
+  struct {
+    const char* body;
+    const char* error;
+  } invalid[] = {
+    { "{\"mqttPort\":70000}", "{\"error\":\"port out of range\",\"field\":\"mqttPort\"," },
+    { "{\"mqttServer\":\"a\",\"bogus\":1}", "{\"error\":\"unknown field\",\"field\":\"bogus\"," },
+    { "{\"enableUDP\":\"yes\"}", "{\"error\":\"expected boolean\",\"field\":\"enableUDP\"," },
+    { "{\"password\":\"x\"}", "{\"error\":\"password requires ssid\",\"field\":\"password\"," },
+    { "{\"abcdefghijklmnopqrstuvwxyz012345\":1}",
+      "{\"error\":\"unknown field\",\"field\":\"abcdefghijklmnopqrstuvwxyz012345\"," },
+    { "{\"mqttServer\":\"b\",", "{\"error\":\"unexpected end of input\",\"offset\":18}" },
+  };
+  bool allRejected = true;
+  for (auto& t : invalid) {
+    HostResponse res = server->hostRequest(configRequest(HTTP_PUT, t.body));
+    allRejected &= res.code == 400 && res.body.compare(0, strlen(t.error), t.error) == 0;
+  }
+  runUntil(mgr, [] { return false; }, 1000);
+  check(allRejected, "invalid PUTs should answer 400 with the reason");
+  check(server->hostRequest(configRequest(HTTP_GET)).body == get.body && mgr.getMetrics().flashCommits == commits + 1,
+        "rejected PUTs should leave the config untouched");
+
+  // 请求体分多段到达，每段直接交给读取器；中断的请求不修改配置
+  std::string padded = "{\"mqttPort\":1885," + std::string(3 * HTTP_RAW_BUFLEN, ' ') + "\"udpPort\":4211}";
+  HostRequest dropped = configRequest(HTTP_PUT, padded);
+  dropped.uploadAbortAt = HTTP_RAW_BUFLEN;
+  server->hostRequest(dropped);
+  check(server->hostRequest(configRequest(HTTP_GET)).body == get.body, "an aborted PUT should change nothing");
+  HostResponse chunked = server->hostRequest(configRequest(HTTP_PUT, padded));
+  runUntil(mgr, [] { return false; }, 1000);
+  get = server->hostRequest(configRequest(HTTP_GET));
+  check(chunked.code == 200 && get.body.find("\"mqttPort\":1885") != std::string::npos
+        && get.body.find("\"udpPort\":4211") != std::string::npos, "a body split across chunks should apply");
+
+  printf("  PUT %.1f us, GET %.1f us (host), GET body %zu bytes in %zu chunks\n", putNs / 1000.0, getNs / 1000.0,
+         get.body.size(), get.chunks);
+}
+
+// 固件更新：上传的镜像逐段写入OTA分区并累加SHA-256，摘要一致才激活，之后重启
+static std::string sha256Hex(const std::string& data) {
+  mbedtls_sha256_context ctx;
+  uint8_t digest[32];
+  mbedtls_sha256_init(&ctx);
+  mbedtls_sha256_starts(&ctx, 0);
+  mbedtls_sha256_update(&ctx, (const uint8_t*)data.data(), data.size());
+  mbedtls_sha256_finish(&ctx, digest);
+  mbedtls_sha256_free(&ctx);
+  char hex[65];
+  for (int i = 0; i < 32; i++) snprintf(hex + i * 2, 3, "%02x", digest[i]);
+  return hex;
+}
+
+static HostRequest updateRequest(const std::string& image, const std::string& sha256, size_t size = 0) {
+  HostRequest req;
+  req.method = HTTP_POST;
+  req.uri = "/update";
+  if (!sha256.empty()) req.args.push_back({ "sha256", sha256.c_str() });
+  if (size) req.args.push_back({ "size", String((unsigned long)size) });
+  req.uploadName = "firmware.bin";
+  req.upload = image;
+  return req;
+}
+
+static void scenarioOTA() {
+  printf("[ota]\n");
+  hostReset();
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  hostPartitionCreate("app1", 0x140000);  // 与partitions.csv中的app1相同
+
+  check(sha256Hex("abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"
+        && sha256Hex(std::string(1000, 'a')) == "41edece42d63e8d9bf515a9ba6932e1c20cbc9f5a5d134645adb5db1b9737ea3",
+        "host SHA-256 should match the reference vectors");
+
+  // 约1MB的镜像，长度不是扇区的整数倍
+  std::string image(1000003, '\0');
+  unsigned long seed = 12345;
+  for (size_t i = 0; i < image.size(); i++) {
+    seed = seed * 1103515245 + 12345;
+    image[i] = (char)(seed >> 16);
+  }
+  image[0] = (char)0xE9;
+  std::string hash = sha256Hex(image);
+
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    mgr.begin();
+    HostRequest req;
+    req.uri = "/update";
+    check(WebServer::hostInstance()->hostRequest(req).code == 302, "/update should be off by default");
+  }
+
+  WiFiConfigManager mgr;
+  mgr.setFirmwareUpdate(true);
+  mgr.eepromBegin();
+  mgr.begin();
+  WebServer* server = WebServer::hostInstance();
+  unsigned long activations = Update.hostActivations();
+
+  // 摘要不一致、缺少摘要、镜像格式错误、上传中断：都不激活
+  std::string tampered = image;
+  tampered[500000] ^= 1;
+  HostResponse mismatch = server->hostRequest(updateRequest(tampered, hash));
+  check(mismatch.code == 400 && mismatch.body.find("\"error\":\"sha256 mismatch\"") != std::string::npos,
+        "a tampered image should be rejected");
+  HostResponse noHash = server->hostRequest(updateRequest(image, ""));
+  check(noHash.code == 400 && noHash.body.find("sha256 must be 64 hex digits") != std::string::npos,
+        "an upload without sha256 should be rejected");
+  std::string badMagic = image;
+  badMagic[0] = 0;
+  HostResponse magic = server->hostRequest(updateRequest(badMagic, sha256Hex(badMagic)));
+  check(magic.code == 400 && magic.body.find("Wrong Magic Byte") != std::string::npos,
+        "an image without the ESP32 header should be rejected");
+  HostResponse shortImage = server->hostRequest(updateRequest(image.substr(0, 4096), hash, image.size()));
+  check(shortImage.code == 400 && shortImage.body.find("smaller than announced") != std::string::npos,
+        "a truncated image should be rejected");
+  HostRequest dropped = updateRequest(image, hash);
+  dropped.uploadAbortAt = 300000;
+  server->hostRequest(dropped);
+  HostRequest statusReq;
+  statusReq.uri = "/update";
+  HostResponse afterDrop = server->hostRequest(statusReq);
+  check(afterDrop.code == 200 && afterDrop.body.find("\"state\":\"failed\"") != std::string::npos
+        && afterDrop.body.find("upload aborted") != std::string::npos, "GET /update should report the aborted upload");
+  check(Update.hostActivations() == activations, "failed updates should never activate the partition");
+  runUntil(mgr, [] { return false; }, 2000);
+
+  // 正常更新：每个扇区只擦除和写入一次
+  hostPartitionResetStats("app1");
+  double t0 = nowNs();
+  HostResponse ok = server->hostRequest(updateRequest(image, hash, image.size()));
+  double uploadNs = nowNs() - t0;
+  HostFlashStats flash = hostPartitionStats("app1");
+  check(ok.code == 200 && ok.body.find("\"state\":\"done\",\"written\":1000003,\"size\":1000003,\"restart\":true")
+                            != std::string::npos, "a verified image should be activated");
+  check(Update.hostActivations() == activations + 1 && Update.hostActivatedSize() == image.size(),
+        "the OTA partition should be marked bootable once");
+  std::string written(image.size(), '\0');
+  esp_partition_read(esp_partition_find_first(ESP_PARTITION_TYPE_ANY, ESP_PARTITION_SUBTYPE_ANY, "app1"), 0,
+                     &written[0], written.size());
+  check(written == image, "the partition should hold the uploaded image");
+  check(flash.bytesProgrammed == image.size() && flash.sectorErases == (image.size() + 4095) / 4096,
+        "each sector should be erased and programmed once");
+
+  // 回复之后等待一段时间再重启
+  bool restarted = false;
+  unsigned long restartMs = 0;
+  unsigned long start = hostNowMs();
+  try {
+    runUntil(mgr, [] { return false; }, 5000);
+  } catch (const HostRestart&) {
+    restarted = true;
+    restartMs = hostNowMs() - start;
+  }
+  check(restarted && restartMs >= 1000 && restartMs <= 1000 + 2 * TICK_MS, "device should restart after the reply");
+
+  // 只计算哈希的开销，用于与整个上传流程比较
+  t0 = nowNs();
+  sha256Hex(image);
+  double hashNs = nowNs() - t0;
+  printf("  %zu byte image in %zu-byte chunks: %.1f MB/s end to end, SHA-256 alone %.1f MB/s (host); "
+         "%lu sector erases, restart after %lu ms (virtual)\n",
+         image.size(), (size_t)HTTP_UPLOAD_BUFLEN, image.size() / (uploadNs / 1000.0), image.size() / (hashNs / 1000.0),
+         flash.sectorErases, restartMs);
+}
+
+// 从启动（复位）到一条读数到达服务器的虚拟时间
+static unsigned long bootToPublish(WiFiConfigManager& mgr, FakeBroker& broker) {
+  size_t before = broker.received();
+  mgr.eepromBegin();
+  mgr.begin();
+  mgr.publish("sensors/porch", "{\"v\":1}");
+  pumpMQTT(mgr, [&] { return broker.received() > before; }, 30000);
+  check(broker.received() > before, "reading should reach the broker after boot");
+  return hostNowMs();
+}
+
+// 调用deepSleep()，返回设置的定时唤醒时间（微秒）
+static uint64_t enterDeepSleep(WiFiConfigManager& mgr, uint32_t durationMs) {
+  try {
+    mgr.deepSleep(durationMs);
+  } catch (const HostDeepSleep& sleep) {
+    return sleep.wakeupUs;
+  }
+  check(false, "deepSleep() should not return");
+  return 0;
+}
+
+// 深度睡眠：配置和接入点、地址保存在RTC内存中，唤醒后不读Flash、不扫描、不走DHCP
+static void scenarioDeepSleep() {
+  printf("[deep-sleep]\n");
+  hostReset();
+  WiFi.hostFindNetwork("HomeNet")->reachable = true;
+  hostPartitionRemove("wcfg");
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+  FakeBroker broker;
+  {
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    mgr.begin();
+    char port[8];
+    snprintf(port, sizeof(port), "%u", broker.port);
+    HostRequest req = saveRequest("HomeNet", "secret123");
+    req.args.push_back({ "enableMQTT", "on" });
+    req.args.push_back({ "mqttServer", "127.0.0.1" });
+    req.args.push_back({ "mqttPort", port });
+    WebServer::hostInstance()->hostQueue(req);
+    pumpMQTT(mgr, [&] { return mgr.getMQTT().connected(); }, 30000);
+    check(mgr.getMQTT().connected(), "should connect to the broker after provisioning");
+  }
+
+  unsigned long full;
+  {
+    hostReset();
+    WiFiConfigManager mgr;
+    mgr.setFastReconnect(false);
+    full = bootToPublish(mgr, broker);
+  }
+  unsigned long cold;
+  {
+    hostReset();
+    WiFiConfigManager mgr;
+    cold = bootToPublish(mgr, broker);
+    check(!mgr.restoredFromSleep(), "power-on should load the stored configuration");
+    check(enterDeepSleep(mgr, 60000) == 60000000ULL, "timer wakeup should match the sleep duration");
+  }
+
+  // 连续几个睡眠周期：每次唤醒都不访问存储
+  unsigned long wake = 0;
+  bool quiet = true;
+  for (int cycle = 0; cycle < 3; cycle++) {
+    hostDeepSleepWake();
+    EEPROM.hostResetCounters();
+    hostPartitionResetStats("wcfg");
+    WiFiConfigManager mgr;
+    wake = bootToPublish(mgr, broker);
+    HostFlashStats flash = hostPartitionStats("wcfg");
+    quiet = quiet && mgr.restoredFromSleep() && EEPROM.hostBegins() == 0 && flash.bytesRead == 0
+            && flash.bytesProgrammed == 0 && WiFi.hostScans() == 0 && WiFi.hostDhcpLeases() == 0;
+    enterDeepSleep(mgr, 60000);
+  }
+  check(quiet, "waking from deep sleep should skip flash, scan and DHCP");
+  check(wake < cold && cold < full, "RTC state should shorten wake-to-publish");
+  check(WiFi.localIP() == IPAddress(192, 168, 1, 100), "woken device should reuse the last address");
+
+  // 唤醒后修改配置：第一次保存时打开存储，断电后仍然有效
+  {
+    hostDeepSleepWake();
+    EEPROM.hostResetCounters();
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    check(mgr.restoredFromSleep() && EEPROM.hostBegins() == 0, "wake should not open storage");
+    mgr.setWiFiCredentials("Backup", "backup123");
+    check(EEPROM.hostBegins() == 1, "first save after waking should open storage");
+    enterDeepSleep(mgr, 60000);
+  }
+  {
+    // 上电时忽略RTC内存中的副本
+    hostReset();
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    check(!mgr.restoredFromSleep() && mgr.getNetworkCount() == 2, "change made after waking should be persisted");
+  }
+
+  // 唤醒但RTC内存中没有副本（例如由其他方式进入睡眠）：照常从存储加载
+  {
+    hostDeepSleepWake();
+    WiFiConfigManager mgr;
+    mgr.eepromBegin();
+    check(!mgr.restoredFromSleep() && mgr.getNetworkCount() == 2, "wake without RTC state should load storage");
+  }
+
+  printf("  boot to first published reading: full scan %lu ms, power-on %lu ms, deep sleep wake %lu ms (virtual)\n",
+         full, cold, wake);
+}
+
+int main() {
+  Serial.setQuiet(true);
+  hostPartitionCreate("wcfg", CONFIG_PARTITION_SIZE);
+
+  scenarioProvision();
+  scenarioBoot();
+  scenarioFallback();
+  scenarioIdle();
+  scenarioCorruptConfig();
+  scenarioLegacyImport();
+  scenarioWear();
+  scenarioForcedAP();
+  scenarioPortalPage();
+  scenarioMultiNetwork();
+  scenarioFastReconnect();
+  scenarioEvents();
+  scenarioBackoff();
+  scenarioPortalRetry();
+  scenarioSaveBurst();
+  scenarioSaveFailure();
+  scenarioPortalTask();
+  scenarioCaptiveDNS();
+  scenarioAnnounce();
+  scenarioMQTT();
+  scenarioMQTTResolve();
+  scenarioMetrics();
+  scenarioScanCache();
+  scenarioConfigAPI();
+  scenarioOTA();
+  scenarioDeepSleep();
+
+  printf("%s (%d failure%s)\n", s_failures ? "FAIL" : "OK", s_failures, s_failures == 1 ? "" : "s");
+  return s_failures ? 1 : 0;
+}
@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""把html/目录下的配置页面嵌入固件，生成WiFiConfigPages.h。
+
+静态页面预压缩为gzip字节数组；模板页面（含%NAME%占位符）以原文保存，
+由WiFiConfigTemplate在发送时逐段填充。
+
+修改html/中的页面后运行：
+    python3 tools/embed_pages.py
+生成的头文件与页面源文件一起提交，Arduino IDE编译时不需要Python。
+"""
+
+import gzip
+import hashlib
+import os
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+OUTPUT = os.path.join(ROOT, "WiFiConfigPages.h")
+
+# (源文件, 生成的符号前缀, 类型)
+PAGES = [
+    ("html/index.html", "PAGE_INDEX", "template"),
+    ("html/style.css", "PAGE_STYLE", "gzip"),
+    ("html/success.html", "PAGE_SUCCESS", "gzip"),
+]
+
+
+def compress(data):
+    # mtime=0保证相同输入得到相同输出，ETag和生成文件都稳定
+    return gzip.compress(data, compresslevel=9, mtime=0)
+
+
+def c_array(name, data):
+    lines = []
+    for i in range(0, len(data), 16):
+        chunk = data[i:i + 16]
+        lines.append("  " + ", ".join("0x%02x" % b for b in chunk) + ",")
+    return "static const uint8_t %s[] PROGMEM = {\n%s\n};\n" % (name, "\n".join(lines))
+
+
+def c_template(name, text):
+    assert ')rawliteral"' not in text
+    return 'static const char %s[] PROGMEM = R"rawliteral(%s)rawliteral";\n' % (name, text)
+
+
+def main():
+    out = [
+        "// 由tools/embed_pages.py根据html/目录生成，请勿手动修改",
+        "#ifndef WIFI_CONFIG_PAGES_H",
+        "#define WIFI_CONFIG_PAGES_H",
+        "",
+        "#include <Arduino.h>",
+        "",
+    ]
+    for path, symbol, kind in PAGES:
+        with open(os.path.join(ROOT, path), "rb") as f:
+            raw = f.read()
+        if kind == "template":
+            out.append("// %s: %d字节模板" % (path, len(raw)))
+            out.append(c_template(symbol + "_TEMPLATE", raw.decode("utf-8")))
+        else:
+            gz = compress(raw)
+            etag = hashlib.sha1(raw).hexdigest()[:16]
+            out.append("// %s: %d字节，gzip后%d字节" % (path, len(raw), len(gz)))
+            out.append(c_array(symbol + "_GZ", gz))
+            out.append('static const char %s_ETAG[] = "\\"%s\\"";' % (symbol, etag))
+        out.append("")
+    out.append("#endif  // WIFI_CONFIG_PAGES_H")
+    with open(OUTPUT, "w", newline="\n") as f:
+        f.write("\n".join(out) + "\n")
+
+
+if __name__ == "__main__":
+    main()